@@ -0,0 +1,151 @@
+/*
+ * AllocStats.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <malloc.h>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <AllocStats.hxx>
+
+// Plain zero-initialized statics, usable before any constructor runs
+static thread_local unsigned int currentSubsystem = ALLOC_OTHER;
+static atomic<unsigned long> allocs[ALLOC_SUBSYSTEMS];
+static atomic<unsigned long> frees[ALLOC_SUBSYSTEMS];
+static atomic<unsigned long> bytes[ALLOC_SUBSYSTEMS];
+static atomic<long> live;
+
+void AllocStats::setSubsystem(unsigned int subsystem)
+{
+    currentSubsystem = (subsystem < ALLOC_SUBSYSTEMS) ?
+        subsystem : ALLOC_OTHER;
+}
+
+const char *AllocStats::name(unsigned int subsystem)
+{
+    if (subsystem >= ALLOC_OTHER) {
+        return "other";
+    }
+
+    return ThreadConfig::roleName((ThreadConfig::Role) subsystem);
+}
+
+AllocCounts AllocStats::counts(unsigned int subsystem)
+{
+    AllocCounts counts = AllocCounts();
+
+    if (subsystem < ALLOC_SUBSYSTEMS) {
+        counts.allocs = allocs[subsystem].load(memory_order_relaxed);
+        counts.frees = frees[subsystem].load(memory_order_relaxed);
+        counts.bytes = bytes[subsystem].load(memory_order_relaxed);
+    }
+
+    return counts;
+}
+
+long AllocStats::liveBytes(void)
+{
+    return live.load(memory_order_relaxed);
+}
+
+/*
+ * Live bytes are left alone; they are what the heap holds, not a rate.
+ */
+void AllocStats::reset(void)
+{
+    for (unsigned int i = 0; i < ALLOC_SUBSYSTEMS; i++) {
+        allocs[i].store(0, memory_order_relaxed);
+        frees[i].store(0, memory_order_relaxed);
+        bytes[i].store(0, memory_order_relaxed);
+    }
+}
+
+static void *allocate(size_t size)
+{
+    unsigned int s = currentSubsystem;
+    void *p;
+
+    p = malloc((size > 0) ? size : 1);
+    if (p != NULL) {
+        allocs[s].fetch_add(1, memory_order_relaxed);
+        bytes[s].fetch_add(size, memory_order_relaxed);
+        live.fetch_add(malloc_usable_size(p), memory_order_relaxed);
+    }
+
+    return p;
+}
+
+static void release(void *p)
+{
+    if (p == NULL) {
+        return;
+    }
+
+    frees[currentSubsystem].fetch_add(1, memory_order_relaxed);
+    live.fetch_sub(malloc_usable_size(p), memory_order_relaxed);
+    free(p);
+}
+
+void *operator new(size_t size)
+{
+    void *p = allocate(size);
+
+    if (p == NULL) {
+        throw bad_alloc();
+    }
+
+    return p;
+}
+
+void *operator new[](size_t size)
+{
+    void *p = allocate(size);
+
+    if (p == NULL) {
+        throw bad_alloc();
+    }
+
+    return p;
+}
+
+void *operator new(size_t size, const nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void *operator new[](size_t size, const nothrow_t &) noexcept
+{
+    return allocate(size);
+}
+
+void operator delete(void *p) noexcept
+{
+    release(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+    release(p);
+}
+
+void operator delete(void *p, const nothrow_t &) noexcept
+{
+    release(p);
+}
+
+void operator delete[](void *p, const nothrow_t &) noexcept
+{
+    release(p);
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
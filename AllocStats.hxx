@@ -0,0 +1,57 @@
+/*
+ * AllocStats.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef ALLOCSTATS_HXX
+#define ALLOCSTATS_HXX
+
+#include <ThreadConfig.hxx>
+
+// Threads that never took a role, such as the logger's
+#define ALLOC_OTHER       ((unsigned int) ThreadConfig::ROLE_COUNT)
+#define ALLOC_SUBSYSTEMS  (ALLOC_OTHER + 1)
+
+using namespace std;
+
+struct AllocCounts {
+    unsigned long allocs;
+    unsigned long frees;
+    unsigned long bytes;         // Requested by the allocations
+};
+
+/*
+ * Process-wide heap accounting. The global operator new and delete are
+ * replaced to count allocations and frees against the subsystem of the
+ * calling thread, which is the thread role it last applied; threads
+ * that libmeshtastic starts take theirs on entry to our callbacks. A
+ * free counts against the thread that frees, which need not be the one
+ * that allocated, so only the process-wide live bytes are exact. The
+ * counters are relaxed atomics, so the accounting costs a few atomic
+ * adds per allocation and nothing else.
+ */
+class AllocStats {
+
+public:
+
+    static void setSubsystem(unsigned int subsystem);
+    static const char *name(unsigned int subsystem);
+
+    static AllocCounts counts(unsigned int subsystem);
+    static long liveBytes(void);
+    static void reset(void);
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,190 @@
+/*
+ * Clock.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <unistd.h>
+#include <csignal>
+#include <Clock.hxx>
+
+shared_ptr<Clock> Clock::_clock;
+
+Clock::~Clock()
+{
+
+}
+
+Clock *Clock::get(void)
+{
+    static RealClock realClock;
+
+    if (_clock) {
+        return _clock.get();
+    }
+
+    return &realClock;
+}
+
+/*
+ * Runs the alarm handler for a SIGALRM that was consumed synchronously
+ * (see Supervisor) instead of being delivered in signal context.
+ */
+void Clock::deliverAlarm(void)
+{
+
+}
+
+void Clock::set(shared_ptr<Clock> clock)
+{
+    _clock = clock;
+}
+
+RealClock::RealClock()
+    : _handler(NULL)
+{
+
+}
+
+RealClock::~RealClock()
+{
+
+}
+
+uint64_t RealClock::monotonicNs(void) const
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+time_t RealClock::wallTime(void) const
+{
+    return time(NULL);
+}
+
+void RealClock::sleepUs(unsigned int us)
+{
+    usleep(us);
+}
+
+void RealClock::setAlarmHandler(AlarmHandler handler)
+{
+    // The handler still runs in signal context unless SIGALRM is blocked
+    // and read by the supervisor, which then calls deliverAlarm()
+    _handler = handler;
+    signal(SIGALRM, handler);
+}
+
+unsigned int RealClock::alarm(unsigned int seconds)
+{
+    return ::alarm(seconds);
+}
+
+void RealClock::deliverAlarm(void)
+{
+    AlarmHandler handler = _handler;
+
+    if (handler) {
+        handler(SIGALRM);
+    }
+}
+
+SimClock::SimClock(time_t epoch)
+    : _epoch(epoch),
+      _ns(0),
+      _handler(NULL),
+      _deadline(0)
+{
+
+}
+
+SimClock::~SimClock()
+{
+
+}
+
+uint64_t SimClock::monotonicNs(void) const
+{
+    return _ns;
+}
+
+time_t SimClock::wallTime(void) const
+{
+    return _epoch + (time_t) (_ns / 1000000000ULL);
+}
+
+void SimClock::sleepUs(unsigned int us)
+{
+    // Simulated time only moves by advance(); yield real time so that a
+    // thread pacing itself on this clock doesn't spin
+    usleep(us);
+}
+
+void SimClock::setAlarmHandler(AlarmHandler handler)
+{
+    _mutex.lock();
+    _handler = handler;
+    _mutex.unlock();
+}
+
+unsigned int SimClock::alarm(unsigned int seconds)
+{
+    unsigned int remaining = 0;
+    uint64_t now = _ns;
+
+    _mutex.lock();
+    if (_deadline > now) {
+        remaining = (_deadline - now + 999999999ULL) / 1000000000ULL;
+    }
+    _deadline = (seconds > 0) ? now + (seconds * 1000000000ULL) : 0;
+    _mutex.unlock();
+
+    return remaining;
+}
+
+void SimClock::advance(uint64_t ns)
+{
+    advanceTo(_ns + ns);
+}
+
+void SimClock::advanceTo(uint64_t ns)
+{
+    AlarmHandler handler;
+
+    if (ns <= _ns) {
+        return;
+    }
+
+    // Fire every alarm due by ns at its deadline, including those the
+    // handler re-arms along the way, then let time catch up
+    for (;;) {
+        handler = NULL;
+        _mutex.lock();
+        if ((_deadline != 0) && (ns >= _deadline)) {
+            _ns = _deadline;
+            _deadline = 0;
+            handler = _handler;
+        }
+        _mutex.unlock();
+
+        if (handler == NULL) {
+            break;
+        }
+        handler(SIGALRM);
+    }
+
+    _ns = ns;
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
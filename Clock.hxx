@@ -0,0 +1,112 @@
+/*
+ * Clock.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef CLOCK_HXX
+#define CLOCK_HXX
+
+#include <stdint.h>
+#include <time.h>
+#include <memory>
+#include <mutex>
+#include <atomic>
+
+using namespace std;
+
+/*
+ * All time-dependent logic (render pacing, LED TTLs, crontab, the up-pump
+ * cutoff alarm, rate limiting) goes through Clock::get(), so that a
+ * SimClock can be swapped in to run it deterministically and faster than
+ * real time.
+ */
+class Clock {
+
+public:
+
+    typedef void (*AlarmHandler)(int signum);
+
+    virtual ~Clock();
+
+    virtual uint64_t monotonicNs(void) const = 0;
+    virtual time_t wallTime(void) const = 0;
+    virtual void sleepUs(unsigned int us) = 0;
+    virtual void setAlarmHandler(AlarmHandler handler) = 0;
+    virtual unsigned int alarm(unsigned int seconds) = 0;
+    virtual void deliverAlarm(void);
+
+    inline uint64_t monotonicMs(void) const {
+        return monotonicNs() / 1000000;
+    }
+
+    inline uint64_t monotonicSec(void) const {
+        return monotonicNs() / 1000000000ULL;
+    }
+
+    static Clock *get(void);
+    static void set(shared_ptr<Clock> clock);
+
+private:
+
+    static shared_ptr<Clock> _clock;
+
+};
+
+class RealClock : public Clock {
+
+public:
+
+    RealClock();
+    virtual ~RealClock();
+
+    virtual uint64_t monotonicNs(void) const;
+    virtual time_t wallTime(void) const;
+    virtual void sleepUs(unsigned int us);
+    virtual void setAlarmHandler(AlarmHandler handler);
+    virtual unsigned int alarm(unsigned int seconds);
+    virtual void deliverAlarm(void);
+
+private:
+
+    atomic<AlarmHandler> _handler;
+
+};
+
+class SimClock : public Clock {
+
+public:
+
+    SimClock(time_t epoch);
+    virtual ~SimClock();
+
+    virtual uint64_t monotonicNs(void) const;
+    virtual time_t wallTime(void) const;
+    virtual void sleepUs(unsigned int us);
+    virtual void setAlarmHandler(AlarmHandler handler);
+    virtual unsigned int alarm(unsigned int seconds);
+
+    void advance(uint64_t ns);
+    void advanceTo(uint64_t ns);
+
+private:
+
+    time_t _epoch;
+    atomic<uint64_t> _ns;
+    mutex _mutex;
+    AlarmHandler _handler;
+    uint64_t _deadline;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
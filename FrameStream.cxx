@@ -0,0 +1,345 @@
+/*
+ * FrameStream.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <cerrno>
+#include <cstring>
+#include <LedMatrix.hxx>
+#include <ThreadConfig.hxx>
+#include <FrameStream.hxx>
+#include <Logger.hxx>
+
+extern shared_ptr<LedMatrix> ledMatrix;
+
+FrameStream::FrameStream()
+    : _fd(-1),
+      _running(false),
+      _heartbeat("frames", LED_HEARTBEAT_MS)
+{
+
+}
+
+FrameStream::~FrameStream()
+{
+    detach();
+    join();
+
+    for (vector<Connection>::iterator it = _connections.begin();
+         it != _connections.end(); it++) {
+        close(it->fd);
+    }
+    _connections.clear();
+
+    if (_fd != -1) {
+        close(_fd);
+        _fd = -1;
+    }
+}
+
+bool FrameStream::bindPort(uint16_t port)
+{
+    bool result = false;
+    struct sockaddr_in addr;
+    int on = 1;
+
+    if ((_thread != NULL) || (ledMatrix == NULL)) {
+        goto done;
+    }
+
+    _fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (_fd == -1) {
+        Logger::get().error(Logger::CAT_LED, "socket: %s", strerror(errno));
+        goto done;
+    }
+
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(_fd, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+        Logger::get().error(Logger::CAT_LED, "bind %u: %s", port,
+                            strerror(errno));
+        goto done;
+    }
+
+    if (listen(_fd, FRAME_STREAM_MAX_CONNECTIONS) == -1) {
+        Logger::get().error(Logger::CAT_LED, "listen: %s", strerror(errno));
+        goto done;
+    }
+
+    _frames.resize(ledMatrix->chainCount());
+    _generations.resize(ledMatrix->chainCount());
+    for (unsigned int c = 0; c < ledMatrix->chainCount(); c++) {
+        _generations[c] = ledMatrix->frame(c, _frames[c]);
+    }
+
+    _running = true;
+    _thread = make_shared<thread>(FrameStream::thread_func, this);
+    result = true;
+
+done:
+
+    if ((result == false) && (_fd != -1)) {
+        close(_fd);
+        _fd = -1;
+    }
+
+    return result;
+}
+
+void FrameStream::detach(void)
+{
+    _running = false;
+}
+
+void FrameStream::join(void)
+{
+    if (_thread != NULL) {
+        if (_thread->joinable()) {
+            _thread->join();
+        }
+    }
+}
+
+void *FrameStream::thread_func(void *args)
+{
+    FrameStream *stream = (FrameStream *) args;
+
+    ThreadConfig::get().apply(ThreadConfig::ROLE_RPC);
+    stream->run();
+
+    return NULL;
+}
+
+/*
+ * Wakes up once per render frame to pick up whatever changed; viewers
+ * are otherwise only watched for hanging up and for room to send.
+ */
+void FrameStream::run(void)
+{
+    struct pollfd fds[FRAME_STREAM_MAX_CONNECTIONS + 1];
+    unsigned int nfds, i, delay;
+    char buf[256];
+    int ret;
+
+    while (_running) {
+        _heartbeat.beat();
+        nfds = 0;
+        fds[nfds].fd = _fd;
+        fds[nfds].events = POLLIN;
+        fds[nfds].revents = 0;
+        nfds++;
+        for (i = 0; i < _connections.size(); i++) {
+            fds[nfds].fd = _connections[i].fd;
+            fds[nfds].events = POLLIN;
+            if (!_connections[i].out.empty()) {
+                fds[nfds].events |= POLLOUT;
+            }
+            fds[nfds].revents = 0;
+            nfds++;
+        }
+
+        // Paced by the render frames, so its heartbeat is too
+        delay = ledMatrix->delay();
+        _heartbeat.setTimeoutMs(LED_HEARTBEAT_MS + 2 * delay);
+        ret = poll(fds, nfds, delay);
+        if (ret > 0) {
+            // Newest first so that erasing keeps the remaining indices
+            // valid
+            for (i = nfds - 1; i > 0; i--) {
+                bool closing = false;
+
+                if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                    if (read(fds[i].fd, buf, sizeof(buf)) <= 0) {
+                        closing = true;
+                    }
+                }
+                if (!closing && (fds[i].revents & POLLOUT)) {
+                    closing = !flush(_connections[i - 1]);
+                }
+                if (closing) {
+                    close(_connections[i - 1].fd);
+                    _connections.erase(_connections.begin() + (i - 1));
+                }
+            }
+
+            if (fds[0].revents & POLLIN) {
+                int fd = accept(_fd, NULL, NULL);
+                if (fd != -1) {
+                    if (_connections.size() >= FRAME_STREAM_MAX_CONNECTIONS) {
+                        close(fd);
+                    } else {
+                        Connection conn;
+                        conn.fd = fd;
+                        conn.synced = false;
+                        _connections.push_back(conn);
+                    }
+                }
+            }
+        }
+
+        publish();
+    }
+
+    _heartbeat.park();
+}
+
+/*
+ * Each changed frame is coded once and queued for every viewer that is
+ * in sync; a viewer that is not gets keyframes as soon as its queue is
+ * empty.
+ */
+void FrameStream::publish(void)
+{
+    vector<uint8_t> fb;
+    uint64_t generation;
+    string msg;
+    unsigned int c, i;
+
+    for (c = 0; c < _frames.size(); c++) {
+        generation = ledMatrix->frame(c, fb);
+        if (generation == _generations[c]) {
+            continue;
+        }
+
+        msg = delta(c, _frames[c], fb);
+        _frames[c].swap(fb);
+        _generations[c] = generation;
+
+        for (i = 0; i < _connections.size(); i++) {
+            Connection &conn = _connections[i];
+            if (!conn.synced) {
+                continue;
+            }
+            if (conn.out.size() > FRAME_STREAM_MAX_BACKLOG) {
+                conn.synced = false;
+                continue;
+            }
+            conn.out += msg;
+        }
+    }
+
+    for (i = _connections.size(); i > 0; i--) {
+        Connection &conn = _connections[i - 1];
+
+        if (!conn.synced && conn.out.empty()) {
+            for (c = 0; c < _frames.size(); c++) {
+                conn.out += keyframe(c, ledMatrix->columns(c),
+                                     ledMatrix->rows(c), _frames[c]);
+            }
+            conn.synced = true;
+        }
+
+        if (!flush(conn)) {
+            close(conn.fd);
+            _connections.erase(_connections.begin() + (i - 1));
+        }
+    }
+}
+
+/*
+ * Sends as much of the queue as the socket takes without blocking;
+ * false when the viewer is gone.
+ */
+bool FrameStream::flush(Connection &conn)
+{
+    ssize_t ret;
+
+    while (!conn.out.empty()) {
+        ret = send(conn.fd, conn.out.data(), conn.out.size(),
+                   MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (ret == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return (errno == EAGAIN) || (errno == EWOULDBLOCK);
+        }
+        if (ret == 0) {
+            return false;
+        }
+        conn.out.erase(0, ret);
+    }
+
+    return true;
+}
+
+static string message(char type, unsigned int c, const string &payload)
+{
+    string s;
+
+    s += type;
+    s += (char) c;
+    s += (char) ((payload.size() >> 8) & 0xff);
+    s += (char) (payload.size() & 0xff);
+    s += payload;
+
+    return s;
+}
+
+string FrameStream::keyframe(unsigned int c, unsigned int columns,
+                             unsigned int rows, const vector<uint8_t> &fb)
+{
+    string payload;
+
+    payload += (char) columns;
+    payload += (char) rows;
+    payload.append((const char *) fb.data(), fb.size());
+
+    return message(FRAME_KEY, c, payload);
+}
+
+string FrameStream::delta(unsigned int c, const vector<uint8_t> &prev,
+                          const vector<uint8_t> &fb)
+{
+    string payload;
+    size_t i = 0, start, n = fb.size();
+    unsigned int skip, count;
+
+    if (prev.size() != n) {
+        return string();
+    }
+
+    while (i < n) {
+        skip = 0;
+        while ((i < n) && (skip < 255) && (prev[i] == fb[i])) {
+            skip++;
+            i++;
+        }
+        if (i == n) {
+            break;               // Nothing changed at the end
+        }
+
+        start = i;
+        count = 0;
+        while ((i < n) && (count < 255) && (prev[i] != fb[i])) {
+            count++;
+            i++;
+        }
+
+        payload += (char) skip;
+        payload += (char) count;
+        for (; start < i; start++) {
+            payload += (char) (prev[start] ^ fb[start]);
+        }
+    }
+
+    return message(FRAME_DELTA, c, payload);
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,92 @@
+/*
+ * FrameStream.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef FRAMESTREAM_HXX
+#define FRAMESTREAM_HXX
+
+#include <stdint.h>
+#include <memory>
+#include <thread>
+#include <string>
+#include <vector>
+#include <Heartbeat.hxx>
+
+#define FRAME_STREAM_MAX_CONNECTIONS  4
+#define FRAME_STREAM_MAX_BACKLOG      4096  // Bytes queued for one viewer
+
+/* Message types */
+#define FRAME_KEY    'K'
+#define FRAME_DELTA  'D'
+
+using namespace std;
+
+/*
+ * Streams what the LED signs show to viewers over TCP. Every message is
+ *
+ *   type, chain, payload length (16 bits, big endian), payload
+ *
+ * A keyframe ('K') carries the chain's columns and rows followed by its
+ * whole frame buffer (rows x columns x 8 bytes, as LedMatrix keeps it).
+ * A delta ('D') is the XOR of the frame against the previous one, run
+ * length coded as (bytes to skip, byte count, that many XOR bytes)
+ * triples. A viewer gets a keyframe of every chain when it connects
+ * and then one delta per changed frame; nothing is sent while the signs
+ * stand still.
+ *
+ * A viewer that falls behind by more than FRAME_STREAM_MAX_BACKLOG
+ * skips frames and is resynchronized with keyframes once it drains;
+ * the render thread never waits for the network.
+ */
+class FrameStream {
+
+public:
+
+    FrameStream();
+    ~FrameStream();
+
+    bool bindPort(uint16_t port);
+    void detach(void);
+    void join(void);
+
+    static string keyframe(unsigned int c, unsigned int columns,
+                           unsigned int rows, const vector<uint8_t> &fb);
+    static string delta(unsigned int c, const vector<uint8_t> &prev,
+                        const vector<uint8_t> &fb);
+
+private:
+
+    struct Connection {
+        int fd;
+        string out;
+        bool synced;             // Every frame since the keyframes queued
+    };
+
+    static void *thread_func(void *);
+    void run(void);
+    void publish(void);
+    bool flush(Connection &conn);
+
+    int _fd;
+    bool _running;
+    shared_ptr<thread> _thread;
+    Heartbeat _heartbeat;
+    vector<Connection> _connections;
+    vector<vector<uint8_t> > _frames;    // Last frame sent, per chain
+    vector<uint64_t> _generations;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
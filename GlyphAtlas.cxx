@@ -0,0 +1,143 @@
+/*
+ * GlyphAtlas.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+// font8x8 defines its tables in its headers, so this must be the only
+// translation unit that includes them
+#include <font8x8/font8x8.h>
+#include <GlyphAtlas.hxx>
+
+#define GLYPH_LATIN_BASE  (GLYPH_BASIC_COUNT)
+#define GLYPH_GREEK_BASE  (GLYPH_LATIN_BASE + GLYPH_LATIN_COUNT)
+#define GLYPH_BOX_BASE    (GLYPH_GREEK_BASE + GLYPH_GREEK_COUNT)
+
+/*
+ * The font8x8 tables are plain (non-const) arrays, so the atlas cannot
+ * be a constant expression; it is built once, on first use, and never
+ * destroyed, so that text can still be rendered from the cleanup at
+ * exit.
+ */
+const GlyphAtlas &GlyphAtlas::get(void)
+{
+    static const GlyphAtlas *atlas = new GlyphAtlas;
+
+    return *atlas;
+}
+
+GlyphAtlas::GlyphAtlas()
+{
+    load(0, font8x8_basic, GLYPH_BASIC_COUNT);
+    load(GLYPH_LATIN_BASE, font8x8_ext_latin, GLYPH_LATIN_COUNT);
+    load(GLYPH_GREEK_BASE, font8x8_greek, GLYPH_GREEK_COUNT);
+    load(GLYPH_BOX_BASE, font8x8_box, GLYPH_BOX_COUNT);
+}
+
+/*
+ * font8x8 glyphs are row-major, top row first, with bit 0 the leftmost
+ * pixel. The panels are mounted so that a digit register drives one
+ * row with bit 0 on the left, bottom row on DIGIT0, so only the row
+ * order is flipped here.
+ */
+void GlyphAtlas::load(Glyph first, const char (*font)[8], unsigned int count)
+{
+    for (unsigned int c = 0; c < count; c++) {
+        for (unsigned int d = 0; d < 8; d++) {
+            _bitmaps[first + c][d] = (uint8_t) font[c][7 - d];
+        }
+    }
+}
+
+Glyph GlyphAtlas::lookup(uint32_t codepoint) const
+{
+    if (codepoint < GLYPH_BASIC_FIRST + GLYPH_BASIC_COUNT) {
+        return (Glyph) codepoint;
+    } else if ((codepoint >= GLYPH_LATIN_FIRST) &&
+               (codepoint < GLYPH_LATIN_FIRST + GLYPH_LATIN_COUNT)) {
+        return GLYPH_LATIN_BASE + (codepoint - GLYPH_LATIN_FIRST);
+    } else if ((codepoint >= GLYPH_GREEK_FIRST) &&
+               (codepoint < GLYPH_GREEK_FIRST + GLYPH_GREEK_COUNT)) {
+        return GLYPH_GREEK_BASE + (codepoint - GLYPH_GREEK_FIRST);
+    } else if ((codepoint >= GLYPH_BOX_FIRST) &&
+               (codepoint < GLYPH_BOX_FIRST + GLYPH_BOX_COUNT)) {
+        return GLYPH_BOX_BASE + (codepoint - GLYPH_BOX_FIRST);
+    }
+
+    return GLYPH_UNKNOWN;
+}
+
+/*
+ * A malformed sequence (bad lead byte, missing continuation, overlong
+ * form or surrogate) yields one '?' and decoding resumes at the next
+ * byte.
+ */
+void GlyphAtlas::decode(const string &utf8, vector<Glyph> &glyphs) const
+{
+    glyphs.resize(utf8.size());
+    glyphs.resize(decode(utf8.data(), utf8.size(), glyphs.data()));
+}
+
+/*
+ * Decodes into room for n glyphs, which is always enough, and returns
+ * how many there are.
+ */
+size_t GlyphAtlas::decode(const char *utf8, size_t n, Glyph *glyphs) const
+{
+    static const uint32_t minimum[5] = { 0, 0, 0x80, 0x800, 0x10000 };
+    size_t i = 0, count = 0;
+    unsigned int len, k;
+    uint32_t cp;
+    uint8_t c;
+
+    while (i < n) {
+        c = (uint8_t) utf8[i];
+        if (c < 0x80) {
+            cp = c;
+            len = 1;
+        } else if ((c & 0xe0) == 0xc0) {
+            cp = c & 0x1f;
+            len = 2;
+        } else if ((c & 0xf0) == 0xe0) {
+            cp = c & 0x0f;
+            len = 3;
+        } else if ((c & 0xf8) == 0xf0) {
+            cp = c & 0x07;
+            len = 4;
+        } else {
+            glyphs[count++] = GLYPH_UNKNOWN;
+            i++;
+            continue;
+        }
+
+        for (k = 1; (k < len) && (i + k < n); k++) {
+            c = (uint8_t) utf8[i + k];
+            if ((c & 0xc0) != 0x80) {
+                break;
+            }
+            cp = (cp << 6) | (c & 0x3f);
+        }
+
+        if ((k < len) || (cp < minimum[len]) || (cp > 0x10ffff) ||
+            ((cp >= 0xd800) && (cp <= 0xdfff))) {
+            glyphs[count++] = GLYPH_UNKNOWN;
+            i++;
+            continue;
+        }
+
+        glyphs[count++] = lookup(cp);
+        i += len;
+    }
+
+    return count;
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,75 @@
+/*
+ * GlyphAtlas.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef GLYPHATLAS_HXX
+#define GLYPHATLAS_HXX
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define GLYPH_BASIC_FIRST    0x0000
+#define GLYPH_BASIC_COUNT    128
+#define GLYPH_LATIN_FIRST    0x00a0
+#define GLYPH_LATIN_COUNT    96
+#define GLYPH_GREEK_FIRST    0x0390
+#define GLYPH_GREEK_COUNT    58
+#define GLYPH_BOX_FIRST      0x2500
+#define GLYPH_BOX_COUNT      128
+#define GLYPH_COUNT          (GLYPH_BASIC_COUNT + GLYPH_LATIN_COUNT + \
+                              GLYPH_GREEK_COUNT + GLYPH_BOX_COUNT)
+#define GLYPH_SPACE          ((Glyph) ' ')
+#define GLYPH_UNKNOWN        ((Glyph) '?')
+
+using namespace std;
+
+typedef uint16_t Glyph;
+
+/*
+ * The font8x8 basic, latin, greek and box tables merged into one array
+ * of glyphs, indexed by Glyph. Each glyph is stored in panel order:
+ * byte d is the column pattern for MAX7219 digit register DIGIT0 + d,
+ * so the renderer copies glyphs into the frame buffer and out to the
+ * chain without any per-frame transformation.
+ *
+ * Text is decoded from UTF-8 into glyphs once, when it is set; code
+ * points without a glyph, and malformed UTF-8, become '?'.
+ */
+class GlyphAtlas {
+
+public:
+
+    static const GlyphAtlas &get(void);
+
+    inline const uint8_t *bitmap(Glyph glyph) const {
+        return _bitmaps[(glyph < GLYPH_COUNT) ? glyph : GLYPH_UNKNOWN];
+    }
+
+    Glyph lookup(uint32_t codepoint) const;
+    void decode(const string &utf8, vector<Glyph> &glyphs) const;
+    size_t decode(const char *utf8, size_t n, Glyph *glyphs) const;
+
+private:
+
+    GlyphAtlas();
+
+    void load(Glyph first, const char (*font)[8], unsigned int count);
+
+    uint8_t _bitmaps[GLYPH_COUNT][8];
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
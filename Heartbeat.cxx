@@ -0,0 +1,159 @@
+/*
+ * Heartbeat.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <time.h>
+#include <algorithm>
+#include <Heartbeat.hxx>
+#include <Logger.hxx>
+
+Heartbeat::Heartbeat(const string &name, unsigned int timeoutMs)
+    : stalled(false),
+      _name(name),
+      _timeoutMs(timeoutMs),
+      _active(false),
+      _last(0),
+      _beats(0),
+      _stalls(0)
+{
+    registryMutex().lock();
+    registry().push_back(this);
+    registryMutex().unlock();
+}
+
+Heartbeat::~Heartbeat()
+{
+    vector<Heartbeat *> &heartbeats = registry();
+
+    registryMutex().lock();
+    heartbeats.erase(remove(heartbeats.begin(), heartbeats.end(), this),
+                     heartbeats.end());
+    registryMutex().unlock();
+}
+
+/*
+ * Function-local, so that heartbeats with static storage in other
+ * translation units can register during static initialization, and
+ * never destroyed, so that they can still unregister at exit.
+ */
+mutex &Heartbeat::registryMutex(void)
+{
+    static mutex *m = new mutex;
+
+    return *m;
+}
+
+vector<Heartbeat *> &Heartbeat::registry(void)
+{
+    static vector<Heartbeat *> *heartbeats = new vector<Heartbeat *>;
+
+    return *heartbeats;
+}
+
+/*
+ * Stalls are measured in real time, independent of Clock.
+ */
+uint64_t Heartbeat::nowMs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t) ts.tv_sec * 1000ULL) + (ts.tv_nsec / 1000000);
+}
+
+/*
+ * Copies the registered heartbeats. Hold lock() while using them, so
+ * that none is destroyed underneath the caller.
+ */
+void Heartbeat::list(vector<Heartbeat *> &heartbeats)
+{
+    heartbeats = registry();
+}
+
+void Heartbeat::lock(void)
+{
+    registryMutex().lock();
+}
+
+void Heartbeat::unlock(void)
+{
+    registryMutex().unlock();
+}
+
+const string &Heartbeat::name(void) const
+{
+    return _name;
+}
+
+unsigned int Heartbeat::timeoutMs(void) const
+{
+    return _timeoutMs;
+}
+
+void Heartbeat::setTimeoutMs(unsigned int timeoutMs)
+{
+    _timeoutMs = timeoutMs;
+}
+
+void Heartbeat::beat(void)
+{
+    uint64_t now = nowMs();
+    uint64_t last = _last.exchange(now);
+    uint64_t gap;
+
+    if (_active && (last != 0)) {
+        gap = now - last;
+        _gaps.add(gap * 1000000ULL);
+        if (gap > _timeoutMs) {
+            _stalls++;
+            Logger::get().warn(Logger::CAT_SYSTEM, "%s: stalled for %lums",
+                               _name, (unsigned long) gap);
+        }
+    }
+
+    _beats++;
+    _active = true;
+}
+
+void Heartbeat::park(void)
+{
+    _active = false;
+}
+
+bool Heartbeat::active(void) const
+{
+    return _active;
+}
+
+uint64_t Heartbeat::last(void) const
+{
+    return _last;
+}
+
+unsigned long Heartbeat::beats(void) const
+{
+    return _beats;
+}
+
+unsigned long Heartbeat::stalls(void) const
+{
+    return _stalls;
+}
+
+const Histogram &Heartbeat::gaps(void) const
+{
+    return _gaps;
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,81 @@
+/*
+ * Heartbeat.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef HEARTBEAT_HXX
+#define HEARTBEAT_HXX
+
+#include <stdint.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <Histogram.hxx>
+
+using namespace std;
+
+/*
+ * A long-running loop calls beat() once per iteration; the watchdog
+ * scans all registered heartbeats and reports loops that have gone
+ * quiet for longer than their timeout. A loop that is about to exit or
+ * to block on purpose calls park() so it isn't reported, and a loop
+ * whose period is configurable moves its timeout with setTimeoutMs().
+ *
+ * Every gap between two beats goes into a histogram; a gap longer than
+ * the timeout is also counted and logged as a stall when it ends.
+ */
+class Heartbeat {
+
+public:
+
+    Heartbeat(const string &name, unsigned int timeoutMs);
+    ~Heartbeat();
+
+    static uint64_t nowMs(void);
+    static void list(vector<Heartbeat *> &heartbeats);
+    static void lock(void);
+    static void unlock(void);
+
+    const string &name(void) const;
+    unsigned int timeoutMs(void) const;
+    void setTimeoutMs(unsigned int timeoutMs);
+
+    void beat(void);
+    void park(void);
+    bool active(void) const;
+    uint64_t last(void) const;
+    unsigned long beats(void) const;
+    unsigned long stalls(void) const;
+    const Histogram &gaps(void) const;
+
+    // Owned by the supervisor
+    bool stalled;
+
+private:
+
+    string _name;
+    atomic<unsigned int> _timeoutMs;
+    atomic<bool> _active;
+    atomic<uint64_t> _last;
+    atomic<unsigned long> _beats;
+    atomic<unsigned long> _stalls;
+    Histogram _gaps;
+
+    static mutex &registryMutex(void);
+    static vector<Heartbeat *> &registry(void);
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
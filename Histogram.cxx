@@ -0,0 +1,180 @@
+/*
+ * Histogram.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <Histogram.hxx>
+
+Histogram::Histogram()
+{
+    reset();
+}
+
+Histogram::~Histogram()
+{
+
+}
+
+void Histogram::add(uint64_t ns)
+{
+    uint64_t us = ns / 1000;
+    unsigned int i = 0;
+
+    while ((us > 1) && (i < (HISTOGRAM_BUCKETS - 1))) {
+        us >>= 1;
+        i++;
+    }
+
+    _mutex.lock();
+    _buckets[i]++;
+    _count++;
+    _sum += ns;
+    _sumSq += (double) ns * (double) ns;
+    if ((_count == 1) || (ns < _min)) {
+        _min = ns;
+    }
+    if (ns > _max) {
+        _max = ns;
+    }
+    _mutex.unlock();
+}
+
+void Histogram::reset(void)
+{
+    _mutex.lock();
+    memset(_buckets, 0, sizeof(_buckets));
+    _count = 0;
+    _sum = 0;
+    _sumSq = 0.0;
+    _min = 0;
+    _max = 0;
+    _mutex.unlock();
+}
+
+unsigned long Histogram::count(void) const
+{
+    return _count;
+}
+
+uint64_t Histogram::min(void) const
+{
+    return _min;
+}
+
+uint64_t Histogram::max(void) const
+{
+    return _max;
+}
+
+uint64_t Histogram::mean(void) const
+{
+    uint64_t mean = 0;
+
+    _mutex.lock();
+    if (_count > 0) {
+        mean = _sum / _count;
+    }
+    _mutex.unlock();
+
+    return mean;
+}
+
+uint64_t Histogram::stddev(void) const
+{
+    double mean, var = 0.0;
+
+    _mutex.lock();
+    if (_count > 1) {
+        mean = (double) _sum / (double) _count;
+        var = (_sumSq / (double) _count) - (mean * mean);
+    }
+    _mutex.unlock();
+
+    return (var > 0.0) ? (uint64_t) sqrt(var) : 0;
+}
+
+/*
+ * Returns the upper bound (in ns) of the bucket holding the p-th
+ * percentile, clamped to the observed maximum.
+ */
+uint64_t Histogram::percentile(unsigned int p) const
+{
+    uint64_t result = 0;
+    unsigned long target, seen = 0;
+
+    _mutex.lock();
+
+    if (_count == 0) {
+        goto done;
+    }
+
+    target = ((_count * p) + 99) / 100;
+    if (target == 0) {
+        target = 1;
+    }
+
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        seen += _buckets[i];
+        if (seen >= target) {
+            result = (2ULL << i) * 1000;
+            break;
+        }
+    }
+
+    if (result > _max) {
+        result = _max;
+    }
+
+done:
+
+    _mutex.unlock();
+
+    return result;
+}
+
+string Histogram::summary(void) const
+{
+    char buf[160];
+
+    snprintf(buf, sizeof(buf),
+             "n=%lu min=%.1f avg=%.1f p50=%.1f p90=%.1f p99=%.1f "
+             "max=%.1f us",
+             count(), min() / 1e3, mean() / 1e3,
+             percentile(50) / 1e3, percentile(90) / 1e3,
+             percentile(99) / 1e3, max() / 1e3);
+
+    return buf;
+}
+
+string Histogram::buckets(void) const
+{
+    string s;
+    char buf[64];
+
+    _mutex.lock();
+    for (unsigned int i = 0; i < HISTOGRAM_BUCKETS; i++) {
+        if (_buckets[i] == 0) {
+            continue;
+        }
+        snprintf(buf, sizeof(buf), "  <%llu us: %lu\n",
+                 2ULL << i, _buckets[i]);
+        s += buf;
+    }
+    _mutex.unlock();
+
+    return s;
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
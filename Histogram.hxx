@@ -0,0 +1,64 @@
+/*
+ * Histogram.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef HISTOGRAM_HXX
+#define HISTOGRAM_HXX
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+
+#define HISTOGRAM_BUCKETS  32
+
+using namespace std;
+
+/*
+ * Log2-bucketed histogram of durations in microseconds: bucket i counts
+ * samples in [2^i, 2^(i+1)) us, bucket 0 also takes anything below 1 us.
+ */
+class Histogram {
+
+public:
+
+    Histogram();
+    ~Histogram();
+
+    void add(uint64_t ns);
+    void reset(void);
+
+    unsigned long count(void) const;
+    uint64_t min(void) const;
+    uint64_t max(void) const;
+    uint64_t mean(void) const;
+    uint64_t stddev(void) const;
+    uint64_t percentile(unsigned int p) const;
+
+    string summary(void) const;
+    string buckets(void) const;
+
+private:
+
+    mutable mutex _mutex;
+    unsigned long _buckets[HISTOGRAM_BUCKETS];
+    unsigned long _count;
+    uint64_t _sum;
+    double _sumSq;
+    uint64_t _min;
+    uint64_t _max;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
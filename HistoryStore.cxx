@@ -0,0 +1,632 @@
+/*
+ * HistoryStore.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <string.h>
+#include <unistd.h>
+#include <cstdio>
+#include <HistoryStore.hxx>
+#include <Logger.hxx>
+
+#define HISTORY_MAGIC    0x5348504d  // 'MPHS'
+#define HISTORY_VERSION  1
+
+static const unsigned int tierPeriod[TimeSeries::TIER_COUNT] = {
+    HISTORY_RAW_SEC,
+    60,
+    3600,
+};
+
+static const unsigned int tierPoints[TimeSeries::TIER_COUNT] = {
+    HISTORY_RAW_POINTS,
+    HISTORY_MINUTE_POINTS,
+    HISTORY_HOUR_POINTS,
+};
+
+static const char *tierNames[TimeSeries::TIER_COUNT] = {
+    "raw",
+    "minute",
+    "hour",
+};
+
+// The window each tier is summarized over
+static const unsigned int tierSpan[TimeSeries::TIER_COUNT] = {
+    3600,
+    86400,
+    30 * 86400,
+};
+
+static const char *spanNames[TimeSeries::TIER_COUNT] = {
+    "1h",
+    "1d",
+    "30d",
+};
+
+TimeSeries::TimeSeries(const string &name, const string &unit)
+    : _name(name),
+      _unit(unit)
+{
+    HistoryPoint empty;
+
+    memset(&empty, 0, sizeof(empty));
+    for (unsigned int i = 0; i < TIER_COUNT; i++) {
+        _slot[i] = 0;
+        _ring[i].assign(tierPoints[i], empty);
+    }
+}
+
+TimeSeries::~TimeSeries()
+{
+
+}
+
+unsigned int TimeSeries::period(Tier tier)
+{
+    return tierPeriod[tier];
+}
+
+unsigned int TimeSeries::points(Tier tier)
+{
+    return tierPoints[tier];
+}
+
+const char *TimeSeries::tierName(Tier tier)
+{
+    return tierNames[tier];
+}
+
+bool TimeSeries::parseTier(const string &s, Tier &tier)
+{
+    for (unsigned int i = 0; i < TIER_COUNT; i++) {
+        if (s == tierNames[i]) {
+            tier = (Tier) i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+size_t TimeSeries::footprint(void)
+{
+    size_t bytes = sizeof(TimeSeries);
+
+    for (unsigned int i = 0; i < TIER_COUNT; i++) {
+        bytes += tierPoints[i] * sizeof(HistoryPoint);
+    }
+
+    return bytes;
+}
+
+const string &TimeSeries::name(void) const
+{
+    return _name;
+}
+
+const string &TimeSeries::unit(void) const
+{
+    return _unit;
+}
+
+void TimeSeries::add(time_t t, float value)
+{
+    uint64_t slot, gap;
+    unsigned int n;
+
+    if (t < 0) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < TIER_COUNT; i++) {
+        slot = (uint64_t) t / tierPeriod[i];
+        n = tierPoints[i];
+        if (slot < _slot[i]) {
+            continue;
+        }
+
+        if (slot > _slot[i]) {
+            // Empty the slots skipped over, at most one lap of the ring
+            gap = slot - _slot[i];
+            if (gap > n) {
+                gap = n;
+            }
+            for (uint64_t k = 0; k < gap; k++) {
+                memset(&_ring[i][(slot - k) % n], 0, sizeof(HistoryPoint));
+            }
+            _slot[i] = slot;
+        }
+
+        HistoryPoint &p = _ring[i][slot % n];
+        if (p.count == 0) {
+            p.min = value;
+            p.max = value;
+            p.avg = value;
+        } else {
+            if (value < p.min) {
+                p.min = value;
+            }
+            if (value > p.max) {
+                p.max = value;
+            }
+            p.avg += (value - p.avg) / (p.count + 1);
+        }
+        p.count++;
+    }
+}
+
+/*
+ * Merges the slots of a tier that fall within the last 'span' seconds
+ * before 'now'. Returns false if there is no data in the window.
+ */
+bool TimeSeries::summarize(Tier tier, time_t now, unsigned int span,
+                           HistoryPoint &point) const
+{
+    uint64_t last, first, oldest;
+    unsigned int n = tierPoints[tier];
+    double sum = 0.0;
+
+    memset(&point, 0, sizeof(point));
+
+    if (now < 0) {
+        return false;
+    }
+
+    last = (uint64_t) now / tierPeriod[tier];
+    if (last > _slot[tier]) {
+        last = _slot[tier];
+    }
+    first = ((uint64_t) now > span) ?
+        ((uint64_t) now - span) / tierPeriod[tier] + 1 : 0;
+    oldest = (_slot[tier] >= n) ? _slot[tier] - n + 1 : 0;
+    if (first < oldest) {
+        first = oldest;
+    }
+
+    for (uint64_t slot = first; slot <= last; slot++) {
+        const HistoryPoint &p = _ring[tier][slot % n];
+        if (p.count == 0) {
+            continue;
+        }
+        if ((point.count == 0) || (p.min < point.min)) {
+            point.min = p.min;
+        }
+        if ((point.count == 0) || (p.max > point.max)) {
+            point.max = p.max;
+        }
+        sum += (double) p.avg * p.count;
+        point.count += p.count;
+    }
+
+    if (point.count == 0) {
+        return false;
+    }
+
+    point.avg = sum / point.count;
+
+    return true;
+}
+
+/*
+ * The non-empty slots of a tier, oldest first.
+ */
+void TimeSeries::dump(Tier tier,
+                      vector<pair<time_t, HistoryPoint> > &points) const
+{
+    unsigned int n = tierPoints[tier];
+    uint64_t first = (_slot[tier] >= n) ? _slot[tier] - n + 1 : 0;
+
+    points.clear();
+    for (uint64_t slot = first; slot <= _slot[tier]; slot++) {
+        const HistoryPoint &p = _ring[tier][slot % n];
+        if (p.count > 0) {
+            points.push_back(make_pair((time_t) (slot * tierPeriod[tier]),
+                                       p));
+        }
+    }
+}
+
+bool TimeSeries::write(FILE *fp) const
+{
+    char name[HISTORY_NAME_LEN];
+    char unit[HISTORY_UNIT_LEN];
+    uint32_t geometry[2];
+
+    memset(name, 0, sizeof(name));
+    memset(unit, 0, sizeof(unit));
+    strncpy(name, _name.c_str(), sizeof(name) - 1);
+    strncpy(unit, _unit.c_str(), sizeof(unit) - 1);
+
+    if ((fwrite(name, sizeof(name), 1, fp) != 1) ||
+        (fwrite(unit, sizeof(unit), 1, fp) != 1)) {
+        return false;
+    }
+
+    for (unsigned int i = 0; i < TIER_COUNT; i++) {
+        geometry[0] = tierPeriod[i];
+        geometry[1] = tierPoints[i];
+        if ((fwrite(geometry, sizeof(geometry), 1, fp) != 1) ||
+            (fwrite(&_slot[i], sizeof(_slot[i]), 1, fp) != 1) ||
+            (fwrite(&_ring[i][0], sizeof(HistoryPoint), tierPoints[i], fp) !=
+             tierPoints[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/*
+ * Reads a series written by write(). Fails if the file was written with
+ * different tier periods or sizes.
+ */
+bool TimeSeries::read(FILE *fp)
+{
+    char name[HISTORY_NAME_LEN];
+    char unit[HISTORY_UNIT_LEN];
+    uint32_t geometry[2];
+
+    if ((fread(name, sizeof(name), 1, fp) != 1) ||
+        (fread(unit, sizeof(unit), 1, fp) != 1)) {
+        return false;
+    }
+    name[sizeof(name) - 1] = '\0';
+    unit[sizeof(unit) - 1] = '\0';
+    _name = name;
+    _unit = unit;
+
+    for (unsigned int i = 0; i < TIER_COUNT; i++) {
+        if ((fread(geometry, sizeof(geometry), 1, fp) != 1) ||
+            (geometry[0] != tierPeriod[i]) ||
+            (geometry[1] != tierPoints[i]) ||
+            (fread(&_slot[i], sizeof(_slot[i]), 1, fp) != 1) ||
+            (fread(&_ring[i][0], sizeof(HistoryPoint), tierPoints[i], fp) !=
+             tierPoints[i])) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+HistoryStore::HistoryStore()
+    : _checkpointPending(false),
+      _running(false)
+{
+
+}
+
+HistoryStore::~HistoryStore()
+{
+    stopCheckpoints();
+}
+
+int HistoryStore::addSeries(const string &name, const string &unit)
+{
+    int index = -1;
+
+    _mutex.lock();
+    for (unsigned int i = 0; i < _series.size(); i++) {
+        if (_series[i]->name() == name) {
+            index = i;
+            goto done;
+        }
+    }
+
+    if (_series.size() < HISTORY_MAX_SERIES) {
+        _series.push_back(make_shared<TimeSeries>(name, unit));
+        index = _series.size() - 1;
+    }
+
+done:
+
+    _mutex.unlock();
+
+    return index;
+}
+
+int HistoryStore::find(const string &name) const
+{
+    int index = -1;
+
+    _mutex.lock();
+    for (unsigned int i = 0; i < _series.size(); i++) {
+        if (_series[i]->name() == name) {
+            index = i;
+            break;
+        }
+    }
+    _mutex.unlock();
+
+    return index;
+}
+
+unsigned int HistoryStore::size(void) const
+{
+    unsigned int n;
+
+    _mutex.lock();
+    n = _series.size();
+    _mutex.unlock();
+
+    return n;
+}
+
+size_t HistoryStore::footprint(void) const
+{
+    return size() * TimeSeries::footprint();
+}
+
+void HistoryStore::add(unsigned int index, time_t t, float value)
+{
+    _mutex.lock();
+    if (index < _series.size()) {
+        _series[index]->add(t, value);
+    }
+    _mutex.unlock();
+}
+
+/*
+ * One line per series with its 1h/1d/30d means; short enough for a chat
+ * reply.
+ */
+string HistoryStore::summary(time_t now) const
+{
+    string s = "avg 1h/1d/30d";
+    HistoryPoint p;
+    char buf[16];
+
+    _mutex.lock();
+    for (unsigned int i = 0; i < _series.size(); i++) {
+        s += "\n" + _series[i]->name() + " ";
+        for (unsigned int t = 0; t < TimeSeries::TIER_COUNT; t++) {
+            if (t > 0) {
+                s += "/";
+            }
+            if (_series[i]->summarize((TimeSeries::Tier) t, now,
+                                      tierSpan[t], p)) {
+                snprintf(buf, sizeof(buf), "%.1f", p.avg);
+                s += buf;
+            } else {
+                s += "-";
+            }
+        }
+        s += _series[i]->unit();
+    }
+    _mutex.unlock();
+
+    return s;
+}
+
+string HistoryStore::describe(unsigned int index, time_t now) const
+{
+    string s;
+    HistoryPoint p;
+    char buf[80];
+
+    _mutex.lock();
+    if (index >= _series.size()) {
+        goto done;
+    }
+
+    s = _series[index]->name() + " (" + _series[index]->unit() + ")";
+    for (unsigned int t = 0; t < TimeSeries::TIER_COUNT; t++) {
+        if (_series[index]->summarize((TimeSeries::Tier) t, now,
+                                      tierSpan[t], p)) {
+            snprintf(buf, sizeof(buf), "\n%s: avg %.1f min %.1f max %.1f",
+                     spanNames[t], p.avg, p.min, p.max);
+        } else {
+            snprintf(buf, sizeof(buf), "\n%s: no data", spanNames[t]);
+        }
+        s += buf;
+    }
+
+done:
+
+    _mutex.unlock();
+
+    return s;
+}
+
+string HistoryStore::dump(unsigned int index, TimeSeries::Tier tier) const
+{
+    vector<pair<time_t, HistoryPoint> > points;
+    string s;
+    struct tm tm;
+    char buf[96];
+    size_t len;
+
+    _mutex.lock();
+    if (index < _series.size()) {
+        _series[index]->dump(tier, points);
+    }
+    _mutex.unlock();
+
+    for (vector<pair<time_t, HistoryPoint> >::const_iterator it =
+             points.begin(); it != points.end(); it++) {
+        localtime_r(&it->first, &tm);
+        len = strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &tm);
+        snprintf(buf + len, sizeof(buf) - len,
+                 " avg %.1f min %.1f max %.1f n %u\n",
+                 it->second.avg, it->second.min, it->second.max,
+                 it->second.count);
+        s += buf;
+    }
+
+    return s;
+}
+
+/*
+ * Restores the series that are already registered from a checkpoint;
+ * series in the file that are no longer registered are ignored.
+ */
+bool HistoryStore::load(const string &path)
+{
+    bool result = false;
+    FILE *fp;
+    uint32_t header[3];
+    TimeSeries series("", "");
+
+    fp = fopen(path.c_str(), "r");
+    if (fp == NULL) {
+        goto done;
+    }
+
+    if ((fread(header, sizeof(header), 1, fp) != 1) ||
+        (header[0] != HISTORY_MAGIC) || (header[1] != HISTORY_VERSION)) {
+        goto done;
+    }
+
+    _mutex.lock();
+    for (uint32_t n = 0; n < header[2]; n++) {
+        if (!series.read(fp)) {
+            break;
+        }
+        for (unsigned int i = 0; i < _series.size(); i++) {
+            if (_series[i]->name() == series.name()) {
+                *_series[i] = series;
+                break;
+            }
+        }
+    }
+    _mutex.unlock();
+
+    result = true;
+
+done:
+
+    if (fp) {
+        fclose(fp);
+    }
+
+    return result;
+}
+
+/*
+ * Writes to a temporary file and renames it over the checkpoint, so a
+ * crash mid-write leaves the previous checkpoint intact. The series are
+ * copied under the lock and written without it, so that add() never
+ * waits on the disk.
+ */
+bool HistoryStore::save(const string &path) const
+{
+    bool result = false;
+    string tmp = path + ".tmp";
+    FILE *fp;
+    uint32_t header[3];
+    vector<TimeSeries> series;
+
+    _mutex.lock();
+    for (unsigned int i = 0; i < _series.size(); i++) {
+        series.push_back(*_series[i]);
+    }
+    _mutex.unlock();
+
+    fp = fopen(tmp.c_str(), "w");
+    if (fp == NULL) {
+        goto done;
+    }
+
+    header[0] = HISTORY_MAGIC;
+    header[1] = HISTORY_VERSION;
+    header[2] = series.size();
+    result = (fwrite(header, sizeof(header), 1, fp) == 1);
+    for (unsigned int i = 0; result && (i < series.size()); i++) {
+        result = series[i].write(fp);
+    }
+
+    if (fflush(fp) != 0) {
+        result = false;
+    }
+    if (fsync(fileno(fp)) != 0) {
+        result = false;
+    }
+    fclose(fp);
+
+    if (result) {
+        result = (rename(tmp.c_str(), path.c_str()) == 0);
+    }
+    if (!result) {
+        unlink(tmp.c_str());
+    }
+
+done:
+
+    return result;
+}
+
+/*
+ * Checkpoints are written by a thread of their own: the caller of
+ * checkpoint() is the supervisor tick, which also delivers the relay
+ * cutoffs and must not wait on an fsync.
+ */
+void HistoryStore::startCheckpoints(const string &path)
+{
+    if (_thread == NULL) {
+        _checkpointPath = path;
+        _running = true;
+        _thread = make_shared<thread>(HistoryStore::thread_func, this);
+    }
+}
+
+void HistoryStore::checkpoint(void)
+{
+    _checkpointMutex.lock();
+    _checkpointPending = true;
+    _wakeup.notify_all();
+    _checkpointMutex.unlock();
+}
+
+void HistoryStore::stopCheckpoints(void)
+{
+    if (_thread != NULL) {
+        _checkpointMutex.lock();
+        _running = false;
+        _wakeup.notify_all();
+        _checkpointMutex.unlock();
+        if (_thread->joinable()) {
+            _thread->join();
+        }
+        _thread = NULL;
+    }
+}
+
+void *HistoryStore::thread_func(void *args)
+{
+    HistoryStore *store = (HistoryStore *) args;
+
+    store->run();
+
+    return NULL;
+}
+
+void HistoryStore::run(void)
+{
+    unique_lock<mutex> lock(_checkpointMutex);
+
+    while (_running) {
+        if (!_checkpointPending) {
+            _wakeup.wait(lock);
+            continue;
+        }
+        _checkpointPending = false;
+
+        lock.unlock();
+        if (!save(_checkpointPath)) {
+            Logger::get().warn(Logger::CAT_SYSTEM, "unable to save %s",
+                               _checkpointPath);
+        }
+        lock.lock();
+    }
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,147 @@
+/*
+ * HistoryStore.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef HISTORYSTORE_HXX
+#define HISTORYSTORE_HXX
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define HISTORY_RAW_SEC          10
+#define HISTORY_RAW_POINTS       360   // 1 hour of 10-second points
+#define HISTORY_MINUTE_POINTS    1440  // 1 day of 1-minute points
+#define HISTORY_HOUR_POINTS      720   // 30 days of 1-hour points
+#define HISTORY_MAX_SERIES       24
+#define HISTORY_NAME_LEN         16
+#define HISTORY_UNIT_LEN         8
+#define HISTORY_CHECKPOINT_SEC   900
+
+using namespace std;
+
+/*
+ * One aggregated slot: the min, max and mean of the samples that fell
+ * into it. A slot with count 0 holds no data.
+ */
+struct HistoryPoint {
+    float min;
+    float max;
+    float avg;
+    uint32_t count;
+};
+
+/*
+ * A metric kept at three resolutions. Every sample is folded into the
+ * current slot of each tier; the tiers are fixed rings indexed by
+ * (time / period), so slot times are implicit and a gap in the samples
+ * (e.g. across a restart) just leaves empty slots. Samples older than
+ * the newest slot are dropped, which also covers the Pi booting with
+ * its clock at the epoch until NTP syncs.
+ */
+class TimeSeries {
+
+public:
+
+    enum Tier {
+        TIER_RAW = 0,
+        TIER_MINUTE,
+        TIER_HOUR,
+        TIER_COUNT,
+    };
+
+    TimeSeries(const string &name, const string &unit);
+    ~TimeSeries();
+
+    static unsigned int period(Tier tier);
+    static unsigned int points(Tier tier);
+    static const char *tierName(Tier tier);
+    static bool parseTier(const string &s, Tier &tier);
+    static size_t footprint(void);
+
+    const string &name(void) const;
+    const string &unit(void) const;
+
+    void add(time_t t, float value);
+    bool summarize(Tier tier, time_t now, unsigned int span,
+                   HistoryPoint &point) const;
+    void dump(Tier tier, vector<pair<time_t, HistoryPoint> > &points) const;
+
+    bool write(FILE *fp) const;
+    bool read(FILE *fp);
+
+private:
+
+    string _name;
+    string _unit;
+    uint64_t _slot[TIER_COUNT];  // Newest slot, in periods since the epoch
+    vector<HistoryPoint> _ring[TIER_COUNT];
+
+};
+
+/*
+ * A bounded set of time series, checkpointed to disk. The memory used is
+ * fixed when a series is added and capped at HISTORY_MAX_SERIES series
+ * (under 1 MiB in total).
+ */
+class HistoryStore {
+
+public:
+
+    HistoryStore();
+    ~HistoryStore();
+
+    int addSeries(const string &name, const string &unit);
+    int find(const string &name) const;
+    unsigned int size(void) const;
+    size_t footprint(void) const;
+
+    void add(unsigned int index, time_t t, float value);
+
+    string summary(time_t now) const;
+    string describe(unsigned int index, time_t now) const;
+    string dump(unsigned int index, TimeSeries::Tier tier) const;
+
+    bool load(const string &path);
+    bool save(const string &path) const;
+
+    void startCheckpoints(const string &path);
+    void checkpoint(void);
+    void stopCheckpoints(void);
+
+private:
+
+    static void *thread_func(void *);
+    void run(void);
+
+    mutable mutex _mutex;
+    vector<shared_ptr<TimeSeries> > _series;
+
+    string _checkpointPath;
+    bool _checkpointPending;
+    bool _running;
+    shared_ptr<thread> _thread;
+    mutex _checkpointMutex;
+    condition_variable _wakeup;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,161 @@
+/*
+ * HwSim.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <mutex>
+#include <hw.h>
+
+using namespace std;
+
+static mutex hwsim_mutex;
+static unsigned int hwsim_mode[HWSIM_GPIO_COUNT];
+static unsigned int hwsim_level[HWSIM_GPIO_COUNT];
+static bool hwsim_spi_open[HWSIM_SPI_CHANNELS];
+static struct hwsim_stats hwsim_stats;
+
+int pigpio_start(char *addrStr, char *portStr)
+{
+    (void)(addrStr);
+    (void)(portStr);
+
+    return 0;
+}
+
+void pigpio_stop(void)
+{
+
+}
+
+int set_mode(unsigned gpio, unsigned mode)
+{
+    if (gpio >= HWSIM_GPIO_COUNT) {
+        return -1;
+    }
+
+    hwsim_mutex.lock();
+    hwsim_mode[gpio] = mode;
+    hwsim_mutex.unlock();
+
+    return 0;
+}
+
+int gpio_read(unsigned gpio)
+{
+    int level;
+
+    if (gpio >= HWSIM_GPIO_COUNT) {
+        return -1;
+    }
+
+    hwsim_mutex.lock();
+    level = hwsim_level[gpio];
+    hwsim_mutex.unlock();
+
+    return level;
+}
+
+int gpio_write(unsigned gpio, unsigned level)
+{
+    if (gpio >= HWSIM_GPIO_COUNT) {
+        return -1;
+    }
+
+    hwsim_mutex.lock();
+    hwsim_level[gpio] = level ? 1 : 0;
+    hwsim_stats.gpio_writes++;
+    hwsim_mutex.unlock();
+
+    return 0;
+}
+
+int set_bank_1(uint32_t bits)
+{
+    hwsim_mutex.lock();
+    for (unsigned int i = 0; i < 32; i++) {
+        if (bits & (1U << i)) {
+            hwsim_level[i] = 1;
+        }
+    }
+    hwsim_stats.bank_writes++;
+    hwsim_mutex.unlock();
+
+    return 0;
+}
+
+int clear_bank_1(uint32_t bits)
+{
+    hwsim_mutex.lock();
+    for (unsigned int i = 0; i < 32; i++) {
+        if (bits & (1U << i)) {
+            hwsim_level[i] = 0;
+        }
+    }
+    hwsim_stats.bank_writes++;
+    hwsim_mutex.unlock();
+
+    return 0;
+}
+
+int spi_open(unsigned channel, unsigned speed, unsigned flags)
+{
+    (void)(speed);
+    (void)(flags);
+
+    if (channel >= HWSIM_SPI_CHANNELS) {
+        return -1;
+    }
+
+    hwsim_mutex.lock();
+    hwsim_spi_open[channel] = true;
+    hwsim_mutex.unlock();
+
+    return channel;
+}
+
+int spi_close(unsigned handle)
+{
+    if (handle >= HWSIM_SPI_CHANNELS) {
+        return -1;
+    }
+
+    hwsim_mutex.lock();
+    hwsim_spi_open[handle] = false;
+    hwsim_mutex.unlock();
+
+    return 0;
+}
+
+int spi_write(unsigned handle, char *buf, unsigned count)
+{
+    (void)(buf);
+
+    if ((handle >= HWSIM_SPI_CHANNELS) || !hwsim_spi_open[handle]) {
+        return -1;
+    }
+
+    hwsim_mutex.lock();
+    hwsim_stats.spi_writes++;
+    hwsim_stats.spi_bytes += count;
+    hwsim_mutex.unlock();
+
+    return count;
+}
+
+void hwsim_get_stats(struct hwsim_stats *stats)
+{
+    hwsim_mutex.lock();
+    *stats = hwsim_stats;
+    hwsim_mutex.unlock();
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,424 @@
+/*
+ * Json.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <Json.hxx>
+
+#define JSON_MAX_DEPTH  16
+
+JsonValue::JsonValue()
+    : type(JSON_NULL),
+      boolean(false),
+      number(0.0)
+{
+
+}
+
+const JsonValue *JsonValue::get(const string &key) const
+{
+    vector<pair<string, JsonValue> >::const_iterator it;
+
+    if (type != JSON_OBJECT) {
+        return NULL;
+    }
+
+    for (it = object.begin(); it != object.end(); it++) {
+        if (it->first == key) {
+            return &it->second;
+        }
+    }
+
+    return NULL;
+}
+
+string JsonValue::toString(void) const
+{
+    string s;
+    char buf[32];
+
+    switch (type) {
+    case JSON_NULL:
+        s = "null";
+        break;
+    case JSON_BOOL:
+        s = boolean ? "true" : "false";
+        break;
+    case JSON_NUMBER:
+        if ((number == floor(number)) && (fabs(number) < 1e15)) {
+            snprintf(buf, sizeof(buf), "%.0f", number);
+        } else {
+            snprintf(buf, sizeof(buf), "%.17g", number);
+        }
+        s = buf;
+        break;
+    case JSON_STRING:
+        s = quote(str);
+        break;
+    case JSON_ARRAY:
+        s = "[";
+        for (size_t i = 0; i < array.size(); i++) {
+            if (i > 0) {
+                s += ",";
+            }
+            s += array[i].toString();
+        }
+        s += "]";
+        break;
+    case JSON_OBJECT:
+        s = "{";
+        for (size_t i = 0; i < object.size(); i++) {
+            if (i > 0) {
+                s += ",";
+            }
+            s += quote(object[i].first);
+            s += ":";
+            s += object[i].second.toString();
+        }
+        s += "}";
+        break;
+    }
+
+    return s;
+}
+
+string JsonValue::quote(const string &s)
+{
+    string q;
+    char esc[8];
+
+    q.reserve(s.size() + 2);
+    q += '"';
+    for (string::const_iterator it = s.begin(); it != s.end(); it++) {
+        unsigned char c = (unsigned char) *it;
+        if ((c == '"') || (c == '\\')) {
+            q += '\\';
+            q += (char) c;
+        } else if (c == '\n') {
+            q += "\\n";
+        } else if (c < 0x20) {
+            snprintf(esc, sizeof(esc), "\\u%04x", c);
+            q += esc;
+        } else {
+            q += (char) c;
+        }
+    }
+    q += '"';
+
+    return q;
+}
+
+class JsonParser {
+
+public:
+
+    JsonParser(const string &text)
+        : _p(text.c_str()),
+          _end(text.c_str() + text.size()) {
+    }
+
+    bool parseDocument(JsonValue &value, string &error) {
+        skipWhitespace();
+        if (!parseValue(value, 0)) {
+            error = _error;
+            return false;
+        }
+        skipWhitespace();
+        if (_p != _end) {
+            error = "trailing characters";
+            return false;
+        }
+        return true;
+    }
+
+private:
+
+    void skipWhitespace(void) {
+        while ((_p < _end) &&
+               ((*_p == ' ') || (*_p == '\t') ||
+                (*_p == '\r') || (*_p == '\n'))) {
+            _p++;
+        }
+    }
+
+    bool fail(const char *error) {
+        _error = error;
+        return false;
+    }
+
+    bool literal(const char *word) {
+        size_t len = strlen(word);
+
+        if (((size_t) (_end - _p) < len) || (memcmp(_p, word, len) != 0)) {
+            return false;
+        }
+        _p += len;
+        return true;
+    }
+
+    bool parseValue(JsonValue &value, unsigned int depth) {
+        if (depth > JSON_MAX_DEPTH) {
+            return fail("nested too deeply");
+        }
+
+        if (_p >= _end) {
+            return fail("unexpected end of input");
+        }
+
+        switch (*_p) {
+        case '{':
+            return parseObject(value, depth);
+        case '[':
+            return parseArray(value, depth);
+        case '"':
+            value.type = JsonValue::JSON_STRING;
+            return parseString(value.str);
+        case 't':
+            value.type = JsonValue::JSON_BOOL;
+            value.boolean = true;
+            return literal("true") ? true : fail("invalid literal");
+        case 'f':
+            value.type = JsonValue::JSON_BOOL;
+            value.boolean = false;
+            return literal("false") ? true : fail("invalid literal");
+        case 'n':
+            value.type = JsonValue::JSON_NULL;
+            return literal("null") ? true : fail("invalid literal");
+        default:
+            return parseNumber(value);
+        }
+    }
+
+    bool parseNumber(JsonValue &value) {
+        char buf[64];
+        const char *start = _p;
+        char *endp = NULL;
+        size_t len;
+
+        while ((_p < _end) &&
+               (isdigit((unsigned char) *_p) || (*_p == '-') ||
+                (*_p == '+') || (*_p == '.') ||
+                (*_p == 'e') || (*_p == 'E'))) {
+            _p++;
+        }
+
+        len = _p - start;
+        if ((len == 0) || (len >= sizeof(buf))) {
+            return fail("invalid number");
+        }
+
+        memcpy(buf, start, len);
+        buf[len] = '\0';
+        value.type = JsonValue::JSON_NUMBER;
+        value.number = strtod(buf, &endp);
+        if (*endp != '\0') {
+            return fail("invalid number");
+        }
+
+        return true;
+    }
+
+    static void appendUtf8(string &s, unsigned long cp) {
+        if (cp < 0x80) {
+            s += (char) cp;
+        } else if (cp < 0x800) {
+            s += (char) (0xc0 | (cp >> 6));
+            s += (char) (0x80 | (cp & 0x3f));
+        } else if (cp < 0x10000) {
+            s += (char) (0xe0 | (cp >> 12));
+            s += (char) (0x80 | ((cp >> 6) & 0x3f));
+            s += (char) (0x80 | (cp & 0x3f));
+        } else {
+            s += (char) (0xf0 | (cp >> 18));
+            s += (char) (0x80 | ((cp >> 12) & 0x3f));
+            s += (char) (0x80 | ((cp >> 6) & 0x3f));
+            s += (char) (0x80 | (cp & 0x3f));
+        }
+    }
+
+    bool parseHex4(unsigned long &cp) {
+        char buf[5];
+
+        if ((_end - _p) < 4) {
+            return false;
+        }
+        for (unsigned int i = 0; i < 4; i++) {
+            if (!isxdigit((unsigned char) _p[i])) {
+                return false;
+            }
+            buf[i] = _p[i];
+        }
+        buf[4] = '\0';
+        cp = strtoul(buf, NULL, 16);
+        _p += 4;
+
+        return true;
+    }
+
+    bool parseString(string &s) {
+        unsigned long cp, lo;
+
+        _p++;   // opening quote
+        s.clear();
+        while (_p < _end) {
+            char c = *_p++;
+            if (c == '"') {
+                return true;
+            } else if (c != '\\') {
+                s += c;
+                continue;
+            }
+
+            if (_p >= _end) {
+                break;
+            }
+
+            c = *_p++;
+            switch (c) {
+            case '"':
+            case '\\':
+            case '/':
+                s += c;
+                break;
+            case 'b':
+                s += '\b';
+                break;
+            case 'f':
+                s += '\f';
+                break;
+            case 'n':
+                s += '\n';
+                break;
+            case 'r':
+                s += '\r';
+                break;
+            case 't':
+                s += '\t';
+                break;
+            case 'u':
+                if (!parseHex4(cp)) {
+                    return fail("invalid unicode escape");
+                }
+                if ((cp >= 0xd800) && (cp < 0xdc00) &&
+                    ((_end - _p) >= 6) && (_p[0] == '\\') &&
+                    (_p[1] == 'u')) {
+                    _p += 2;
+                    if (!parseHex4(lo) || (lo < 0xdc00) || (lo > 0xdfff)) {
+                        return fail("invalid surrogate pair");
+                    }
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+                }
+                appendUtf8(s, cp);
+                break;
+            default:
+                return fail("invalid escape");
+            }
+        }
+
+        return fail("unterminated string");
+    }
+
+    bool parseArray(JsonValue &value, unsigned int depth) {
+        value.type = JsonValue::JSON_ARRAY;
+        _p++;   // '['
+        skipWhitespace();
+        if ((_p < _end) && (*_p == ']')) {
+            _p++;
+            return true;
+        }
+
+        for (;;) {
+            value.array.push_back(JsonValue());
+            skipWhitespace();
+            if (!parseValue(value.array.back(), depth + 1)) {
+                return false;
+            }
+            skipWhitespace();
+            if (_p >= _end) {
+                return fail("unterminated array");
+            }
+            if (*_p == ',') {
+                _p++;
+            } else if (*_p == ']') {
+                _p++;
+                return true;
+            } else {
+                return fail("expected ',' or ']'");
+            }
+        }
+    }
+
+    bool parseObject(JsonValue &value, unsigned int depth) {
+        string key;
+
+        value.type = JsonValue::JSON_OBJECT;
+        _p++;   // '{'
+        skipWhitespace();
+        if ((_p < _end) && (*_p == '}')) {
+            _p++;
+            return true;
+        }
+
+        for (;;) {
+            skipWhitespace();
+            if ((_p >= _end) || (*_p != '"')) {
+                return fail("expected member name");
+            }
+            if (!parseString(key)) {
+                return false;
+            }
+            skipWhitespace();
+            if ((_p >= _end) || (*_p != ':')) {
+                return fail("expected ':'");
+            }
+            _p++;
+            skipWhitespace();
+            value.object.push_back(make_pair(key, JsonValue()));
+            if (!parseValue(value.object.back().second, depth + 1)) {
+                return false;
+            }
+            skipWhitespace();
+            if (_p >= _end) {
+                return fail("unterminated object");
+            }
+            if (*_p == ',') {
+                _p++;
+            } else if (*_p == '}') {
+                _p++;
+                return true;
+            } else {
+                return fail("expected ',' or '}'");
+            }
+        }
+    }
+
+    const char *_p;
+    const char *_end;
+    string _error;
+
+};
+
+bool JsonValue::parse(const string &text, JsonValue &value, string &error)
+{
+    JsonParser parser(text);
+
+    value = JsonValue();
+
+    return parser.parseDocument(value, error);
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,83 @@
+/*
+ * Json.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef JSON_HXX
+#define JSON_HXX
+
+#include <string>
+#include <vector>
+#include <utility>
+
+using namespace std;
+
+/*
+ * A minimal JSON value and parser, just enough for the control API.
+ */
+class JsonValue {
+
+public:
+
+    enum Type {
+        JSON_NULL,
+        JSON_BOOL,
+        JSON_NUMBER,
+        JSON_STRING,
+        JSON_ARRAY,
+        JSON_OBJECT,
+    };
+
+    JsonValue();
+
+    Type type;
+    bool boolean;
+    double number;
+    string str;
+    vector<JsonValue> array;
+    vector<pair<string, JsonValue> > object;
+
+    inline bool isNull(void) const {
+        return type == JSON_NULL;
+    }
+
+    inline bool isBool(void) const {
+        return type == JSON_BOOL;
+    }
+
+    inline bool isNumber(void) const {
+        return type == JSON_NUMBER;
+    }
+
+    inline bool isString(void) const {
+        return type == JSON_STRING;
+    }
+
+    inline bool isArray(void) const {
+        return type == JSON_ARRAY;
+    }
+
+    inline bool isObject(void) const {
+        return type == JSON_OBJECT;
+    }
+
+    const JsonValue *get(const string &key) const;
+    string toString(void) const;
+
+    static bool parse(const string &text, JsonValue &value, string &error);
+    static string quote(const string &s);
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,151 @@
+/*
+ * LatencyTracer.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <ctime>
+#include <LatencyTracer.hxx>
+
+struct Trace {
+    uint64_t received;
+    uint64_t parsed;
+};
+
+static thread_local Trace trace = { 0, 0, };
+
+LatencyTracer::LatencyTracer()
+{
+
+}
+
+LatencyTracer &LatencyTracer::get(void)
+{
+    static LatencyTracer tracer;
+
+    return tracer;
+}
+
+uint64_t LatencyTracer::nowNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+const char *LatencyTracer::stageName(Stage stage)
+{
+    static const char *names[STAGE_COUNT] = {
+        "parse",
+        "gpio",
+        "gpio-call",
+        "led",
+        "led-lock",
+        "handle",
+    };
+
+    if (stage >= STAGE_COUNT) {
+        return "?";
+    }
+
+    return names[stage];
+}
+
+void LatencyTracer::begin(void)
+{
+    trace.received = nowNs();
+    trace.parsed = 0;
+}
+
+void LatencyTracer::parsed(void)
+{
+    if (trace.received == 0) {
+        return;
+    }
+
+    trace.parsed = nowNs();
+    record(STAGE_PARSE, trace.parsed - trace.received);
+}
+
+void LatencyTracer::gpioWritten(uint64_t callNs)
+{
+    if (trace.received == 0) {
+        return;
+    }
+
+    record(STAGE_GPIO_CALL, callNs);
+    record(STAGE_GPIO, nowNs() - (trace.parsed ? trace.parsed :
+                                  trace.received));
+}
+
+void LatencyTracer::end(void)
+{
+    if (trace.received == 0) {
+        return;
+    }
+
+    record(STAGE_HANDLE, nowNs() - trace.received);
+    trace.received = 0;
+    trace.parsed = 0;
+}
+
+/*
+ * The time the current command finished parsing (or was received), for
+ * hand-off to the render thread; 0 if no command is being traced.
+ */
+uint64_t LatencyTracer::pending(void) const
+{
+    if (trace.received == 0) {
+        return 0;
+    }
+
+    return trace.parsed ? trace.parsed : trace.received;
+}
+
+void LatencyTracer::ledShown(uint64_t parsedNs)
+{
+    record(STAGE_LED, nowNs() - parsedNs);
+}
+
+void LatencyTracer::record(Stage stage, uint64_t ns)
+{
+    if (stage < STAGE_COUNT) {
+        _histograms[stage].add(ns);
+    }
+}
+
+void LatencyTracer::reset(void)
+{
+    for (unsigned int i = 0; i < STAGE_COUNT; i++) {
+        _histograms[i].reset();
+    }
+}
+
+string LatencyTracer::report(bool verbose) const
+{
+    string s;
+
+    for (unsigned int i = 0; i < STAGE_COUNT; i++) {
+        s += stageName((Stage) i);
+        s += ": ";
+        s += _histograms[i].summary();
+        s += "\n";
+        if (verbose) {
+            s += _histograms[i].buckets();
+        }
+    }
+
+    return s;
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,74 @@
+/*
+ * LatencyTracer.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef LATENCYTRACER_HXX
+#define LATENCYTRACER_HXX
+
+#include <stdint.h>
+#include <string>
+#include <Histogram.hxx>
+
+using namespace std;
+
+/*
+ * Follows a chat command from packet receipt to its visible effects:
+ *
+ *   receipt --parse--> parsed --gpio--> relay written
+ *                             --led---> first repaint showing the text
+ *
+ * The trace lives in thread-local state for the duration of
+ * gotTextMessage(); LedMatrix carries it per row until the repaint.
+ * Durations are real elapsed time, independent of Clock.
+ */
+class LatencyTracer {
+
+public:
+
+    enum Stage {
+        STAGE_PARSE = 0,
+        STAGE_GPIO,
+        STAGE_GPIO_CALL,
+        STAGE_LED,
+        STAGE_LED_LOCK,
+        STAGE_HANDLE,
+        STAGE_COUNT,
+    };
+
+    static LatencyTracer &get(void);
+    static uint64_t nowNs(void);
+    static const char *stageName(Stage stage);
+
+    void begin(void);
+    void parsed(void);
+    void gpioWritten(uint64_t callNs);
+    void end(void);
+
+    uint64_t pending(void) const;
+    void ledShown(uint64_t parsedNs);
+    void record(Stage stage, uint64_t ns);
+
+    void reset(void);
+    string report(bool verbose = false) const;
+
+private:
+
+    LatencyTracer();
+
+    Histogram _histograms[STAGE_COUNT];
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,411 @@
+/*
+ * LedLayer.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <cstdio>
+#include <LedLayer.hxx>
+
+LedLayer::LedLayer(unsigned int columns, unsigned int ttl)
+    : _columns(columns),
+      _ttl(ttl),
+      _slowdown(1)
+{
+
+}
+
+LedLayer::~LedLayer()
+{
+
+}
+
+const char *LedLayer::text(void) const
+{
+    return "";
+}
+
+void LedLayer::restart(unsigned int ttl)
+{
+    _ttl = ttl;
+}
+
+bool LedLayer::animated(void) const
+{
+    return false;
+}
+
+bool LedLayer::expired(void) const
+{
+    return false;
+}
+
+uint32_t LedLayer::step(void)
+{
+    return 0;
+}
+
+uint32_t LedLayer::panels(void) const
+{
+    return (1U << _columns) - 1;
+}
+
+unsigned int LedLayer::ttl(void) const
+{
+    return _ttl;
+}
+
+/*
+ * Called once a second; true when the time to live has just run out.
+ * A layer with no time to live stays until it is replaced.
+ */
+bool LedLayer::tick(void)
+{
+    if (_ttl == 0) {
+        return false;
+    }
+
+    _ttl--;
+
+    return _ttl == 0;
+}
+
+unsigned int LedLayer::slowdown(void) const
+{
+    return _slowdown;
+}
+
+void LedLayer::setSlowdown(unsigned int sf)
+{
+    _slowdown = (sf < 1) ? 1 : sf;
+}
+
+TextLayer::TextLayer(unsigned int columns)
+    : LedLayer(columns, 0),
+      _pos(0),
+      _slice(0),
+      _counter(1)
+{
+
+}
+
+TextLayer::TextLayer(const string &text, unsigned int columns,
+                     unsigned int ttl)
+    : LedLayer(columns, ttl),
+      _strip(text),
+      _pos(animated() ? -(int) columns : 0),
+      _slice(0),
+      _counter(1)
+{
+
+}
+
+/*
+ * Renders new text into the layer, which starts over as if new; only
+ * for a layer that nothing shows or queues.
+ */
+void TextLayer::assign(const char *text, size_t len, unsigned int ttl)
+{
+    _strip.assign(text, len);
+    _slowdown = 1;
+    restart(ttl);
+}
+
+const char *TextLayer::kind(void) const
+{
+    return "text";
+}
+
+const char *TextLayer::text(void) const
+{
+    return _strip.text();
+}
+
+/*
+ * Scrolling text starts over from the right.
+ */
+void TextLayer::restart(unsigned int ttl)
+{
+    LedLayer::restart(ttl);
+    _pos = animated() ? -(int) _columns : 0;
+    _slice = 0;
+    _counter = 1;
+}
+
+bool TextLayer::animated(void) const
+{
+    return _strip.length() > _columns;
+}
+
+/*
+ * The text moves one pixel every slowdown-factor frames; after a full
+ * glyph it moves on to the next one, and it starts over from the right
+ * once it has scrolled out on the left.
+ */
+uint32_t TextLayer::step(void)
+{
+    int slice = _slice;
+    int pos = _pos;
+
+    _counter--;
+    if (_counter == 0) {
+        _counter = _slowdown;
+        _slice++;
+    }
+
+    if (slice == 7) {
+        _slice = 0;
+        _pos++;
+        if (_pos > (int) _strip.length()) {
+            _pos = -(int) _columns;
+        }
+    }
+
+    return ((_slice != slice) || (_pos != pos)) ? panels() : 0;
+}
+
+void TextLayer::apply(unsigned int x, uint8_t fb[8]) const
+{
+    const uint8_t *cc = _strip.bitmap(_pos + x);
+    const uint8_t *nc = _strip.bitmap(_pos + x + 1);
+
+    for (unsigned int d = 0; d < 8; d++) {
+        if (!animated()) {
+            fb[d] = cc[d];
+        } else {
+            fb[d] = (uint8_t) ((cc[d] >> _slice) | (nc[d] << (8 - _slice)));
+        }
+    }
+}
+
+VScrollLayer::VScrollLayer(shared_ptr<const LedStrip> strip,
+                           unsigned int columns, unsigned int ttl,
+                           unsigned int hold)
+    : LedLayer(columns, ttl),
+      _strip(strip),
+      _pages((strip->length() + columns - 1) / columns),
+      _page(0),
+      _offset(0),
+      _hold(hold),
+      _counter(hold)
+{
+    if (_pages == 0) {
+        _pages = 1;
+    }
+}
+
+const char *VScrollLayer::kind(void) const
+{
+    return "vscroll";
+}
+
+const char *VScrollLayer::text(void) const
+{
+    return _strip->text();
+}
+
+void VScrollLayer::restart(unsigned int ttl)
+{
+    LedLayer::restart(ttl);
+    _page = 0;
+    _offset = 0;
+    _counter = _hold;
+}
+
+bool VScrollLayer::animated(void) const
+{
+    return _pages > 1;
+}
+
+/*
+ * A page holds for the hold time, then the next one pushes it up and
+ * out one pixel row every slowdown-factor frames.
+ */
+uint32_t VScrollLayer::step(void)
+{
+    if (_counter > 0) {
+        _counter--;
+        return 0;
+    }
+
+    _offset++;
+    if (_offset == 8) {
+        _offset = 0;
+        _page = (_page + 1) % _pages;
+        _counter = _hold;
+    } else {
+        _counter = _slowdown - 1;
+    }
+
+    return panels();
+}
+
+/*
+ * Digit 0 is the bottom pixel row, so moving up is moving to higher
+ * digits.
+ */
+void VScrollLayer::apply(unsigned int x, uint8_t fb[8]) const
+{
+    const uint8_t *cur = _strip->bitmap((_page * _columns) + x);
+    const uint8_t *next =
+        _strip->bitmap((((_page + 1) % _pages) * _columns) + x);
+
+    for (unsigned int d = 0; d < 8; d++) {
+        fb[d] = (d >= _offset) ? cur[d - _offset] : next[d + 8 - _offset];
+    }
+}
+
+ProgressLayer::ProgressLayer(unsigned int percent, unsigned int columns,
+                             unsigned int ttl)
+    : LedLayer(columns, ttl),
+      _percent((percent > 100) ? 100 : percent),
+      _filled((_percent * columns * 8) / 100)
+{
+    snprintf(_label, sizeof(_label), "%u%%", _percent);
+}
+
+const char *ProgressLayer::kind(void) const
+{
+    return "progress";
+}
+
+const char *ProgressLayer::text(void) const
+{
+    return _label;
+}
+
+/*
+ * An outlined bar over the middle six pixel rows; bit 0 is the
+ * leftmost pixel of a panel.
+ */
+void ProgressLayer::apply(unsigned int x, uint8_t fb[8]) const
+{
+    unsigned int k = 0;
+    uint8_t bar, edge = 0;
+
+    if (_filled > x * 8) {
+        k = _filled - (x * 8);
+        if (k > 8) {
+            k = 8;
+        }
+    }
+    bar = (uint8_t) ((1U << k) - 1);
+
+    if (x == 0) {
+        edge |= 0x01;
+    }
+    if (x == _columns - 1) {
+        edge |= 0x80;
+    }
+
+    fb[0] = 0;
+    fb[1] = 0xff;
+    for (unsigned int d = 2; d < 6; d++) {
+        fb[d] = bar | edge;
+    }
+    fb[6] = 0xff;
+    fb[7] = 0;
+}
+
+BlinkLayer::BlinkLayer(unsigned int columns, unsigned int onFrames,
+                       unsigned int offFrames, unsigned int ttl)
+    : LedLayer(columns, ttl),
+      _onFrames((onFrames < 1) ? 1 : onFrames),
+      _offFrames((offFrames < 1) ? 1 : offFrames),
+      _counter(_onFrames),
+      _on(true)
+{
+
+}
+
+const char *BlinkLayer::kind(void) const
+{
+    return "blink";
+}
+
+bool BlinkLayer::animated(void) const
+{
+    return true;
+}
+
+uint32_t BlinkLayer::step(void)
+{
+    _counter--;
+    if (_counter > 0) {
+        return 0;
+    }
+
+    _on = !_on;
+    _counter = _on ? _onFrames : _offFrames;
+
+    return panels();
+}
+
+void BlinkLayer::apply(unsigned int x, uint8_t fb[8]) const
+{
+    (void) x;
+
+    if (!_on) {
+        for (unsigned int d = 0; d < 8; d++) {
+            fb[d] = 0;
+        }
+    }
+}
+
+FlashLayer::FlashLayer(unsigned int columns, unsigned int frames)
+    : LedLayer(columns, 0),
+      _frames((frames < 1) ? 1 : frames)
+{
+
+}
+
+/*
+ * Flashes again from the start, e.g. while it is still flashing.
+ */
+void FlashLayer::rearm(unsigned int frames)
+{
+    _frames = (frames < 1) ? 1 : frames;
+}
+
+const char *FlashLayer::kind(void) const
+{
+    return "flash";
+}
+
+bool FlashLayer::animated(void) const
+{
+    return true;
+}
+
+bool FlashLayer::expired(void) const
+{
+    return _frames == 0;
+}
+
+uint32_t FlashLayer::step(void)
+{
+    if (_frames > 0) {
+        _frames--;
+    }
+
+    return (_frames == 0) ? panels() : 0;
+}
+
+void FlashLayer::apply(unsigned int x, uint8_t fb[8]) const
+{
+    (void) x;
+
+    for (unsigned int d = 0; d < 8; d++) {
+        fb[d] ^= 0xff;
+    }
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,200 @@
+/*
+ * LedLayer.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef LEDLAYER_HXX
+#define LEDLAYER_HXX
+
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <StripCache.hxx>
+
+using namespace std;
+
+/*
+ * One layer of an LED row. A row has a content layer (text, vertical
+ * ticker or progress bar) and any number of effect layers stacked on
+ * top (blink, inverse flash); a panel is composed by applying every
+ * layer to it, bottom first.
+ *
+ * The render thread calls step() once per frame on animated layers
+ * only. It returns a bitmask of the panels (bit x for column x) whose
+ * pixels changed, so only those are recomposed and repainted; a static
+ * layer is never stepped and costs nothing per frame.
+ *
+ * The time to live is in seconds and counted down by tick(); the
+ * slowdown factor is the number of frames per animation step. A content
+ * layer shown again is restart()ed rather than built anew. text() is
+ * what the status shows for the layer and lives as long as it does.
+ */
+class LedLayer {
+
+public:
+
+    LedLayer(unsigned int columns, unsigned int ttl);
+    virtual ~LedLayer();
+
+    virtual const char *kind(void) const = 0;
+    virtual const char *text(void) const;
+    virtual void restart(unsigned int ttl);
+    virtual bool animated(void) const;
+    virtual bool expired(void) const;
+    virtual uint32_t step(void);
+    virtual void apply(unsigned int x, uint8_t fb[8]) const = 0;
+
+    uint32_t panels(void) const;
+    unsigned int ttl(void) const;
+    bool tick(void);
+    unsigned int slowdown(void) const;
+    void setSlowdown(unsigned int sf);
+
+protected:
+
+    unsigned int _columns;
+    unsigned int _ttl;
+    unsigned int _slowdown;
+
+};
+
+/*
+ * Text that fits is static; longer text scrolls right to left. The text
+ * is rendered into the layer itself, so a row can keep a few of them and
+ * assign() new text to one that nothing shows or queues any more.
+ */
+class TextLayer : public LedLayer {
+
+public:
+
+    TextLayer(unsigned int columns);
+    TextLayer(const string &text, unsigned int columns, unsigned int ttl);
+
+    void assign(const char *text, size_t len, unsigned int ttl);
+
+    const char *kind(void) const;
+    const char *text(void) const;
+    void restart(unsigned int ttl);
+    bool animated(void) const;
+    uint32_t step(void);
+    void apply(unsigned int x, uint8_t fb[8]) const;
+
+private:
+
+    LedStrip _strip;
+    int _pos;
+    int _slice;
+    unsigned int _counter;
+
+};
+
+/*
+ * Text cut into pages of one row's width; each page scrolls up into
+ * view and holds for a while before the next one follows.
+ */
+class VScrollLayer : public LedLayer {
+
+public:
+
+    VScrollLayer(shared_ptr<const LedStrip> strip, unsigned int columns,
+                 unsigned int ttl, unsigned int hold);
+
+    const char *kind(void) const;
+    const char *text(void) const;
+    void restart(unsigned int ttl);
+    bool animated(void) const;
+    uint32_t step(void);
+    void apply(unsigned int x, uint8_t fb[8]) const;
+
+private:
+
+    shared_ptr<const LedStrip> _strip;
+    unsigned int _pages;
+    unsigned int _page;
+    unsigned int _offset;        // Rows scrolled towards the next page
+    unsigned int _hold;
+    unsigned int _counter;
+
+};
+
+/*
+ * A horizontal bar across the whole row, filled left to right.
+ */
+class ProgressLayer : public LedLayer {
+
+public:
+
+    ProgressLayer(unsigned int percent, unsigned int columns,
+                  unsigned int ttl);
+
+    const char *kind(void) const;
+    const char *text(void) const;
+    void apply(unsigned int x, uint8_t fb[8]) const;
+
+private:
+
+    unsigned int _percent;
+    unsigned int _filled;        // Pixels
+    char _label[8];              // "100%"
+
+};
+
+/*
+ * Blanks everything below it every other phase.
+ */
+class BlinkLayer : public LedLayer {
+
+public:
+
+    BlinkLayer(unsigned int columns, unsigned int onFrames,
+               unsigned int offFrames, unsigned int ttl);
+
+    const char *kind(void) const;
+    bool animated(void) const;
+    uint32_t step(void);
+    void apply(unsigned int x, uint8_t fb[8]) const;
+
+private:
+
+    unsigned int _onFrames;
+    unsigned int _offFrames;
+    unsigned int _counter;
+    bool _on;
+
+};
+
+/*
+ * Inverts everything below it for a number of frames, then expires.
+ */
+class FlashLayer : public LedLayer {
+
+public:
+
+    FlashLayer(unsigned int columns, unsigned int frames);
+
+    void rearm(unsigned int frames);
+
+    const char *kind(void) const;
+    bool animated(void) const;
+    bool expired(void) const;
+    uint32_t step(void);
+    void apply(unsigned int x, uint8_t fb[8]) const;
+
+private:
+
+    unsigned int _frames;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -8,66 +8,158 @@
 #include <stdio.h>
 #include <time.h>
 #include <unistd.h>
-#include <pigpiod_if.h>
+#include <cctype>
 #include <climits>
 #include <cstring>
 #include <iostream>
-#include <font8x8/font8x8.h>
 #include <max7219_defs.h>
 #include <LedMatrix.hxx>
+#include <StripCache.hxx>
+#include <LiveValues.hxx>
+#include <StatusModel.hxx>
+#include <Clock.hxx>
+#include <LatencyTracer.hxx>
+#include <ThreadConfig.hxx>
+#include <Logger.hxx>
+
+extern shared_ptr<StatusModel> statusModel;
+
+// Modules are re-initialized one at a time, one every this many repaints,
+// in case one picked up a glitch
+#define MAX7219_SETUP_REPAINTS  40
+
+LedMatrix::LedMatrix(const vector<LedChainConfig> &chains)
+  : _repaints(0),
+    _hold(0),
+    _power(POWER_ACTIVE),
+    _powerForced(false),
+    _offUntil(0),
+    _cap(15),
+    _lastActivity(Clock::get()->monotonicSec()),
+    _frameLast(0),
+    _heartbeat("render", LED_HEARTBEAT_MS)
+{
+    string error;
 
-#define MAX7219_SPI_CHAN   0
-#define MAX7219_SPI_SPEED  1000000
-#define MAX7219_SPI_MODE                    \
-    PI_SPI_FLAGS_BITLEN(0)   |              \
-    PI_SPI_FLAGS_RX_LSB(0)   |              \
-    PI_SPI_FLAGS_TX_LSB(0)   |              \
-    PI_SPI_FLAGS_3WREN(0)    |              \
-    PI_SPI_FLAGS_3WIRE(0)    |              \
-    PI_SPI_FLAGS_AUX_SPI(0)  |              \
-    PI_SPI_FLAGS_RESVD(0)    |              \
-    PI_SPI_FLAGS_CSPOLS(0)   |              \
-    PI_SPI_FLAGS_MODE(0)
-
-LedMatrix::LedMatrix()
-  : _intensity(1),
-    _fb()
-{
-    _handle = spi_open(MAX7219_SPI_CHAN, MAX7219_SPI_SPEED, MAX7219_SPI_MODE);
-    if (_handle < 0) {
-        cerr << "spiOpen failed!" << endl;
+    if (!validate(chains, error)) {
+        Logger::get().error(Logger::CAT_LED, "%s", error);
         exit(EXIT_FAILURE);
     }
 
-    writeMax7219(DECODE_MODE_REG, 0);
-    writeMax7219(INTENSITY_REG, _intensity);
-    writeMax7219(SCAN_LIMIT_REG, 7);
-    writeMax7219(SHUTDOWN_REG, 1);
-    writeMax7219(DISPLAY_TEST_REG, 0);
-    writeMax7219(DIGIT0_REG, 0);
-    writeMax7219(DIGIT1_REG, 0);
-    writeMax7219(DIGIT2_REG, 0);
-    writeMax7219(DIGIT3_REG, 0);
-    writeMax7219(DIGIT4_REG, 0);
-    writeMax7219(DIGIT5_REG, 0);
-    writeMax7219(DIGIT6_REG, 0);
-    writeMax7219(DIGIT7_REG, 0);
-
     setDelay(25);
-    for (unsigned y = 0; y < MAX7219_Y_COUNT; y++) {
-        setText(y, "");
-        setSlowdownFactor(y, y + 1);
+    _powerConfig = LedPowerConfig();
+
+    _chains.resize(chains.size());
+    for (unsigned int c = 0; c < chains.size(); c++) {
+        Chain &chain = _chains[c];
+
+        chain.config = chains[c];
+        chain.spi = make_shared<Max7219Chain>(
+            chains[c].spi, chains[c].columns * chains[c].rows);
+        chain.rows.resize(chains[c].rows);
+        chain.fb.assign(chains[c].columns * chains[c].rows * 8, 0);
+        chain.generation = 0;
+        chain.spiFullBytes = 0;
+        chain.setupNext = 0;
+
+        // The digit, intensity and shutdown registers follow with the
+        // first repaint
+        for (unsigned int m = 0; m < chain.spi->modules(); m++) {
+            chain.spi->setup(m);
+        }
+        chain.spi->flush();
+
+        for (unsigned int y = 0; y < chain.rows.size(); y++) {
+            Row &row = chain.rows[y];
+
+            // Everything a message or a relay state needs is allocated
+            // here, once
+            for (unsigned int i = 0; i < LED_ROW_SLOTS; i++) {
+                row.slots.push_back(
+                    make_shared<TextLayer>(chain.config.columns));
+            }
+            row.flash = make_shared<FlashLayer>(chain.config.columns, 1);
+            row.effects.reserve(LED_MAX_EFFECTS);
+            row.intensity = 1;
+            row.bound = false;
+            row.stale = (1U << chain.config.columns) - 1;
+            setText(c, y, "");
+            setSlowdownFactor(c, y, y + 1);
+        }
     }
+
+    LiveValues::get().listen(LedMatrix::sourcesChanged, this);
 }
 
 LedMatrix::~LedMatrix()
 {
+    LiveValues::get().unlisten(this);
     stop();
+}
+
+vector<LedChainConfig> LedMatrix::defaults(void)
+{
+    vector<LedChainConfig> chains(1);
+
+    chains[0].name = "main";
+    chains[0].spi = 0;
+    chains[0].columns = MAX7219_X_COUNT;
+    chains[0].rows = MAX7219_Y_COUNT;
+
+    return chains;
+}
+
+bool LedMatrix::validate(const vector<LedChainConfig> &chains,
+                         string &error)
+{
+    unsigned int c, k;
 
-    if (_handle >= 0) {
-        spi_close(_handle);
-        _handle = -1;
+    if (chains.empty() || (chains.size() > LED_MAX_CHAINS)) {
+        error = "there must be 1 to " + to_string(LED_MAX_CHAINS) +
+            " LED chains";
+        return false;
     }
+
+    for (c = 0; c < chains.size(); c++) {
+        const LedChainConfig &chain = chains[c];
+
+        if (chain.name.empty() || (chain.name.size() > LED_MAX_NAME) ||
+            isdigit((unsigned char) chain.name[0])) {
+            error = "LED chain name '" + chain.name + "' is invalid";
+            return false;
+        }
+        for (k = 0; k < chain.name.size(); k++) {
+            char ch = chain.name[k];
+            if (!islower((unsigned char) ch) &&
+                !isdigit((unsigned char) ch) &&
+                (ch != '-') && (ch != '_')) {
+                error = "LED chain name '" + chain.name + "' is invalid";
+                return false;
+            }
+        }
+        if (chain.spi >= LED_MAX_CHAINS) {
+            error = "LED chain '" + chain.name + "': spi must be 0 or 1";
+            return false;
+        }
+        if ((chain.columns == 0) || (chain.columns > LED_MAX_COLUMNS) ||
+            (chain.rows == 0) || (chain.rows > LED_MAX_ROWS)) {
+            error = "LED chain '" + chain.name + "': geometry is invalid";
+            return false;
+        }
+        for (k = 0; k < c; k++) {
+            if (chains[k].name == chain.name) {
+                error = "LED chain '" + chain.name + "' is duplicated";
+                return false;
+            }
+            if (chains[k].spi == chain.spi) {
+                error = "LED chain '" + chain.name + "': spi " +
+                    to_string(chain.spi) + " is in use";
+                return false;
+            }
+        }
+    }
+
+    return true;
 }
 
 void LedMatrix::start(void)
@@ -80,7 +172,10 @@ void LedMatrix::start(void)
 
 void LedMatrix::stop(void)
 {
+    _mutex.lock();
     _running = false;
+    _wakeup.notify_all();
+    _mutex.unlock();
 }
 
 void LedMatrix::join(void)
@@ -96,6 +191,7 @@ void *LedMatrix::thread_func(void *args)
 {
     LedMatrix *matrix = (LedMatrix *) args;
 
+    ThreadConfig::get().apply(ThreadConfig::ROLE_RENDER);
     matrix->run();
 
     return NULL;
@@ -103,332 +199,1471 @@ void *LedMatrix::thread_func(void *args)
 
 void LedMatrix::run(void)
 {
-    unsigned int cycle;
-    int x, y, slice;
-    int i;
-    char cc, nc;
-    const uint8_t *cl, *nl;
-    bool scroll;
-    time_t tlast, tnow;
+    uint64_t tlast, tnow, tframe;
+    unsigned int ms;
 
-    tlast = tnow = time(NULL);
+    tlast = tnow = Clock::get()->monotonicSec();
 
-    for (cycle = 0; _running; cycle++) {
+    while (_running) {
+        if (sleepOff()) {
+            // Time stands still for the signs while they are off
+            tlast = Clock::get()->monotonicSec();
+            _frameLast = 0;
+            continue;
+        }
 
-        for (y = 0; y < MAX7219_Y_COUNT; y++) {
+        // Frame period is wakeup to wakeup, so it shows scheduling jitter
+        tframe = Clock::get()->monotonicNs();
+        if (_frameLast != 0) {
+            _framePeriod.add(tframe - _frameLast);
+        }
+        _frameLast = tframe;
+        _heartbeat.beat();
 
-            slice = _slice[y];
+        for (unsigned int c = 0; c < _chains.size(); c++) {
+            compose(_chains[c]);
+        }
 
-            if (_text[y].size() <= MAX7219_X_COUNT) {
-                scroll = false;
-            } else {
-                scroll = true;
-            }
+        // Catch up on every elapsed second, even if the clock jumped
+        tnow = Clock::get()->monotonicSec();
+        while (tlast < tnow) {
+            tlast++;
+            tick();
+        }
 
-            for (x = 0; x < MAX7219_X_COUNT; x++) {
-                i = _pos[y] + x;
+        if (_hold == 0) {
+            repaint();
+        }
 
-                if ((i >= 0) && (i < (int) _text[y].size())) {
-                    cc = _text[y][i];
-                } else {
-                    cc = ' ';
-                }
+        // A long frame delay set from the shell is not a stall
+        ms = _delay;
+        _heartbeat.setTimeoutMs(LED_HEARTBEAT_MS + 2 * ms);
+        Clock::get()->sleepUs(ms * 1000);
+    }
 
-                if ((i >= -1) && (i < (int) (_text[y].size() - 1))) {
-                    nc = _text[y][i + 1];
-                } else {
-                    nc = ' ';
-                }
+    _heartbeat.park();
 
-                if (!scroll) {
-                    cl = (const uint8_t *) font8x8_basic[cc % 128];
+    _mutex.lock();
+    for (unsigned int c = 0; c < _chains.size(); c++) {
+        _chains[c].spi->broadcast(SHUTDOWN_REG, 0);
+    }
+    for (unsigned int c = 0; c < _chains.size(); c++) {
+        _chains[c].spi->flush();
+    }
+    _mutex.unlock();
+}
 
-                    draw(y, x, cl);
-                } else {
-                    cl = (const uint8_t *) font8x8_basic[cc % 128];
-                    nl = (const uint8_t *) font8x8_basic[nc % 128];
+const Histogram &LedMatrix::framePeriod(void) const
+{
+    return _framePeriod;
+}
 
-                    drawSR(y, x, slice, true, cl);
-                    drawSL(y, x, 8 - slice, false, nl);
-                }
-            }
+void LedMatrix::resetFramePeriod(void)
+{
+    _framePeriod.reset();
+}
 
-            _counter[y]--;
+unsigned int LedMatrix::chainCount(void) const
+{
+    return _chains.size();
+}
 
-            if (_counter[y] == 0) {
-                _counter[y] = _reload[y];
-                _slice[y]++;
-            }
+int LedMatrix::findChain(const string &name) const
+{
+    for (unsigned int c = 0; c < _chains.size(); c++) {
+        if (_chains[c].config.name == name) {
+            return (int) c;
+        }
+    }
 
-            if (slice == 7) {
-                _slice[y] = 0;
+    return -1;
+}
 
-                if (_text[y].size() > MAX7219_X_COUNT) {
-                    _pos[y]++;
-                }
+const string &LedMatrix::chainName(unsigned int c) const
+{
+    static const string none;
 
-                if (_pos[y] > (int) _text[y].size()) {
-                    _pos[y] = -MAX7219_X_COUNT;
-                }
-            }
-        }
+    return (c < _chains.size()) ? _chains[c].config.name : none;
+}
 
-        tnow = time(NULL);
-        if (tnow != tlast) {
-            tlast = tnow;
-            for (y = 0; y < MAX7219_Y_COUNT; y++) {
-                if (_ttl[y] > 0) {
-                    _ttl[y]--;
-                    if (_ttl[y] == 0) {
-                        setText(y, _welcome[y], 0);
-                    }
-                }
+unsigned int LedMatrix::rows(unsigned int c) const
+{
+    return (c < _chains.size()) ? _chains[c].config.rows : 0;
+}
+
+unsigned int LedMatrix::columns(unsigned int c) const
+{
+    return (c < _chains.size()) ? _chains[c].config.columns : 0;
+}
+
+/*
+ * A row is given as "<row>" on the main sign, or as "<chain>:<row>"
+ * where the chain is its name or index.
+ */
+bool LedMatrix::parseRow(const string &arg, unsigned int &c,
+                         unsigned int &y) const
+{
+    size_t colon = arg.find(':');
+    string chain, row;
+    int found;
+
+    if (colon == string::npos) {
+        c = 0;
+        row = arg;
+    } else {
+        chain = arg.substr(0, colon);
+        row = arg.substr(colon + 1);
+        found = findChain(chain);
+        if (found < 0) {
+            try {
+                found = stoi(chain);
+            } catch (const invalid_argument &e) {
+                return false;
+            } catch (const out_of_range &e) {
+                return false;
             }
         }
+        if ((found < 0) || ((unsigned int) found >= _chains.size())) {
+            return false;
+        }
+        c = (unsigned int) found;
+    }
 
-        repaint();
-        usleep(_delay * 1000);
+    try {
+        found = stoi(row);
+    } catch (const invalid_argument &e) {
+        return false;
+    } catch (const out_of_range &e) {
+        return false;
+    }
+    if ((found < 0) || ((unsigned int) found >= _chains[c].rows.size())) {
+        return false;
     }
+    y = (unsigned int) found;
 
-    writeMax7219(SHUTDOWN_REG, 0);
+    return true;
 }
 
-int LedMatrix::writeMax7219(const void *data, size_t size)
+string LedMatrix::rowName(unsigned int c, unsigned int y) const
 {
-    int ret;
-
-    ret = spi_write(_handle, (char *) data, size);
-    if (ret != (int) size) {
-        cerr << "spi_write failed!" << endl;
+    if (c == 0) {
+        return to_string(y);
     }
 
-    return ret;
+    return chainName(c) + ":" + to_string(y);
+}
+
+/*
+ * Steps the animated layers of every row and recomposes the panels
+ * they changed, bottom layer first. Rows with only static layers are
+ * skipped.
+ */
+void LedMatrix::compose(Chain &chain)
+{
+    vector<shared_ptr<LedLayer> >::iterator it;
+    unsigned int x, y;
+    uint8_t buf[8], *p;
+    bool changed = false;
+
+    _mutex.lock();
+    for (y = 0; y < chain.rows.size(); y++) {
+        Row &row = chain.rows[y];
+
+        // Traced text changes are shown by the repaint that follows
+        if (row.tracePending != 0) {
+            row.traceComposed = row.tracePending;
+            row.tracePending = 0;
+        }
+
+        if (row.content && row.content->animated()) {
+            row.dirty |= row.content->step();
+        }
+        for (it = row.effects.begin(); it != row.effects.end(); ) {
+            if ((*it)->animated()) {
+                row.dirty |= (*it)->step();
+            }
+            if ((*it)->expired()) {
+                it = row.effects.erase(it);
+                row.dirty = (1U << chain.config.columns) - 1;
+            } else {
+                it++;
+            }
+        }
+
+        if (row.dirty == 0) {
+            continue;
+        }
+
+        for (x = 0; x < chain.config.columns; x++) {
+            if ((row.dirty & (1U << x)) == 0) {
+                continue;
+            }
+
+            memset(buf, 0, sizeof(buf));
+            if (row.content) {
+                row.content->apply(x, buf);
+            }
+            for (it = row.effects.begin(); it != row.effects.end(); it++) {
+                (*it)->apply(x, buf);
+            }
+
+            p = &chain.fb[((y * chain.config.columns) + x) * 8];
+            if (memcmp(p, buf, sizeof(buf)) != 0) {
+                memcpy(p, buf, sizeof(buf));
+                row.stale |= (1U << x);
+                changed = true;
+            }
+        }
+        row.dirty = 0;
+    }
+    if (changed) {
+        chain.generation++;
+    }
+    _mutex.unlock();
 }
 
-int LedMatrix::writeMax7219(uint8_t reg, uint8_t data)
+/*
+ * Counts down the time to live of the message each row shows and of
+ * its effects. A message that runs out is shown again later if it has
+ * repeats left and the row moves on to its next message, or else to its
+ * resting content or binding; an effect is removed. Nothing is rendered
+ * again for that.
+ *
+ * Time stands still for the signs while they are off, and a tick only
+ * looks for the end of the off hours on the clock that drives it.
+ */
+void LedMatrix::tick(void)
 {
-    int ret;
-    unsigned int i;
-    char xmit[MAX7219_X_COUNT * MAX7219_Y_COUNT * 2];
+    vector<shared_ptr<LedLayer> >::iterator it;
+    vector<pair<unsigned int, unsigned int> > rebound;
+    vector<pair<unsigned int, string> > shown;
+    unsigned int c, y;
+
+    _mutex.lock();
+    if (_power == POWER_OFF) {
+        if (!_powerForced && (_offUntil != 0) &&
+            (Clock::get()->wallTime() >= _offUntil)) {
+            setPower(powerPolicy());
+        }
+        _mutex.unlock();
+        return;
+    }
+    for (c = 0; c < _chains.size(); c++) {
+        for (y = 0; y < _chains[c].rows.size(); y++) {
+            Row &row = _chains[c].rows[y];
+
+            // Only messages have a time to live
+            if (row.content && row.content->tick()) {
+                row.queue.expire();
+                if (row.queue.empty() && row.binding && !row.bound) {
+                    rebound.push_back(make_pair(c, y));
+                } else if (present(row, _chains[c].config.columns) &&
+                           (c == 0)) {
+                    shown.push_back(make_pair(y, row.content->text()));
+                }
+            }
+            for (it = row.effects.begin(); it != row.effects.end(); ) {
+                if ((*it)->tick()) {
+                    it = row.effects.erase(it);
+                    row.dirty = (1U << _chains[c].config.columns) - 1;
+                } else {
+                    it++;
+                }
+            }
+        }
+    }
+    _mutex.unlock();
 
-    for (i = 0; i < (MAX7219_X_COUNT * MAX7219_Y_COUNT); i++) {
-        xmit[i * 2 + 0] = reg;
-        xmit[i * 2 + 1] = data;
+    for (unsigned int i = 0; statusModel && (i < shown.size()); i++) {
+        statusModel->setLedText(shown[i].first, shown[i].second.c_str());
+    }
+    for (unsigned int i = 0; i < rebound.size(); i++) {
+        showBinding(rebound[i].first, rebound[i].second, true);
     }
 
-    ret = spi_write(_handle, xmit, sizeof(xmit));
-    if (ret != sizeof(xmit)) {
-        cerr << "spi_write failed!" << endl;
+    _mutex.lock();
+    if (!_powerForced) {
+        setPower(powerPolicy());
     }
+    _mutex.unlock();
+}
 
-    return ret;
+/*
+ * Module index in the chain of the panel at row y, column x: rows are
+ * chained top to bottom, each from its rightmost panel.
+ */
+unsigned int LedMatrix::module(const Chain &chain, unsigned int y,
+                               unsigned int x)
+{
+    return (y * chain.config.columns) + (chain.config.columns - 1 - x);
 }
 
-unsigned int LedMatrix::intensity(void) const
+unsigned int LedMatrix::intensity(unsigned int y) const
 {
-    return _intensity;
+    return intensity(0, y);
 }
 
-void LedMatrix::setIntensity(unsigned int intensity)
+unsigned int LedMatrix::intensity(unsigned int c, unsigned int y) const
 {
-    _intensity = intensity;
-    writeMax7219(INTENSITY_REG, _intensity);
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        return 0;
+    }
+
+    return _chains[c].rows[y].intensity;
 }
 
-void LedMatrix::clear(void)
+void LedMatrix::setIntensity(unsigned int intensity)
 {
-    for (unsigned int y = 0; y < MAX7219_Y_COUNT; y++) {
-        setText(y, "");
+    for (unsigned int c = 0; c < _chains.size(); c++) {
+        for (unsigned int y = 0; y < _chains[c].rows.size(); y++) {
+            setIntensity(c, y, intensity);
+        }
     }
 }
 
-void LedMatrix::setText(unsigned int y, const string &text,
-                        unsigned int ttl)
+void LedMatrix::setIntensity(unsigned int y, unsigned int intensity)
+{
+    setIntensity(0, y, intensity);
+}
+
+/*
+ * Takes effect with the next repaint.
+ */
+void LedMatrix::setIntensity(unsigned int c, unsigned int y,
+                             unsigned int intensity)
 {
-    if (y >= MAX7219_Y_COUNT) {
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
         return;
     }
 
-    _mutex.lock();
-    _text[y] = text;
-    _ttl[y] = ttl;
-    if (_welcome[y].empty()) {
-        _welcome[y] = text;
-        _ttl[y] = 0;
-    }
-    if (text.size() <= MAX7219_X_COUNT) {
-        _pos[y] = 0;
-        _slice[y] = 0;
-    } else {
-        _pos[y] = -MAX7219_X_COUNT;
-        _slice[y] = 0;
+    if (intensity > 15) {
+        intensity = 15;
     }
+
+    _mutex.lock();
+    _chains[c].rows[y].intensity = intensity;
+    _chains[c].rows[y].stale = (1U << _chains[c].config.columns) - 1;
+    activity();
     _mutex.unlock();
 }
 
-void LedMatrix::setWelcomeText(void)
+void LedMatrix::reinit(void)
 {
-    for (unsigned int y = 0; y < MAX7219_Y_COUNT; y++) {
-        setText(y, _welcome[y]);
+    _mutex.lock();
+    for (unsigned int c = 0; c < _chains.size(); c++) {
+        for (unsigned int m = 0; m < _chains[c].spi->modules(); m++) {
+            _chains[c].spi->setup(m);
+        }
+        for (unsigned int y = 0; y < _chains[c].rows.size(); y++) {
+            _chains[c].rows[y].stale = (1U << _chains[c].config.columns) - 1;
+        }
     }
+    _mutex.unlock();
 }
 
-void LedMatrix::setWelcomeText(unsigned int y, const string &text, bool apply)
+void LedMatrix::setPowerConfig(const LedPowerConfig &config)
 {
-    if (y >= MAX7219_Y_COUNT) {
-        return;
+    _mutex.lock();
+    _powerConfig = config;
+    if (_powerConfig.dimIntensity > 15) {
+        _powerConfig.dimIntensity = 15;
     }
+    _powerConfig.offFrom %= 24;
+    _powerConfig.offUntil %= 24;
+    _mutex.unlock();
+}
+
+LedPowerConfig LedMatrix::powerConfig(void) const
+{
+    LedPowerConfig config;
 
     _mutex.lock();
-    _welcome[y] = text;
+    config = _powerConfig;
     _mutex.unlock();
 
-    if (apply) {
-        setText(y, text);
-    }
+    return config;
 }
 
-unsigned int LedMatrix::ttl(unsigned int y) const
+LedMatrix::Power LedMatrix::power(void) const
 {
-    if (y >= MAX7219_Y_COUNT) {
-        return 0;
-    }
+    Power power;
+
+    _mutex.lock();
+    power = _power;
+    _mutex.unlock();
 
-    return _ttl[y];
+    return power;
 }
 
+bool LedMatrix::powerForced(void) const
+{
+    bool forced;
 
-void LedMatrix::setDelay(unsigned int ms)
+    _mutex.lock();
+    forced = _powerForced;
+    _mutex.unlock();
+
+    return forced;
+}
+
+/*
+ * Holds the signs in a power state until releasePower(); new content
+ * does not wake them meanwhile.
+ */
+void LedMatrix::forcePower(Power power)
 {
-    _delay = ms;
+    _mutex.lock();
+    _powerForced = true;
+    setPower(power);
+    _mutex.unlock();
 }
 
-unsigned int LedMatrix::delay(void) const
+void LedMatrix::releasePower(void)
 {
-    return _delay;
+    _mutex.lock();
+    _powerForced = false;
+    _lastActivity = Clock::get()->monotonicSec();
+    setPower(powerPolicy());
+    _mutex.unlock();
 }
 
-void LedMatrix::setSlowdownFactor(unsigned int y, unsigned int sf)
+unsigned int LedMatrix::idleSeconds(void) const
 {
-    if (y >= MAX7219_Y_COUNT) {
-        return;
-    }
+    uint64_t idle;
 
-    if (sf < 1) {
-        sf = 1;
-    }
+    _mutex.lock();
+    idle = Clock::get()->monotonicSec() - _lastActivity;
+    _mutex.unlock();
 
-    _reload[y] = sf;
-    _counter[y] = sf;
+    return (unsigned int) idle;
 }
 
-unsigned int LedMatrix::slowdownFactor(unsigned int y) const
+const char *LedMatrix::powerName(Power power)
 {
-    if (y >= MAX7219_Y_COUNT) {
-        return 1;
+    switch (power) {
+    case POWER_ACTIVE:
+        return "active";
+    case POWER_DIM:
+        return "dim";
+    case POWER_OFF:
+        return "off";
     }
 
-    return _reload[y];
+    return "?";
 }
 
-void LedMatrix::draw(unsigned int y, unsigned int x, const uint8_t fb[8])
+/*
+ * New content wakes the signs at full intensity by the next frame.
+ * Called with the mutex held.
+ */
+void LedMatrix::activity(void)
 {
-    if (y >= MAX7219_Y_COUNT) {
-        return;
+    _lastActivity = Clock::get()->monotonicSec();
+    if (!_powerForced) {
+        setPower(POWER_ACTIVE);
     }
+}
 
-    if (x >= MAX7219_X_COUNT) {
-        return;
+/*
+ * Waking up is immediate and only dimming is ramped; a sign that was
+ * off is repainted in full, which also takes its panels out of
+ * shutdown. Called with the mutex held.
+ */
+void LedMatrix::setPower(Power power)
+{
+    unsigned int left;
+
+    // Staying off may still move the end of the off hours, which the
+    // sleeping render thread then picks up
+    if (power == POWER_OFF) {
+        left = offHoursLeft();
+        _offUntil = (left > 0) ? Clock::get()->wallTime() + left : 0;
+        _wakeup.notify_all();
     }
-
-    if (fb == NULL) {
+    if (power == _power) {
         return;
     }
 
-    _mutex.lock();
-    for (unsigned int i = 0; i < 8; i++) {
-        _fb[y][x][i] = fb[i];
+    if ((power == POWER_ACTIVE) || (_power == POWER_OFF)) {
+        _cap = (power == POWER_DIM) ? _powerConfig.dimIntensity : 15;
+        for (unsigned int c = 0; c < _chains.size(); c++) {
+            for (unsigned int y = 0; y < _chains[c].rows.size(); y++) {
+                _chains[c].rows[y].stale =
+                    (1U << _chains[c].config.columns) - 1;
+            }
+        }
     }
-    _mutex.unlock();
+
+    Logger::get().info(Logger::CAT_LED, "display %s -> %s",
+                       powerName(_power), powerName(power));
+    _power = power;
+    _wakeup.notify_all();
 }
 
-void LedMatrix::drawSL(unsigned int y, unsigned int x,
-                       unsigned int shift, bool clear,
-                       const uint8_t fb[8])
+/*
+ * Called with the mutex held.
+ */
+LedMatrix::Power LedMatrix::powerPolicy(void) const
 {
-    if (y >= MAX7219_Y_COUNT) {
-        return;
-    }
+    uint64_t idle = Clock::get()->monotonicSec() - _lastActivity;
 
-    if (x >= MAX7219_X_COUNT) {
-        return;
+    if ((offHoursLeft() > 0) && (idle >= LED_WAKE_SEC)) {
+        return POWER_OFF;
     }
-
-    if (shift >= 8) {
-        return;
+    if ((_powerConfig.offAfter > 0) && (idle >= _powerConfig.offAfter)) {
+        return POWER_OFF;
+    }
+    if ((_powerConfig.dimAfter > 0) && (idle >= _powerConfig.dimAfter)) {
+        return POWER_DIM;
     }
 
-    if (fb == NULL) {
-        return;
+    return POWER_ACTIVE;
+}
+
+/*
+ * Seconds until the off hours end, or 0 outside of them.
+ */
+unsigned int LedMatrix::offHoursLeft(void) const
+{
+    time_t now = Clock::get()->wallTime();
+    unsigned int from = _powerConfig.offFrom;
+    unsigned int until = _powerConfig.offUntil;
+    unsigned int hours;
+    struct tm tm;
+
+    if (from == until) {
+        return 0;
     }
 
-    _mutex.lock();
-    for (unsigned int i = 0; i < 8; i++) {
-        if (clear) {
-            _fb[y][x][i] = (fb[i] << shift);
-        } else {
-            _fb[y][x][i] |= (fb[i] << shift);
+    localtime_r(&now, &tm);
+    if (from < until) {
+        if (((unsigned int) tm.tm_hour < from) ||
+            ((unsigned int) tm.tm_hour >= until)) {
+            return 0;
         }
+    } else if (((unsigned int) tm.tm_hour < from) &&
+               ((unsigned int) tm.tm_hour >= until)) {
+        return 0;
     }
-    _mutex.unlock();
+
+    hours = (until + 24 - tm.tm_hour) % 24;
+
+    return (hours * 3600) - (tm.tm_min * 60) - tm.tm_sec;
 }
 
-void LedMatrix::drawSR(unsigned int y, unsigned int x,
-                       unsigned int shift, bool clear,
-                       const uint8_t fb[8])
+/*
+ * With the signs off the render thread shuts the panels down and then
+ * sleeps until something wakes them or a tick finds the off hours over;
+ * nothing is sent and no frames run meanwhile. The end of the off hours
+ * is polled for on Clock, so that simulated time can run them out. False
+ * when the signs are not off.
+ */
+bool LedMatrix::sleepOff(void)
 {
-    if (y >= MAX7219_Y_COUNT) {
-        return;
+    unique_lock<mutex> lock(_mutex);
+
+    if (_power != POWER_OFF) {
+        return false;
     }
 
-    if (x >= MAX7219_X_COUNT) {
-        return;
+    for (unsigned int c = 0; c < _chains.size(); c++) {
+        _chains[c].spi->broadcast(SHUTDOWN_REG, 0);
+    }
+    for (unsigned int c = 0; c < _chains.size(); c++) {
+        _chains[c].spi->flush();
     }
 
-    if (shift >= 8) {
-        return;
+    _heartbeat.park();
+    while (_running && (_power == POWER_OFF)) {
+        if (_powerForced || (_offUntil == 0)) {
+            _wakeup.wait(lock);
+        } else if (_wakeup.wait_for(lock,
+                                    chrono::milliseconds(LED_OFF_POLL_MS)) ==
+                   cv_status::timeout) {
+            lock.unlock();
+            tick();
+            lock.lock();
+        }
     }
+    _heartbeat.beat();
 
-    if (fb == NULL) {
-        return;
+    return true;
+}
+
+Max7219Stats LedMatrix::spiStats(unsigned int c) const
+{
+    Max7219Stats stats = Max7219Stats();
+
+    if (c >= _chains.size()) {
+        return stats;
     }
 
     _mutex.lock();
-    for (unsigned int i = 0; i < 8; i++) {
-        if (clear) {
-            _fb[y][x][i] = (fb[i] >> shift);
-        } else {
-            _fb[y][x][i] |= (fb[i] >> shift);
-        }
-    }
+    stats = _chains[c].spi->stats();
     _mutex.unlock();
+
+    return stats;
 }
 
-void LedMatrix::repaint(void)
+unsigned long LedMatrix::spiFullBytes(unsigned int c) const
 {
-    uint8_t xmit[MAX7219_X_COUNT * MAX7219_Y_COUNT * 2];
+    unsigned long bytes;
+
+    if (c >= _chains.size()) {
+        return 0;
+    }
 
     _mutex.lock();
-    for (unsigned int i = 0; i < 8; i++) {
-        for (unsigned int y = 0; y < MAX7219_Y_COUNT; y++) {
-            for (unsigned int x = 0; x < MAX7219_X_COUNT; x++) {
-                xmit[(((y * MAX7219_Y_COUNT) + x) * 2) + 0] = DIGIT7_REG - i;
-                xmit[(((y * MAX7219_Y_COUNT) + x) * 2) + 1] =
-                    _fb[y][MAX7219_X_COUNT - 1 - x][i];
-            }
-        }
+    bytes = _chains[c].spiFullBytes;
+    _mutex.unlock();
 
-        writeMax7219(xmit, sizeof(xmit));
+    return bytes;
+}
+
+unsigned int LedMatrix::modulesShutdown(unsigned int c) const
+{
+    unsigned int count = 0;
+
+    if (c >= _chains.size()) {
+        return 0;
+    }
+
+    _mutex.lock();
+    for (unsigned int m = 0; m < _chains[c].spi->modules(); m++) {
+        if (_chains[c].spi->isShutdown(m)) {
+            count++;
+        }
+    }
+    _mutex.unlock();
+
+    return count;
+}
+
+double LedMatrix::currentMa(unsigned int c) const
+{
+    double ma;
+
+    if (c >= _chains.size()) {
+        return 0.0;
+    }
+
+    _mutex.lock();
+    ma = _chains[c].spi->currentMa();
+    _mutex.unlock();
+
+    return ma;
+}
+
+/*
+ * Copies what the chain shows; the generation returned changes whenever
+ * the frame buffer does, so a caller can tell a new frame from a repeat.
+ */
+uint64_t LedMatrix::frame(unsigned int c, vector<uint8_t> &fb) const
+{
+    uint64_t generation;
+
+    if (c >= _chains.size()) {
+        fb.clear();
+        return 0;
+    }
+
+    _mutex.lock();
+    fb = _chains[c].fb;
+    generation = _chains[c].generation;
+    _mutex.unlock();
+
+    return generation;
+}
+
+/*
+ * A panel's eight bytes are its pixel rows, digit 0 at the bottom, and
+ * bit 0 is the leftmost pixel.
+ */
+bool LedMatrix::pixel(const vector<uint8_t> &fb, unsigned int columns,
+                      unsigned int px, unsigned int py)
+{
+    unsigned int rows = fb.size() / (columns * 8);
+    unsigned int y = py / 8, x = px / 8;
+    unsigned int d = 7 - (py % 8);
+
+    if ((x >= columns) || (y >= rows)) {
+        return false;
+    }
+
+    return (fb[(((y * columns) + x) * 8) + d] >> (px % 8)) & 1;
+}
+
+/*
+ * The current frame of a chain as ASCII art, or as a plain (P1) PBM
+ * image, top row first.
+ */
+string LedMatrix::snapshot(unsigned int c, bool pbm) const
+{
+    vector<uint8_t> fb;
+    unsigned int width, height, px, py;
+    string s;
+
+    if (c >= _chains.size()) {
+        return s;
+    }
+
+    frame(c, fb);
+    width = _chains[c].config.columns * 8;
+    height = _chains[c].config.rows * 8;
+
+    if (pbm) {
+        s = "P1\n" + to_string(width) + " " + to_string(height) + "\n";
+    }
+    for (py = 0; py < height; py++) {
+        for (px = 0; px < width; px++) {
+            if (pbm) {
+                s += pixel(fb, _chains[c].config.columns, px, py) ?
+                    "1" : "0";
+                s += (px + 1 < width) ? " " : "";
+            } else {
+                s += pixel(fb, _chains[c].config.columns, px, py) ?
+                    '#' : '.';
+            }
+        }
+        s += "\n";
+    }
+
+    return s;
+}
+
+void LedMatrix::beginUpdate(void)
+{
+    _hold++;
+}
+
+void LedMatrix::endUpdate(void)
+{
+    if (_hold > 0) {
+        _hold--;
+    }
+}
+
+/*
+ * Drops every waiting message and blanks the rows for a while.
+ */
+void LedMatrix::clear(void)
+{
+    for (unsigned int c = 0; c < _chains.size(); c++) {
+        for (unsigned int y = 0; y < _chains[c].rows.size(); y++) {
+            _mutex.lock();
+            _chains[c].rows[y].queue.clear();
+            _mutex.unlock();
+            setText(c, y, "");
+        }
+    }
+}
+
+void LedMatrix::setText(unsigned int y, const string &text,
+                        unsigned int ttl)
+{
+    setText(0, y, text, ttl);
+}
+
+void LedMatrix::setText(unsigned int c, unsigned int y, const string &text,
+                        unsigned int ttl, LedQueue::Priority priority,
+                        unsigned int repeat)
+{
+    postText(c, y, text.data(), text.size(), ttl, priority, repeat);
+}
+
+/*
+ * Text from a producer that is done with it goes straight into a text
+ * slot of the row; no copy of the string is kept or made on the way.
+ */
+void LedMatrix::setText(unsigned int c, unsigned int y, string &&text,
+                        unsigned int ttl, LedQueue::Priority priority,
+                        unsigned int repeat)
+{
+    postText(c, y, text.data(), text.size(), ttl, priority, repeat);
+}
+
+/*
+ * A text slot of the row that nothing shows or queues, which is one only
+ * the row itself holds. The slots cover a full queue, the resting and
+ * pinned content and a few posts in flight, so a new layer is made only
+ * under a burst from several threads at once. Called with the mutex
+ * held.
+ */
+shared_ptr<TextLayer> LedMatrix::claim(Row &row, unsigned int columns)
+{
+    for (unsigned int i = 0; i < row.slots.size(); i++) {
+        if (row.slots[i].use_count() == 1) {
+            return row.slots[i];
+        }
+    }
+
+    return make_shared<TextLayer>(columns);
+}
+
+/*
+ * Renders text, cut to LED_MAX_TEXT, into a free slot of the row and
+ * posts it; the slot is rendered into outside the lock, as nothing else
+ * can claim it meanwhile.
+ */
+void LedMatrix::postText(unsigned int c, unsigned int y, const char *text,
+                         size_t len, unsigned int ttl,
+                         LedQueue::Priority priority, unsigned int repeat)
+{
+    shared_ptr<TextLayer> layer;
+
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        return;
+    }
+
+    len = LedText::fit(text, len);
+
+    // The first text a row shows is its welcome text, shown for good,
+    // unless the row already rests on a binding
+    _mutex.lock();
+    Row &row = _chains[c].rows[y];
+    if (row.welcome.empty() && !row.binding) {
+        row.welcome.assign(text, len);
+        ttl = 0;
+    }
+    layer = claim(row, _chains[c].config.columns);
+    _mutex.unlock();
+
+    layer->assign(text, len, ttl);
+    setContent(c, y, layer, priority, repeat);
+}
+
+void LedMatrix::setVerticalText(unsigned int c, unsigned int y,
+                                const string &text, unsigned int ttl,
+                                LedQueue::Priority priority,
+                                unsigned int repeat)
+{
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        return;
+    }
+
+    if (LedText::fit(text) < text.size()) {
+        setVerticalText(c, y, text.substr(0, LedText::fit(text)), ttl,
+                        priority, repeat);
+        return;
+    }
+
+    setContent(c, y, make_shared<VScrollLayer>(StripCache::get().lookup(text),
+                                               _chains[c].config.columns,
+                                               ttl,
+                                               frames(LED_VSCROLL_HOLD_MS)),
+               priority, repeat);
+}
+
+void LedMatrix::setProgress(unsigned int c, unsigned int y,
+                            unsigned int percent, unsigned int ttl,
+                            LedQueue::Priority priority, unsigned int repeat)
+{
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        return;
+    }
+
+    if (percent > 100) {
+        percent = 100;
+    }
+
+    setContent(c, y, make_shared<ProgressLayer>(percent,
+                                                _chains[c].config.columns,
+                                                ttl),
+               priority, repeat);
+}
+
+/*
+ * Makes a text the row's resting content over its welcome text or
+ * binding, which keep updating underneath and come back when an empty
+ * text unpins it. Messages are still shown over it.
+ */
+void LedMatrix::pinText(unsigned int c, unsigned int y, const string &text)
+{
+    shared_ptr<TextLayer> slot;
+    shared_ptr<LedLayer> layer;
+    bool shown;
+
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        return;
+    }
+
+    if (!text.empty()) {
+        _mutex.lock();
+        slot = claim(_chains[c].rows[y], _chains[c].config.columns);
+        _mutex.unlock();
+        slot->assign(text.data(), text.size(), 0);
+        layer = slot;
+    }
+
+    _mutex.lock();
+    Row &row = _chains[c].rows[y];
+    row.pinned = layer;
+    shown = present(row, _chains[c].config.columns);
+    if (shown) {
+        layer = row.content;
+    }
+    activity();
+    _mutex.unlock();
+
+    if (statusModel && (c == 0) && shown) {
+        statusModel->setLedText(y, layer ? layer->text() : "");
+    }
+}
+
+/*
+ * Queues a message on a row, or replaces its resting content when the
+ * layer has no time to live; the row's effects stay. A bound row
+ * showing new values is not activity and does not wake the signs.
+ */
+void LedMatrix::setContent(unsigned int c, unsigned int y,
+                           shared_ptr<LedLayer> layer,
+                           LedQueue::Priority priority, unsigned int repeat,
+                           bool bound)
+{
+    uint64_t traced, t0;
+    unsigned int ttl = layer->ttl();
+    bool queued = true, shown;
+    LedMessage message;
+
+    traced = LatencyTracer::get().pending();
+    t0 = traced ? LatencyTracer::nowNs() : 0;
+
+    _mutex.lock();
+    Row &row = _chains[c].rows[y];
+    if (traced) {
+        LatencyTracer::get().record(LatencyTracer::STAGE_LED_LOCK,
+                                    LatencyTracer::nowNs() - t0);
+    }
+    if (ttl == 0) {
+        row.rest = layer;
+        row.bound = bound;
+    } else {
+        message.layer = layer;
+        message.ttl = ttl;
+        message.repeat = repeat;
+        queued = row.queue.push(priority, message);
+    }
+    shown = present(row, _chains[c].config.columns);
+    if (traced && shown) {
+        row.tracePending = traced;
+    }
+    if (!bound) {
+        activity();
+    }
+    _mutex.unlock();
+
+    if (!queued) {
+        Logger::get().warn(Logger::CAT_LED, "row %s: queue full, '%s' dropped",
+                           rowName(c, y), layer->text());
+        return;
+    }
+
+    Logger::get().debug(Logger::CAT_LED, "row %s: %s '%s' ttl=%u %s",
+                        rowName(c, y), layer->kind(), layer->text(), ttl,
+                        (ttl == 0) ? "rest" :
+                        LedQueue::priorityName(priority));
+    if (statusModel && (c == 0) && shown) {
+        statusModel->setLedText(y, layer->text());
+    }
+}
+
+/*
+ * Points the row at its front message, or at its pinned or else resting
+ * content when none is waiting; true when that changed what the row
+ * shows. The row's slowdown factor carries over. Called with the mutex
+ * held.
+ */
+bool LedMatrix::present(Row &row, unsigned int columns)
+{
+    const LedMessage *front = row.queue.front();
+    shared_ptr<LedLayer> layer = front ? front->layer :
+        (row.pinned ? row.pinned : row.rest);
+
+    if (layer == row.content) {
+        return false;
+    }
+
+    if (row.content && layer) {
+        layer->setSlowdown(row.content->slowdown());
+    }
+    row.content = layer;
+    row.dirty = (1U << columns) - 1;
+
+    return true;
+}
+
+void LedMatrix::addEffect(unsigned int c, unsigned int y,
+                          shared_ptr<LedLayer> layer)
+{
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        return;
+    }
+
+    _mutex.lock();
+    if (_chains[c].rows[y].effects.size() >= LED_MAX_EFFECTS) {
+        _chains[c].rows[y].effects.erase(_chains[c].rows[y].effects.begin());
+    }
+    _chains[c].rows[y].effects.push_back(layer);
+    _chains[c].rows[y].dirty = (1U << _chains[c].config.columns) - 1;
+    activity();
+    _mutex.unlock();
+}
+
+/*
+ * Frame counts are taken from the frame delay when an effect starts.
+ */
+unsigned int LedMatrix::frames(unsigned int ms) const
+{
+    unsigned int delay = (_delay > 0) ? _delay : 1;
+
+    return (ms + delay - 1) / delay;
+}
+
+void LedMatrix::blink(unsigned int c, unsigned int y, bool on,
+                      unsigned int ttl)
+{
+    vector<shared_ptr<LedLayer> >::iterator it;
+
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        return;
+    }
+
+    if (on) {
+        addEffect(c, y, make_shared<BlinkLayer>(_chains[c].config.columns,
+                                                frames(LED_BLINK_MS),
+                                                frames(LED_BLINK_MS),
+                                                ttl));
+        return;
+    }
+
+    _mutex.lock();
+    Row &row = _chains[c].rows[y];
+    for (it = row.effects.begin(); it != row.effects.end(); ) {
+        if (strcmp((*it)->kind(), "blink") == 0) {
+            it = row.effects.erase(it);
+        } else {
+            it++;
+        }
+    }
+    row.dirty = (1U << _chains[c].config.columns) - 1;
+    activity();
+    _mutex.unlock();
+}
+
+/*
+ * A row flashes with the one flash layer it has; flashing it again
+ * while it still flashes starts that over.
+ */
+void LedMatrix::flash(unsigned int c, unsigned int y)
+{
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        return;
+    }
+
+    _mutex.lock();
+    Row &row = _chains[c].rows[y];
+    row.flash->rearm(frames(LED_FLASH_MS));
+    if (row.flash.use_count() == 1) {
+        if (row.effects.size() >= LED_MAX_EFFECTS) {
+            row.effects.erase(row.effects.begin());
+        }
+        row.effects.push_back(row.flash);
+    }
+    row.dirty = (1U << _chains[c].config.columns) - 1;
+    activity();
+    _mutex.unlock();
+}
+
+/*
+ * The layer stack of a row, bottom first, e.g. "text+blink".
+ */
+string LedMatrix::layers(unsigned int c, unsigned int y) const
+{
+    string kinds;
+
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        return kinds;
+    }
+
+    _mutex.lock();
+    const Row &row = _chains[c].rows[y];
+    if (row.content) {
+        kinds = row.content->kind();
+    }
+    for (unsigned int i = 0; i < row.effects.size(); i++) {
+        kinds += "+";
+        kinds += row.effects[i]->kind();
+    }
+    _mutex.unlock();
+
+    return kinds;
+}
+
+/*
+ * Binds a row to a template such as "T {cpu_temp:.0f}C", see
+ * LedTemplate; it becomes the row's resting content, shown once no
+ * message is waiting.
+ */
+bool LedMatrix::bind(unsigned int c, unsigned int y, const string &tmpl,
+                     string &error)
+{
+    shared_ptr<LedTemplate> binding;
+
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        error = "invalid row";
+        return false;
+    }
+
+    binding = make_shared<LedTemplate>();
+    if (!binding->parse(tmpl, error)) {
+        return false;
+    }
+
+    _mutex.lock();
+    _chains[c].rows[y].binding = binding;
+    _mutex.unlock();
+
+    showBinding(c, y, true);
+
+    return true;
+}
+
+void LedMatrix::unbind(unsigned int c, unsigned int y)
+{
+    string welcome;
+    bool bound;
+
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        return;
+    }
+
+    _mutex.lock();
+    Row &row = _chains[c].rows[y];
+    row.binding.reset();
+    bound = row.bound;
+    welcome = row.welcome.c_str();
+    _mutex.unlock();
+
+    if (bound) {
+        setText(c, y, move(welcome), 0);
+    }
+}
+
+string LedMatrix::binding(unsigned int c, unsigned int y) const
+{
+    string tmpl;
+
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        return tmpl;
+    }
+
+    _mutex.lock();
+    if (_chains[c].rows[y].binding) {
+        tmpl = _chains[c].rows[y].binding->text();
+    }
+    _mutex.unlock();
+
+    return tmpl;
+}
+
+/*
+ * Formats a row's binding and makes it the resting content if the text
+ * changed, or in any case when forced.
+ */
+void LedMatrix::showBinding(unsigned int c, unsigned int y, bool force)
+{
+    shared_ptr<const LedTemplate> binding;
+    shared_ptr<TextLayer> layer;
+    string text;
+
+    _mutex.lock();
+    Row &row = _chains[c].rows[y];
+    if (row.binding && (force || row.bound)) {
+        binding = row.binding;
+    }
+    _mutex.unlock();
+
+    if (!binding) {
+        return;
+    }
+
+    binding->format(text);
+    text.resize(LedText::fit(text));
+
+    _mutex.lock();
+    if (row.binding != binding) {
+        _mutex.unlock();
+        return;                  // Rebound or unbound meanwhile
+    }
+    if (row.bound && (text == row.boundText.c_str())) {
+        _mutex.unlock();
+        return;
+    }
+    row.boundText = text;
+    layer = claim(row, _chains[c].config.columns);
+    _mutex.unlock();
+
+    layer->assign(text.data(), text.size(), 0);
+    setContent(c, y, layer, LedQueue::PRIORITY_NORMAL, 0, true);
+}
+
+/*
+ * Called by LiveValues on the producer's thread with the sources that
+ * changed; only rows that show one of them are formatted again.
+ */
+void LedMatrix::sourcesChanged(void *arg, uint64_t sources)
+{
+    LedMatrix *matrix = (LedMatrix *) arg;
+    vector<pair<unsigned int, unsigned int> > rows;
+    unsigned int c, y;
+
+    matrix->_mutex.lock();
+    for (c = 0; c < matrix->_chains.size(); c++) {
+        for (y = 0; y < matrix->_chains[c].rows.size(); y++) {
+            const Row &row = matrix->_chains[c].rows[y];
+            if (row.bound && row.binding &&
+                ((row.binding->sources() & sources) != 0)) {
+                rows.push_back(make_pair(c, y));
+            }
+        }
+    }
+    matrix->_mutex.unlock();
+
+    for (unsigned int i = 0; i < rows.size(); i++) {
+        matrix->showBinding(rows[i].first, rows[i].second, false);
+    }
+}
+
+void LedMatrix::setWelcomeText(void)
+{
+    string text;
+
+    for (unsigned int c = 0; c < _chains.size(); c++) {
+        for (unsigned int y = 0; y < _chains[c].rows.size(); y++) {
+            _mutex.lock();
+            text = _chains[c].rows[y].welcome.c_str();
+            _mutex.unlock();
+            setText(c, y, text);
+        }
+    }
+}
+
+void LedMatrix::setWelcomeText(unsigned int y, const string &text,
+                               bool apply)
+{
+    setWelcomeText(0, y, text, apply);
+}
+
+void LedMatrix::setWelcomeText(unsigned int c, unsigned int y,
+                               const string &text, bool apply)
+{
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        return;
+    }
+
+    _mutex.lock();
+    _chains[c].rows[y].welcome = text;
+    _mutex.unlock();
+
+    if (apply) {
+        setText(c, y, text);
+    }
+}
+
+unsigned int LedMatrix::ttl(unsigned int y) const
+{
+    return ttl(0, y);
+}
+
+unsigned int LedMatrix::ttl(unsigned int c, unsigned int y) const
+{
+    unsigned int ttl = 0;
+
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        return 0;
+    }
+
+    _mutex.lock();
+    if (_chains[c].rows[y].content) {
+        ttl = _chains[c].rows[y].content->ttl();
+    }
+    _mutex.unlock();
+
+    return ttl;
+}
+
+unsigned int LedMatrix::queued(unsigned int c, unsigned int y) const
+{
+    unsigned int count;
+
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        return 0;
+    }
+
+    _mutex.lock();
+    count = _chains[c].rows[y].queue.size();
+    _mutex.unlock();
+
+    return count;
+}
+
+void LedMatrix::setDelay(unsigned int ms)
+{
+    _delay = ms;
+}
+
+unsigned int LedMatrix::delay(void) const
+{
+    return _delay;
+}
+
+void LedMatrix::setSlowdownFactor(unsigned int y, unsigned int sf)
+{
+    setSlowdownFactor(0, y, sf);
+}
+
+void LedMatrix::setSlowdownFactor(unsigned int c, unsigned int y,
+                                  unsigned int sf)
+{
+    Row *row;
+
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        return;
+    }
+
+    _mutex.lock();
+    row = &_chains[c].rows[y];
+    if (row->content) {
+        row->content->setSlowdown(sf);
+    }
+    for (unsigned int i = 0; i < row->effects.size(); i++) {
+        row->effects[i]->setSlowdown(sf);
+    }
+    _mutex.unlock();
+}
+
+unsigned int LedMatrix::slowdownFactor(unsigned int y) const
+{
+    return slowdownFactor(0, y);
+}
+
+unsigned int LedMatrix::slowdownFactor(unsigned int c, unsigned int y) const
+{
+    unsigned int sf = 1;
+
+    if ((c >= _chains.size()) || (y >= _chains[c].rows.size())) {
+        return 1;
+    }
+
+    _mutex.lock();
+    if (_chains[c].rows[y].content) {
+        sf = _chains[c].rows[y].content->slowdown();
+    }
+    _mutex.unlock();
+
+    return sf;
+}
+
+/*
+ * Queues the registers of the panels of one chain that changed since
+ * the last repaint. A panel that is completely blank is shut down
+ * instead of having its digits cleared; its digit registers are
+ * brought up to date before it is woken up again.
+ */
+void LedMatrix::build(Chain &chain)
+{
+    Max7219Chain &spi = *chain.spi;
+    unsigned int x, y, d, m;
+    const uint8_t *p;
+    bool blank;
+
+    if ((_repaints % MAX7219_SETUP_REPAINTS) == 0) {
+        m = chain.setupNext;
+        spi.setup(m);
+        chain.rows[m / chain.config.columns].stale |=
+            1U << (chain.config.columns - 1 - (m % chain.config.columns));
+        chain.setupNext = (m + 1) % spi.modules();
+    }
+
+    for (y = 0; y < chain.config.rows; y++) {
+        if (chain.rows[y].stale == 0) {
+            continue;
+        }
+
+        for (x = 0; x < chain.config.columns; x++) {
+            if ((chain.rows[y].stale & (1U << x)) == 0) {
+                continue;
+            }
+
+            m = module(chain, y, x);
+            p = &chain.fb[((y * chain.config.columns) + x) * 8];
+            spi.update(m, INTENSITY_REG,
+                       (chain.rows[y].intensity < _cap) ?
+                       chain.rows[y].intensity : _cap);
+
+            blank = true;
+            for (d = 0; d < 8; d++) {
+                if (p[d] != 0) {
+                    blank = false;
+                    break;
+                }
+            }
+
+            if (blank) {
+                spi.update(m, SHUTDOWN_REG, 0);
+                continue;
+            }
+
+            for (d = 0; d < 8; d++) {
+                spi.update(m, DIGIT0_REG + d, p[d]);
+            }
+            spi.update(m, SHUTDOWN_REG, 1);
+        }
+        chain.rows[y].stale = 0;
+    }
+
+    chain.spiFullBytes += 8 * spi.modules() * 2;
+}
+
+/*
+ * Every chain's batch is built first and then all are sent back to
+ * back, so one frame's SPI traffic is a single burst on the bus.
+ */
+void LedMatrix::repaint(void)
+{
+    unsigned int c, y, target;
+
+    _mutex.lock();
+    _repaints++;
+
+    // Dimming walks the intensity cap down one step at a time
+    target = (_power == POWER_ACTIVE) ? 15 : _powerConfig.dimIntensity;
+    if ((_cap != target) && ((_repaints % LED_RAMP_FRAMES) == 0)) {
+        _cap = (_cap < target) ? (_cap + 1) : (_cap - 1);
+        for (c = 0; c < _chains.size(); c++) {
+            for (y = 0; y < _chains[c].rows.size(); y++) {
+                _chains[c].rows[y].stale =
+                    (1U << _chains[c].config.columns) - 1;
+            }
+        }
+    }
+
+    for (c = 0; c < _chains.size(); c++) {
+        build(_chains[c]);
+    }
+
+    for (c = 0; c < _chains.size(); c++) {
+        _chains[c].spi->flush();
+    }
+
+    for (c = 0; c < _chains.size(); c++) {
+        for (y = 0; y < _chains[c].rows.size(); y++) {
+            Row &row = _chains[c].rows[y];
+            if (row.traceComposed != 0) {
+                LatencyTracer::get().ledShown(row.traceComposed);
+                row.traceComposed = 0;
+            }
+        }
     }
     _mutex.unlock();
 }
@@ -8,75 +8,272 @@
 #define LEDMATRIX_HXX
 
 #include <memory>
+#include <atomic>
+#include <condition_variable>
 #include <mutex>
 #include <thread>
+#include <vector>
+#include <LedLayer.hxx>
+#include <LedQueue.hxx>
+#include <LedText.hxx>
+#include <LedTemplate.hxx>
+#include <Max7219Chain.hxx>
+#include <Histogram.hxx>
+#include <Heartbeat.hxx>
 
+// Geometry of the main sign, chain 0 by default
 #define MAX7219_X_COUNT      4
 #define MAX7219_Y_COUNT      4
 
+#define LED_MAX_CHAINS       2     // One per SPI chip select
+#define LED_MAX_COLUMNS      8
+#define LED_MAX_ROWS         8
+#define LED_MAX_NAME         15
+
+#define LED_MAX_EFFECTS      4     // Per row; the oldest gives way
+#define LED_ROW_SLOTS        (LED_QUEUE_DEPTH + 8)  // Text layers per row
+#define LED_BLINK_MS         500   // Each phase of a blink
+#define LED_FLASH_MS         300
+#define LED_VSCROLL_HOLD_MS  2000
+#define LED_RAMP_FRAMES      4     // Per intensity step while dimming
+#define LED_WAKE_SEC         60    // Awake after activity in the off hours
+#define LED_HEARTBEAT_MS     2000  // Plus twice the frame delay
+#define LED_OFF_POLL_MS      1000  // Clock checks while asleep
+
 using namespace std;
 
+struct LedChainConfig {
+    string name;
+    unsigned int spi;            // SPI chip select, CE0 or CE1
+    unsigned int columns;        // Panels per row
+    unsigned int rows;           // Rows of text
+};
+
+/*
+ * When the signs dim or go dark. Inactivity is time without new row
+ * content or effects; 0 turns a timeout off, as does offFrom equal to
+ * offUntil for the off hours.
+ */
+struct LedPowerConfig {
+    unsigned int dimAfter;       // Seconds of inactivity
+    unsigned int offAfter;       // Seconds of inactivity
+    unsigned int dimIntensity;   // 0-15
+    unsigned int offFrom;        // Local hour the off hours begin
+    unsigned int offUntil;       // Local hour they end
+};
+
+/*
+ * The render engine for every LED sign. Each chain of MAX7219 panels
+ * has its own geometry and text rows; one thread steps all of them on
+ * a shared frame clock and sends their SPI batches back to back, so
+ * the chains never contend for the SPI bus or a lock.
+ *
+ * Rows are addressed by chain index and row. The overloads without a
+ * chain address chain 0, the main sign.
+ *
+ * What a row shows is a stack of layers: one content layer with
+ * effects such as blink() and flash() on top. Only panels that an
+ * animated layer changed are recomposed and repainted each frame.
+ *
+ * Content posted with setText(), setVerticalText() or setProgress() and
+ * a time to live is a message: it waits in the row's LedQueue by
+ * priority and the row shows the front one. Content without a time to
+ * live is the row's resting content, shown whenever no message is.
+ *
+ * A row can also be bound to a template of live values with bind(); it
+ * then rests on the template instead of its welcome text, and is
+ * formatted and rendered again only when a value it depends on changes.
+ */
 class LedMatrix {
 
 public:
 
-    LedMatrix();
+    enum Power {
+        POWER_ACTIVE = 0,
+        POWER_DIM,
+        POWER_OFF,
+    };
+
+    LedMatrix(const vector<LedChainConfig> &chains =
+              LedMatrix::defaults());
     ~LedMatrix();
 
+    static vector<LedChainConfig> defaults(void);
+    static bool validate(const vector<LedChainConfig> &chains,
+                         string &error);
+
     void start(void);
     void stop(void);
     void join(void);
 
-    unsigned int intensity(void) const;
+    unsigned int chainCount(void) const;
+    int findChain(const string &name) const;
+    const string &chainName(unsigned int c) const;
+    unsigned int rows(unsigned int c = 0) const;
+    unsigned int columns(unsigned int c = 0) const;
+    bool parseRow(const string &arg, unsigned int &c,
+                  unsigned int &y) const;
+    string rowName(unsigned int c, unsigned int y) const;
+
+    unsigned int intensity(unsigned int y = 0) const;
+    unsigned int intensity(unsigned int c, unsigned int y) const;
     void setIntensity(unsigned int intensity);
+    void setIntensity(unsigned int y, unsigned int intensity);
+    void setIntensity(unsigned int c, unsigned int y,
+                      unsigned int intensity);
+    void reinit(void);
+
+    void setPowerConfig(const LedPowerConfig &config);
+    LedPowerConfig powerConfig(void) const;
+    Power power(void) const;
+    bool powerForced(void) const;
+    void forcePower(Power power);
+    void releasePower(void);
+    unsigned int idleSeconds(void) const;
+    static const char *powerName(Power power);
+
+    void beginUpdate(void);
+    void endUpdate(void);
 
     void clear(void);
     void setText(unsigned int y, const string &text,
                  unsigned int ttl = 30);
+    void setText(unsigned int c, unsigned int y, const string &text,
+                 unsigned int ttl = 30,
+                 LedQueue::Priority priority = LedQueue::PRIORITY_NORMAL,
+                 unsigned int repeat = 0);
+    void setText(unsigned int c, unsigned int y, string &&text,
+                 unsigned int ttl = 30,
+                 LedQueue::Priority priority = LedQueue::PRIORITY_NORMAL,
+                 unsigned int repeat = 0);
+    void setVerticalText(unsigned int c, unsigned int y, const string &text,
+                         unsigned int ttl = 30,
+                         LedQueue::Priority priority =
+                         LedQueue::PRIORITY_NORMAL,
+                         unsigned int repeat = 0);
+    void setProgress(unsigned int c, unsigned int y, unsigned int percent,
+                     unsigned int ttl = 30,
+                     LedQueue::Priority priority = LedQueue::PRIORITY_NORMAL,
+                     unsigned int repeat = 0);
+    void pinText(unsigned int c, unsigned int y, const string &text);
+    void blink(unsigned int c, unsigned int y, bool on,
+               unsigned int ttl = 0);
+    void flash(unsigned int c, unsigned int y);
+    string layers(unsigned int c, unsigned int y) const;
+    bool bind(unsigned int c, unsigned int y, const string &tmpl,
+              string &error);
+    void unbind(unsigned int c, unsigned int y);
+    string binding(unsigned int c, unsigned int y) const;
     void setWelcomeText(void);
     void setWelcomeText(unsigned int y, const string &text,
                         bool apply = false);
+    void setWelcomeText(unsigned int c, unsigned int y, const string &text,
+                        bool apply = false);
     unsigned int ttl(unsigned int y) const;
+    unsigned int ttl(unsigned int c, unsigned int y) const;
+    unsigned int queued(unsigned int c, unsigned int y) const;
     void setDelay(unsigned int ms);
     unsigned int delay(void) const;
     void setSlowdownFactor(unsigned int y, unsigned int sf);
+    void setSlowdownFactor(unsigned int c, unsigned int y, unsigned int sf);
     unsigned int slowdownFactor(unsigned int y) const;
+    unsigned int slowdownFactor(unsigned int c, unsigned int y) const;
 
-    void draw(unsigned int y, unsigned int x, const uint8_t fb[8]);
-    void drawSL(unsigned int y, unsigned int x,
-                unsigned int shift, bool clear,
-                const uint8_t fb[8]);
-    void drawSR(unsigned int y, unsigned int x,
-                unsigned int shift, bool clear,
-                const uint8_t fb[8]);
     void repaint(void);
+    void tick(void);
+
+    uint64_t frame(unsigned int c, vector<uint8_t> &fb) const;
+    string snapshot(unsigned int c, bool pbm = false) const;
+    static bool pixel(const vector<uint8_t> &fb, unsigned int columns,
+                      unsigned int px, unsigned int py);
+
+    const Histogram &framePeriod(void) const;
+    void resetFramePeriod(void);
+
+    Max7219Stats spiStats(unsigned int c) const;
+    unsigned long spiFullBytes(unsigned int c) const;
+    unsigned int modulesShutdown(unsigned int c) const;
+    double currentMa(unsigned int c) const;
 
 private:
 
+    struct Row {
+        shared_ptr<LedLayer> content;    // Front message or rest
+        shared_ptr<LedLayer> rest;
+        shared_ptr<LedLayer> pinned;     // Shown over rest if set
+        LedQueue queue;
+        vector<shared_ptr<LedLayer> > effects;
+        vector<shared_ptr<TextLayer> > slots;  // Reused for all text
+        shared_ptr<FlashLayer> flash;          // Reused for every flash
+        unsigned int intensity;
+        LedText welcome;
+        shared_ptr<const LedTemplate> binding;
+        LedText boundText;       // What the binding was last formatted to
+        bool bound;              // The resting layer shows the binding
+        uint32_t dirty;          // Panels to recompose
+        uint32_t stale;          // Panels to repaint
+        uint64_t tracePending;
+        uint64_t traceComposed;
+    };
+
+    struct Chain {
+        LedChainConfig config;
+        shared_ptr<Max7219Chain> spi;
+        vector<Row> rows;
+        vector<uint8_t> fb;      // rows x columns x 8
+        uint64_t generation;     // Bumped whenever fb changes
+        unsigned long spiFullBytes;  // What full repaints would send
+        unsigned int setupNext;  // Module re-initialized next
+    };
+
     static void *thread_func(void *);
     void run(void);
+    void compose(Chain &chain);
+    void build(Chain &chain);
+    static shared_ptr<TextLayer> claim(Row &row, unsigned int columns);
+    void postText(unsigned int c, unsigned int y, const char *text,
+                  size_t len, unsigned int ttl,
+                  LedQueue::Priority priority, unsigned int repeat);
+    void setContent(unsigned int c, unsigned int y,
+                    shared_ptr<LedLayer> layer,
+                    LedQueue::Priority priority, unsigned int repeat,
+                    bool bound = false);
+    static bool present(Row &row, unsigned int columns);
+    void showBinding(unsigned int c, unsigned int y, bool force);
+    static void sourcesChanged(void *arg, uint64_t sources);
+    void addEffect(unsigned int c, unsigned int y,
+                   shared_ptr<LedLayer> layer);
+    unsigned int frames(unsigned int ms) const;
+    void activity(void);
+    void setPower(Power power);
+    Power powerPolicy(void) const;
+    unsigned int offHoursLeft(void) const;
+    bool sleepOff(void);
 
-    int writeMax7219(const void *data, size_t size);
-    int writeMax7219(uint8_t reg, uint8_t data);
+    static unsigned int module(const Chain &chain, unsigned int y,
+                               unsigned int x);
 
-    int _handle;
-    int _fd;
-    unsigned int _intensity;
-    uint8_t _fb[4][4][8];
+    vector<Chain> _chains;
+    unsigned int _repaints;
 
     bool _running;
     shared_ptr<thread> _thread;
-    mutex _mutex;
-
-    string _text[MAX7219_Y_COUNT];
-    unsigned int _ttl[MAX7219_Y_COUNT];
-    int _pos[MAX7219_Y_COUNT];
-    int _slice[MAX7219_Y_COUNT];
-    unsigned int _counter[MAX7219_Y_COUNT];
-    unsigned int _reload[MAX7219_Y_COUNT];
+    mutable mutex _mutex;
+
     unsigned int _delay;
+    atomic<unsigned int> _hold;
+
+    LedPowerConfig _powerConfig;
+    Power _power;
+    bool _powerForced;
+    time_t _offUntil;            // End of the off hours, 0 if none
+    unsigned int _cap;           // Intensity cap, ramped while dimming
+    uint64_t _lastActivity;
+    condition_variable _wakeup;
 
-    string _welcome[MAX7219_Y_COUNT];
+    Histogram _framePeriod;
+    uint64_t _frameLast;
+    Heartbeat _heartbeat;
 
 };
 
@@ -0,0 +1,165 @@
+/*
+ * LedQueue.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <utility>
+#include <LedQueue.hxx>
+
+LedQueue::LedQueue()
+    : _size(0)
+{
+    for (unsigned int p = 0; p < PRIORITY_COUNT; p++) {
+        _rings[p].head = 0;
+        _rings[p].count = 0;
+    }
+}
+
+/*
+ * False when the message was dropped to keep the queue bounded.
+ */
+bool LedQueue::push(Priority priority, const LedMessage &message)
+{
+    unsigned int p;
+
+    if (priority >= PRIORITY_COUNT) {
+        priority = PRIORITY_NORMAL;
+    }
+
+    if (priority == PRIORITY_HIGH) {
+        while (_rings[PRIORITY_HIGH].count > 0) {
+            pop(PRIORITY_HIGH);
+        }
+    }
+
+    if (_size >= LED_QUEUE_DEPTH) {
+        for (p = 0; p <= (unsigned int) priority; p++) {
+            if (_rings[p].count > 0) {
+                break;
+            }
+        }
+        if (p > (unsigned int) priority) {
+            return false;
+        }
+        pop(p);
+    }
+
+    Ring &ring = _rings[priority];
+    ring.slots[(ring.head + ring.count) % LED_QUEUE_DEPTH] = message;
+    ring.count++;
+    _size++;
+
+    return true;
+}
+
+const LedMessage *LedQueue::front(void) const
+{
+    int p = top();
+
+    if (p < 0) {
+        return NULL;
+    }
+
+    return &_rings[p].slots[_rings[p].head];
+}
+
+/*
+ * The front message ran out of time: it goes to the back of its
+ * priority for another showing, from the start, if it has any left.
+ */
+void LedQueue::expire(void)
+{
+    int p = top();
+    unsigned int back;
+
+    if (p < 0) {
+        return;
+    }
+
+    Ring &ring = _rings[p];
+    LedMessage &message = ring.slots[ring.head];
+    if (message.repeat == 0) {
+        pop(p);
+        return;
+    }
+
+    message.repeat--;
+    message.layer->restart(message.ttl);
+
+    // With a full ring the back is the head, and the swap a no-op
+    back = (ring.head + ring.count) % LED_QUEUE_DEPTH;
+    swap(ring.slots[back], ring.slots[ring.head]);
+    ring.head = (ring.head + 1) % LED_QUEUE_DEPTH;
+}
+
+void LedQueue::clear(void)
+{
+    for (unsigned int p = 0; p < PRIORITY_COUNT; p++) {
+        while (_rings[p].count > 0) {
+            pop(p);
+        }
+    }
+}
+
+bool LedQueue::empty(void) const
+{
+    return _size == 0;
+}
+
+unsigned int LedQueue::size(void) const
+{
+    return _size;
+}
+
+unsigned int LedQueue::size(Priority priority) const
+{
+    return (priority < PRIORITY_COUNT) ? _rings[priority].count : 0;
+}
+
+const char *LedQueue::priorityName(Priority priority)
+{
+    switch (priority) {
+    case PRIORITY_LOW:
+        return "low";
+    case PRIORITY_NORMAL:
+        return "normal";
+    case PRIORITY_HIGH:
+        return "high";
+    default:
+        break;
+    }
+
+    return "?";
+}
+
+int LedQueue::top(void) const
+{
+    for (int p = PRIORITY_COUNT - 1; p >= 0; p--) {
+        if (_rings[p].count > 0) {
+            return p;
+        }
+    }
+
+    return -1;
+}
+
+void LedQueue::pop(unsigned int priority)
+{
+    Ring &ring = _rings[priority];
+
+    ring.slots[ring.head].layer.reset();
+    ring.head = (ring.head + 1) % LED_QUEUE_DEPTH;
+    ring.count--;
+    _size--;
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
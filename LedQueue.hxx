@@ -0,0 +1,90 @@
+/*
+ * LedQueue.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef LEDQUEUE_HXX
+#define LEDQUEUE_HXX
+
+#include <memory>
+#include <LedLayer.hxx>
+
+#define LED_QUEUE_DEPTH  8     // Messages waiting per row
+
+using namespace std;
+
+/*
+ * A message waiting on a row: its layer is rendered when it is posted
+ * and kept, so showing it again costs nothing.
+ */
+struct LedMessage {
+    shared_ptr<LedLayer> layer;
+    unsigned int ttl;            // Seconds per showing
+    unsigned int repeat;         // Showings left after this one
+};
+
+/*
+ * The messages of one row, highest priority first and in order of
+ * arrival within a priority. The front is what the row shows; one that
+ * is preempted keeps its place, its time to live and its animation and
+ * resumes once the higher priority ones are gone.
+ *
+ * High priority is for state, such as a relay's, where only the latest
+ * matters, so a row keeps one high priority message. A full queue
+ * makes room by dropping its oldest message of the lowest priority; a
+ * message lower than everything queued is dropped instead.
+ *
+ * Fixed rings, so nothing is allocated and push, pop and rotation take
+ * constant time.
+ */
+class LedQueue {
+
+public:
+
+    enum Priority {
+        PRIORITY_LOW = 0,
+        PRIORITY_NORMAL,
+        PRIORITY_HIGH,
+        PRIORITY_COUNT,
+    };
+
+    LedQueue();
+
+    bool push(Priority priority, const LedMessage &message);
+    const LedMessage *front(void) const;
+    void expire(void);
+    void clear(void);
+    bool empty(void) const;
+    unsigned int size(void) const;
+    unsigned int size(Priority priority) const;
+
+    static const char *priorityName(Priority priority);
+
+private:
+
+    struct Ring {
+        LedMessage slots[LED_QUEUE_DEPTH];
+        unsigned int head;
+        unsigned int count;
+    };
+
+    int top(void) const;
+    void pop(unsigned int priority);
+
+    Ring _rings[PRIORITY_COUNT];
+    unsigned int _size;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
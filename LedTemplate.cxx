@@ -0,0 +1,206 @@
+/*
+ * LedTemplate.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <LiveValues.hxx>
+#include <LedTemplate.hxx>
+
+LedTemplate::LedTemplate()
+    : _sources(0)
+{
+
+}
+
+/*
+ * Flags, width and precision are copied through; the conversion picks
+ * whether the value is printed as an integer or as a double. With
+ * neither a precision nor a conversion, whole values such as counters
+ * print without an exponent.
+ */
+bool LedTemplate::parseSpec(const string &spec, Segment &segment)
+{
+    size_t i = 0;
+    char conversion = 'g';
+    bool precision = false;
+    string body;
+
+    while ((i < spec.size()) && (strchr("-+ 0#", spec[i]) != NULL)) {
+        i++;
+    }
+    while ((i < spec.size()) && isdigit((unsigned char) spec[i])) {
+        i++;
+    }
+    if ((i < spec.size()) && (spec[i] == '.')) {
+        precision = true;
+        i++;
+        if ((i >= spec.size()) || !isdigit((unsigned char) spec[i])) {
+            return false;
+        }
+        while ((i < spec.size()) && isdigit((unsigned char) spec[i])) {
+            i++;
+        }
+    }
+    body = spec.substr(0, i);
+    if (i < spec.size()) {
+        conversion = spec[i++];
+        if ((i != spec.size()) || (strchr("duxfeg", conversion) == NULL)) {
+            return false;
+        }
+    }
+
+    if (body.size() > LED_TEMPLATE_MAX_SPEC - 2) {
+        return false;
+    }
+
+    segment.integer = (strchr("dux", conversion) != NULL);
+    segment.sign = (conversion == 'd');
+    snprintf(segment.format, sizeof(segment.format), "%%%s%s%c",
+             body.c_str(), segment.integer ? "l" : "", conversion);
+    segment.whole[0] = '\0';
+    if (!precision && (body.size() == spec.size())) {
+        snprintf(segment.whole, sizeof(segment.whole), "%%%s.0f",
+                 body.c_str());
+    }
+
+    return true;
+}
+
+bool LedTemplate::parse(const string &text, string &error)
+{
+    vector<Segment> segments;
+    Segment literal;
+    uint64_t sources = 0;
+    size_t i = 0, end, colon;
+
+    literal.source = -1;
+    literal.format[0] = '\0';
+    literal.whole[0] = '\0';
+    literal.integer = false;
+    literal.sign = false;
+
+    while (i < text.size()) {
+        if ((text[i] == '}') && (i + 1 < text.size()) &&
+            (text[i + 1] == '}')) {
+            literal.literal += '}';
+            i += 2;
+            continue;
+        }
+        if (text[i] != '{') {
+            literal.literal += text[i++];
+            continue;
+        }
+        if ((i + 1 < text.size()) && (text[i + 1] == '{')) {
+            literal.literal += '{';
+            i += 2;
+            continue;
+        }
+
+        end = text.find('}', i);
+        if (end == string::npos) {
+            error = "unterminated field";
+            return false;
+        }
+
+        string field = text.substr(i + 1, end - i - 1);
+        string name, spec;
+        Segment segment;
+        int source;
+
+        colon = field.find(':');
+        name = field.substr(0, colon);
+        if (colon != string::npos) {
+            spec = field.substr(colon + 1);
+        }
+        if (name.empty() ||
+            (name.find_first_not_of("abcdefghijklmnopqrstuvwxyz0123456789_")
+             != string::npos)) {
+            error = "invalid source '" + name + "'";
+            return false;
+        }
+        if (!parseSpec(spec, segment)) {
+            error = "invalid format '" + spec + "'";
+            return false;
+        }
+
+        source = LiveValues::get().intern(name);
+        if (source < 0) {
+            error = "too many sources";
+            return false;
+        }
+
+        if (!literal.literal.empty()) {
+            segments.push_back(literal);
+            literal.literal.clear();
+        }
+        segment.source = source;
+        segments.push_back(segment);
+        sources |= 1ULL << source;
+        i = end + 1;
+    }
+
+    if (!literal.literal.empty()) {
+        segments.push_back(literal);
+    }
+
+    _text = text;
+    _segments = segments;
+    _sources = sources;
+
+    return true;
+}
+
+const string &LedTemplate::text(void) const
+{
+    return _text;
+}
+
+uint64_t LedTemplate::sources(void) const
+{
+    return _sources;
+}
+
+void LedTemplate::format(string &out) const
+{
+    LiveValues &live = LiveValues::get();
+    char buf[64];
+    double value;
+
+    out.clear();
+    for (vector<Segment>::const_iterator it = _segments.begin();
+         it != _segments.end(); it++) {
+        if (it->source < 0) {
+            out += it->literal;
+        } else if (!live.value(it->source, value)) {
+            out += '-';
+        } else {
+            if ((it->whole[0] != '\0') && (value == floor(value)) &&
+                (fabs(value) < 1e15)) {
+                snprintf(buf, sizeof(buf), it->whole, value);
+            } else if (!it->integer) {
+                snprintf(buf, sizeof(buf), it->format, value);
+            } else if (it->sign) {
+                snprintf(buf, sizeof(buf), it->format, (long) value);
+            } else {
+                snprintf(buf, sizeof(buf), it->format,
+                         (unsigned long) ((value < 0.0) ? 0.0 : value));
+            }
+            out += buf;
+        }
+    }
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,69 @@
+/*
+ * LedTemplate.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef LEDTEMPLATE_HXX
+#define LEDTEMPLATE_HXX
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#define LED_TEMPLATE_MAX_SPEC  15
+
+using namespace std;
+
+/*
+ * Row text with live values in it, such as "T {cpu_temp:.0f}C" or
+ * "UP {uppump_remaining}s". A field is a LiveValues source name and an
+ * optional printf conversion without the '%' (flags, width, precision
+ * and one of d, u, x, f, e, g). Without a conversion a whole value
+ * prints as an integer and any other as with g. "{{" and "}}" are
+ * literal braces, and a value not yet published shows as "-".
+ *
+ * The template is parsed once; sources() is the mask of the values
+ * that the text depends on.
+ */
+class LedTemplate {
+
+public:
+
+    LedTemplate();
+
+    bool parse(const string &text, string &error);
+    const string &text(void) const;
+    uint64_t sources(void) const;
+    void format(string &out) const;
+
+private:
+
+    struct Segment {
+        string literal;
+        int source;              // -1 for a literal
+        char format[LED_TEMPLATE_MAX_SPEC + 4];
+        char whole[LED_TEMPLATE_MAX_SPEC + 4];  // For whole values, if set
+        bool integer;
+        bool sign;
+    };
+
+    static bool parseSpec(const string &spec, Segment &segment);
+
+    string _text;
+    vector<Segment> _segments;
+    uint64_t _sources;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
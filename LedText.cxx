@@ -0,0 +1,76 @@
+/*
+ * LedText.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <cstring>
+#include <LedText.hxx>
+
+LedText::LedText()
+    : _len(0)
+{
+    _buf[0] = '\0';
+}
+
+LedText &LedText::operator=(const string &s)
+{
+    assign(s.data(), s.size());
+
+    return *this;
+}
+
+void LedText::assign(const char *s, size_t len)
+{
+    _len = fit(s, len);
+    memcpy(_buf, s, _len);
+    _buf[_len] = '\0';
+}
+
+const char *LedText::c_str(void) const
+{
+    return _buf;
+}
+
+size_t LedText::size(void) const
+{
+    return _len;
+}
+
+bool LedText::empty(void) const
+{
+    return _len == 0;
+}
+
+/*
+ * The length of the longest prefix that fits, backing up over UTF-8
+ * continuation bytes so that no character is cut in half.
+ */
+size_t LedText::fit(const char *s, size_t len)
+{
+    if (len <= LED_MAX_TEXT) {
+        return len;
+    }
+
+    len = LED_MAX_TEXT;
+    while ((len > 0) && ((s[len] & 0xc0) == 0x80)) {
+        len--;
+    }
+
+    return len;
+}
+
+size_t LedText::fit(const string &s)
+{
+    return fit(s.data(), s.size());
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
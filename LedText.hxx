@@ -0,0 +1,55 @@
+/*
+ * LedText.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef LEDTEXT_HXX
+#define LEDTEXT_HXX
+
+#include <stdint.h>
+#include <string>
+
+#define LED_MAX_TEXT  160    // Bytes of UTF-8 a row holds; the rest is cut
+
+using namespace std;
+
+/*
+ * Row text kept inline, so storing it never touches the heap and text
+ * from a mesh message cannot grow without bound. Text longer than
+ * LED_MAX_TEXT is cut at a character boundary.
+ */
+class LedText {
+
+public:
+
+    LedText();
+
+    LedText &operator=(const string &s);
+
+    void assign(const char *s, size_t len);
+    const char *c_str(void) const;
+    size_t size(void) const;
+    bool empty(void) const;
+
+    static size_t fit(const char *s, size_t len);
+    static size_t fit(const string &s);
+
+private:
+
+    char _buf[LED_MAX_TEXT + 1];
+    uint16_t _len;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,184 @@
+/*
+ * LiveValues.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <LiveValues.hxx>
+
+/*
+ * Never destroyed, so that the relays can still publish and the signs
+ * unbind from the cleanup at exit.
+ */
+LiveValues &LiveValues::get(void)
+{
+    static LiveValues *values = new LiveValues;
+
+    return *values;
+}
+
+LiveValues::LiveValues()
+{
+    _sources.reserve(LIVE_MAX_SOURCES);
+    for (unsigned int i = 0; i < LIVE_MAX_LISTENERS; i++) {
+        _subscribers[i].listener = NULL;
+        _subscribers[i].arg = NULL;
+    }
+}
+
+/*
+ * The id of a source, created if need be; -1 once the table is full.
+ */
+int LiveValues::intern(const string &name)
+{
+    int source = -1;
+
+    _mutex.lock();
+    for (unsigned int i = 0; i < _sources.size(); i++) {
+        if (_sources[i].name == name) {
+            source = (int) i;
+            goto done;
+        }
+    }
+
+    if (_sources.size() < LIVE_MAX_SOURCES) {
+        Source s;
+        s.name = name;
+        s.value = 0.0;
+        s.valid = false;
+        _sources.push_back(s);
+        source = (int) _sources.size() - 1;
+    }
+
+done:
+
+    _mutex.unlock();
+
+    return source;
+}
+
+int LiveValues::find(const string &name) const
+{
+    int source = -1;
+
+    _mutex.lock();
+    for (unsigned int i = 0; i < _sources.size(); i++) {
+        if (_sources[i].name == name) {
+            source = (int) i;
+            break;
+        }
+    }
+    _mutex.unlock();
+
+    return source;
+}
+
+/*
+ * Listeners are called on the producer's thread, after the lock is
+ * dropped, so they may read values back.
+ */
+void LiveValues::set(int source, double value)
+{
+    Subscriber subscribers[LIVE_MAX_LISTENERS];
+    bool changed = false;
+
+    _mutex.lock();
+    if ((source >= 0) && ((unsigned int) source < _sources.size()) &&
+        (!_sources[source].valid || (_sources[source].value != value))) {
+        _sources[source].value = value;
+        _sources[source].valid = true;
+        changed = true;
+        for (unsigned int i = 0; i < LIVE_MAX_LISTENERS; i++) {
+            subscribers[i] = _subscribers[i];
+        }
+    }
+    _mutex.unlock();
+
+    if (!changed) {
+        return;
+    }
+
+    for (unsigned int i = 0; i < LIVE_MAX_LISTENERS; i++) {
+        if (subscribers[i].listener != NULL) {
+            subscribers[i].listener(subscribers[i].arg, 1ULL << source);
+        }
+    }
+}
+
+bool LiveValues::value(int source, double &value) const
+{
+    bool valid = false;
+
+    _mutex.lock();
+    if ((source >= 0) && ((unsigned int) source < _sources.size())) {
+        value = _sources[source].value;
+        valid = _sources[source].valid;
+    }
+    _mutex.unlock();
+
+    return valid;
+}
+
+unsigned int LiveValues::count(void) const
+{
+    unsigned int count;
+
+    _mutex.lock();
+    count = _sources.size();
+    _mutex.unlock();
+
+    return count;
+}
+
+string LiveValues::name(int source) const
+{
+    string name;
+
+    _mutex.lock();
+    if ((source >= 0) && ((unsigned int) source < _sources.size())) {
+        name = _sources[source].name;
+    }
+    _mutex.unlock();
+
+    return name;
+}
+
+bool LiveValues::listen(Listener listener, void *arg)
+{
+    bool result = false;
+
+    _mutex.lock();
+    for (unsigned int i = 0; i < LIVE_MAX_LISTENERS; i++) {
+        if (_subscribers[i].listener == NULL) {
+            _subscribers[i].listener = listener;
+            _subscribers[i].arg = arg;
+            result = true;
+            break;
+        }
+    }
+    _mutex.unlock();
+
+    return result;
+}
+
+void LiveValues::unlisten(void *arg)
+{
+    _mutex.lock();
+    for (unsigned int i = 0; i < LIVE_MAX_LISTENERS; i++) {
+        if (_subscribers[i].arg == arg) {
+            _subscribers[i].listener = NULL;
+            _subscribers[i].arg = NULL;
+        }
+    }
+    _mutex.unlock();
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
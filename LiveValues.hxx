@@ -0,0 +1,78 @@
+/*
+ * LiveValues.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef LIVEVALUES_HXX
+#define LIVEVALUES_HXX
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#define LIVE_MAX_SOURCES    64     // One bit each in a dependency mask
+#define LIVE_MAX_LISTENERS  4
+
+using namespace std;
+
+/*
+ * Named live values (CPU temperature, relay states and timers) that LED
+ * rows can be bound to. Producers set them whenever they like; only a
+ * value that actually changed is passed on, as a bitmask of source ids,
+ * to the listeners. Nobody polls.
+ *
+ * A source comes into existence the first time it is named, so a row
+ * can be bound before its producer has published anything.
+ */
+class LiveValues {
+
+public:
+
+    typedef void (*Listener)(void *arg, uint64_t sources);
+
+    static LiveValues &get(void);
+
+    int intern(const string &name);
+    int find(const string &name) const;
+    void set(int source, double value);
+    bool value(int source, double &value) const;
+    unsigned int count(void) const;
+    string name(int source) const;
+
+    bool listen(Listener listener, void *arg);
+    void unlisten(void *arg);
+
+private:
+
+    LiveValues();
+
+    struct Source {
+        string name;
+        double value;
+        bool valid;              // Published at least once
+    };
+
+    struct Subscriber {
+        Listener listener;
+        void *arg;
+    };
+
+    mutable mutex _mutex;
+    vector<Source> _sources;
+    Subscriber _subscribers[LIVE_MAX_LISTENERS];
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,691 @@
+/*
+ * Logger.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <time.h>
+#include <unistd.h>
+#include <syslog.h>
+#include <cctype>
+#include <cstring>
+#include <Logger.hxx>
+
+#define LOG_RING_MASK    (LOG_RING_SIZE - 1)
+#define LOG_NO_STRING    UINT64_MAX
+#define LOG_PARTIAL_MAX  (4 * LOG_TEXT_SIZE)  // Logged even without '\n'
+
+// What vlog() has been given of the calling thread's current line
+static thread_local string partialLine;
+
+Logger::Logger()
+  : _tail(0),
+    _head(0),
+    _sinks(0),
+    _running(false),
+    _thread(NULL),
+    _file(NULL),
+    _fileBytes(0),
+    _maxBytes(0),
+    _keep(0),
+    _reopen(false),
+    _logged(0),
+    _dropped(0),
+    _rotations(0)
+{
+    for (uint64_t i = 0; i < LOG_RING_SIZE; i++) {
+        _ring[i].seq = i;
+    }
+
+    for (unsigned int i = 0; i < CAT_COUNT; i++) {
+        _levels[i] = LEVEL_INFO;
+    }
+}
+
+Logger::~Logger()
+{
+    stop();
+
+    if (_file != NULL) {
+        fclose(_file);
+        _file = NULL;
+    }
+
+    if (_sinks & SINK_SYSLOG) {
+        closelog();
+    }
+}
+
+Logger &Logger::get(void)
+{
+    static Logger logger;
+
+    return logger;
+}
+
+const char *Logger::levelName(Level level)
+{
+    static const char *names[LEVEL_COUNT] = {
+        "error",
+        "warn",
+        "info",
+        "debug",
+    };
+
+    if (level >= LEVEL_COUNT) {
+        return "?";
+    }
+
+    return names[level];
+}
+
+const char *Logger::categoryName(Category cat)
+{
+    static const char *names[CAT_COUNT] = {
+        "system",
+        "relay",
+        "led",
+        "mesh",
+        "shell",
+    };
+
+    if (cat >= CAT_COUNT) {
+        return "?";
+    }
+
+    return names[cat];
+}
+
+bool Logger::parseLevel(const string &s, Level &level)
+{
+    for (unsigned int i = 0; i < LEVEL_COUNT; i++) {
+        if (s == levelName((Level) i)) {
+            level = (Level) i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Logger::parseCategory(const string &s, Category &cat)
+{
+    for (unsigned int i = 0; i < CAT_COUNT; i++) {
+        if (s == categoryName((Category) i)) {
+            cat = (Category) i;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool Logger::setFile(const string &path, unsigned long maxBytes,
+                     unsigned int keep)
+{
+    bool result = false;
+    FILE *file;
+
+    file = fopen(path.c_str(), "a");
+    if (file == NULL) {
+        goto done;
+    }
+
+    _mutex.lock();
+    if (_file != NULL) {
+        fclose(_file);
+    }
+    _file = file;
+    fseek(_file, 0, SEEK_END);
+    _fileBytes = ftell(_file);
+    _path = path;
+    _maxBytes = maxBytes;
+    _keep = keep;
+    _mutex.unlock();
+
+    result = true;
+
+done:
+
+    return result;
+}
+
+void Logger::setSinks(unsigned int sinks)
+{
+    if ((sinks & SINK_SYSLOG) && !(_sinks & SINK_SYSLOG)) {
+        openlog("meshpump", LOG_PID, LOG_DAEMON);
+    }
+
+    _sinks = sinks;
+}
+
+unsigned int Logger::sinks(void) const
+{
+    return _sinks;
+}
+
+void Logger::setLevel(Level level)
+{
+    for (unsigned int i = 0; i < CAT_COUNT; i++) {
+        _levels[i] = level;
+    }
+}
+
+void Logger::setLevel(Category cat, Level level)
+{
+    if (cat < CAT_COUNT) {
+        _levels[cat] = level;
+    }
+}
+
+Logger::Level Logger::level(Category cat) const
+{
+    return _levels[cat];
+}
+
+void Logger::start(void)
+{
+    if (_thread == NULL) {
+        _running = true;
+        _thread = make_shared<thread>(Logger::thread_func, this);
+    }
+}
+
+void Logger::stop(void)
+{
+    if (_thread != NULL) {
+        _running = false;
+        if (_thread->joinable()) {
+            _thread->join();
+        }
+        _thread = NULL;
+    }
+
+    _mutex.lock();
+    drain();
+    _mutex.unlock();
+}
+
+/*
+ * Reopens the log file after an external rotation (e.g. logrotate).
+ */
+void Logger::reopen(void)
+{
+    _reopen = true;
+    if (!_running) {
+        _mutex.lock();
+        reopenFile();
+        _mutex.unlock();
+    }
+}
+
+void Logger::getStats(unsigned long &logged, unsigned long &dropped,
+                      unsigned long &rotations) const
+{
+    logged = _logged;
+    dropped = _dropped;
+    rotations = _rotations;
+}
+
+/*
+ * printf-style output, such as libmeshtastic's, arrives in fragments
+ * that need not end a line. The fragments are collected per thread and
+ * each complete line becomes one record, cut to fit only after it was
+ * formatted in full.
+ */
+int Logger::vlog(Level level, Category cat, const char *format, va_list ap)
+{
+    char text[LOG_TEXT_SIZE];
+    va_list aq;
+    size_t start = 0, end, len;
+    int ret;
+
+    // A va_list cannot outlive the call, so this path formats eagerly
+    va_copy(aq, ap);
+    ret = vsnprintf(text, sizeof(text), format, aq);
+    va_end(aq);
+    if (ret <= 0) {
+        goto done;
+    }
+
+    if ((size_t) ret < sizeof(text)) {
+        partialLine.append(text, ret);
+    } else {
+        len = partialLine.size();
+        partialLine.resize(len + ret + 1);
+        vsnprintf(&partialLine[len], ret + 1, format, ap);
+        partialLine.resize(len + ret);
+    }
+
+    while ((end = partialLine.find('\n', start)) != string::npos) {
+        logText(level, cat, partialLine.data() + start, end - start);
+        start = end + 1;
+    }
+    partialLine.erase(0, start);
+
+    if (partialLine.size() >= LOG_PARTIAL_MAX) {
+        logText(level, cat, partialLine.data(), partialLine.size());
+        partialLine.clear();
+    }
+
+done:
+
+    return ret;
+}
+
+void Logger::logText(Level level, Category cat, const char *text,
+                     size_t len)
+{
+    Record *rec;
+    uint64_t pos;
+
+    if (!enabled(level, cat)) {
+        return;
+    }
+
+    while ((len > 0) && (text[len - 1] == '\r')) {
+        len--;
+    }
+    if (len == 0) {
+        return;
+    }
+    if (len >= LOG_TEXT_SIZE) {
+        len = LOG_TEXT_SIZE - 1;
+    }
+
+    rec = claim(pos);
+    if (rec == NULL) {
+        return;
+    }
+
+    rec->level = level;
+    rec->category = cat;
+    rec->format = NULL;
+    rec->nargs = 0;
+    memcpy(rec->text, text, len);
+    rec->text[len] = '\0';
+    rec->textLen = len + 1;
+    publish(rec, pos);
+}
+
+Logger::Record *Logger::claim(uint64_t &pos)
+{
+    Record *rec;
+    uint64_t seq;
+    int64_t dif;
+    struct timespec ts;
+
+    pos = _tail.load(memory_order_relaxed);
+    for (;;) {
+        rec = &_ring[pos & LOG_RING_MASK];
+        seq = rec->seq.load(memory_order_acquire);
+        dif = (int64_t) seq - (int64_t) pos;
+        if (dif == 0) {
+            if (_tail.compare_exchange_weak(pos, pos + 1,
+                                            memory_order_relaxed)) {
+                break;
+            }
+        } else if (dif < 0) {
+            _dropped++;
+            return NULL;
+        } else {
+            pos = _tail.load(memory_order_relaxed);
+        }
+    }
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    rec->timestamp = ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+
+    return rec;
+}
+
+void Logger::publish(Record *rec, uint64_t pos)
+{
+    rec->seq.store(pos + 1, memory_order_release);
+    _logged++;
+
+    if (!_running) {
+        _mutex.lock();
+        drain();
+        _mutex.unlock();
+    }
+}
+
+void Logger::packInt(Record *rec, int64_t v)
+{
+    if (rec->nargs < LOG_MAX_ARGS) {
+        rec->types[rec->nargs] = ARG_INT;
+        rec->args[rec->nargs].i = v;
+        rec->nargs++;
+    }
+}
+
+void Logger::packUint(Record *rec, uint64_t v)
+{
+    if (rec->nargs < LOG_MAX_ARGS) {
+        rec->types[rec->nargs] = ARG_UINT;
+        rec->args[rec->nargs].u = v;
+        rec->nargs++;
+    }
+}
+
+void Logger::packArg(Record *rec, double v)
+{
+    if (rec->nargs < LOG_MAX_ARGS) {
+        rec->types[rec->nargs] = ARG_DOUBLE;
+        rec->args[rec->nargs].d = v;
+        rec->nargs++;
+    }
+}
+
+void Logger::packArg(Record *rec, const char *v)
+{
+    size_t room, len;
+
+    if (rec->nargs >= LOG_MAX_ARGS) {
+        return;
+    }
+
+    rec->types[rec->nargs] = ARG_STRING;
+    rec->args[rec->nargs].u = LOG_NO_STRING;
+    room = LOG_TEXT_SIZE - rec->textLen;
+    if ((v != NULL) && (room > 0)) {
+        len = strnlen(v, room - 1);
+        memcpy(rec->text + rec->textLen, v, len);
+        rec->text[rec->textLen + len] = '\0';
+        rec->args[rec->nargs].u = rec->textLen;
+        rec->textLen += len + 1;
+    }
+    rec->nargs++;
+}
+
+/*
+ * Expands the deferred arguments against the format. Length modifiers
+ * are replaced, since every integer was widened to 64 bits when packed.
+ */
+void Logger::format(const Record *rec, string &line)
+{
+    const char *p = rec->format;
+    const char *start, *length;
+    unsigned int arg = 0;
+    char spec[32];
+    char buf[LOG_TEXT_SIZE + 32];
+    size_t n;
+    char conv;
+    uint8_t type;
+    int64_t i;
+    double d;
+    const char *s;
+
+    if (p == NULL) {
+        line += rec->text;
+        return;
+    }
+
+    while (*p != '\0') {
+        if (*p != '%') {
+            line += *p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            line += '%';
+            p += 2;
+            continue;
+        }
+
+        start = p++;
+        while ((*p != '\0') && (strchr("-+ #0", *p) != NULL)) {
+            p++;
+        }
+        while (isdigit(*p) || (*p == '.')) {
+            p++;
+        }
+        length = p;
+        while ((*p != '\0') && (strchr("hlLqjzt", *p) != NULL)) {
+            p++;
+        }
+        conv = *p;
+        if (conv == '\0') {
+            break;
+        }
+        p++;
+
+        n = length - start;
+        if (n > (sizeof(spec) - 4)) {
+            n = sizeof(spec) - 4;
+        }
+        memcpy(spec, start, n);
+
+        if (arg >= rec->nargs) {
+            line += "<?>";
+            continue;
+        }
+
+        type = rec->types[arg];
+        i = (type == ARG_DOUBLE) ? (int64_t) rec->args[arg].d :
+            (type == ARG_STRING) ? 0 : rec->args[arg].i;
+        d = (type == ARG_DOUBLE) ? rec->args[arg].d :
+            (type == ARG_UINT) ? (double) rec->args[arg].u :
+            (type == ARG_INT) ? (double) rec->args[arg].i : 0.0;
+        s = ((type == ARG_STRING) && (rec->args[arg].u != LOG_NO_STRING)) ?
+            rec->text + rec->args[arg].u : "";
+        arg++;
+
+        buf[0] = '\0';
+        switch (conv) {
+        case 'd':
+        case 'i':
+            memcpy(spec + n, "lld", 4);
+            snprintf(buf, sizeof(buf), spec, (long long) i);
+            break;
+        case 'u':
+        case 'x':
+        case 'X':
+        case 'o':
+            spec[n] = 'l';
+            spec[n + 1] = 'l';
+            spec[n + 2] = conv;
+            spec[n + 3] = '\0';
+            snprintf(buf, sizeof(buf), spec, (unsigned long long) i);
+            break;
+        case 'c':
+            memcpy(spec + n, "c", 2);
+            snprintf(buf, sizeof(buf), spec, (int) i);
+            break;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+            spec[n] = conv;
+            spec[n + 1] = '\0';
+            snprintf(buf, sizeof(buf), spec, d);
+            break;
+        case 's':
+            memcpy(spec + n, "s", 2);
+            snprintf(buf, sizeof(buf), spec, s);
+            break;
+        default:
+            snprintf(buf, sizeof(buf), "<%%%c?>", conv);
+            break;
+        }
+        line += buf;
+    }
+}
+
+void *Logger::thread_func(void *args)
+{
+    Logger *logger = (Logger *) args;
+
+    logger->run();
+
+    return NULL;
+}
+
+void Logger::run(void)
+{
+    bool busy;
+
+    while (_running) {
+        _mutex.lock();
+        if (_reopen) {
+            reopenFile();
+        }
+        busy = drain();
+        _mutex.unlock();
+
+        if (!busy) {
+            usleep(10000);
+        }
+    }
+}
+
+/*
+ * Emits every published record in order. Called with _mutex held.
+ */
+bool Logger::drain(void)
+{
+    bool busy = false;
+    Record *rec;
+
+    for (;;) {
+        rec = &_ring[_head & LOG_RING_MASK];
+        if (rec->seq.load(memory_order_acquire) != (_head + 1)) {
+            break;
+        }
+
+        emit(rec);
+        rec->seq.store(_head + LOG_RING_SIZE, memory_order_release);
+        _head++;
+        busy = true;
+    }
+
+    if (busy) {
+        if (_sinks & SINK_STDOUT) {
+            fflush(stdout);
+        }
+        if (_file != NULL) {
+            fflush(_file);
+        }
+    }
+
+    return busy;
+}
+
+void Logger::emit(const Record *rec)
+{
+    static const int priorities[LEVEL_COUNT] = {
+        LOG_ERR,
+        LOG_WARNING,
+        LOG_INFO,
+        LOG_DEBUG,
+    };
+    unsigned int sinks = _sinks;
+    string message, line;
+    char prefix[64];
+    struct tm tm;
+    time_t secs;
+    size_t n;
+
+    format(rec, message);
+
+    secs = rec->timestamp / 1000000000ULL;
+    localtime_r(&secs, &tm);
+    n = strftime(prefix, sizeof(prefix), "%Y-%m-%d %H:%M:%S", &tm);
+    snprintf(prefix + n, sizeof(prefix) - n, ".%03u %-5s %s: ",
+             (unsigned int) ((rec->timestamp / 1000000ULL) % 1000),
+             levelName((Level) rec->level),
+             categoryName((Category) rec->category));
+    line = prefix + message + "\n";
+
+    if (sinks == 0) {
+        fputs(line.c_str(), stderr);
+        return;
+    }
+
+    if (sinks & SINK_STDOUT) {
+        fputs(line.c_str(), stdout);
+    }
+
+    if ((sinks & SINK_FILE) && (_file != NULL)) {
+        writeFile(line);
+    }
+
+    if (sinks & SINK_SYSLOG) {
+        syslog(priorities[rec->level], "%s: %s",
+               categoryName((Category) rec->category), message.c_str());
+    }
+}
+
+void Logger::writeFile(const string &line)
+{
+    if ((_maxBytes > 0) && ((_fileBytes + line.size()) > _maxBytes)) {
+        rotate();
+        _rotations++;
+        if (_file == NULL) {
+            return;
+        }
+    }
+
+    fputs(line.c_str(), _file);
+    _fileBytes += line.size();
+}
+
+/*
+ * Shifts path.N-1 .. path.1 up by one, moves path to path.1 and starts
+ * a new file.
+ */
+void Logger::rotate(void)
+{
+    string from, to;
+
+    if (_file != NULL) {
+        fclose(_file);
+        _file = NULL;
+    }
+
+    for (unsigned int i = _keep; i > 1; i--) {
+        from = _path + "." + to_string(i - 1);
+        to = _path + "." + to_string(i);
+        rename(from.c_str(), to.c_str());
+    }
+    if (_keep > 0) {
+        to = _path + ".1";
+        rename(_path.c_str(), to.c_str());
+    } else {
+        unlink(_path.c_str());
+    }
+
+    reopenFile();
+}
+
+void Logger::reopenFile(void)
+{
+    _reopen = false;
+
+    if (_path.empty()) {
+        return;
+    }
+
+    if (_file != NULL) {
+        fclose(_file);
+    }
+
+    _file = fopen(_path.c_str(), "a");
+    _fileBytes = 0;
+    if (_file != NULL) {
+        fseek(_file, 0, SEEK_END);
+        _fileBytes = ftell(_file);
+    }
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
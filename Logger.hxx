@@ -0,0 +1,238 @@
+/*
+ * Logger.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef LOGGER_HXX
+#define LOGGER_HXX
+
+#include <stdint.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#define LOG_RING_SIZE   1024  // Must be a power of 2
+#define LOG_MAX_ARGS    8
+#define LOG_TEXT_SIZE   160
+
+using namespace std;
+
+/*
+ * Leveled, categorized logging that never blocks the caller.
+ *
+ * A record is claimed from a fixed ring of slots (bounded MPSC queue,
+ * one sequence number per slot), filled with the format pointer and
+ * the raw argument values, and published. A background writer formats
+ * it and hands the line to the rotating file, syslog and/or stdout. If
+ * the ring is full the record is counted as dropped.
+ *
+ * The format must be a string literal; string arguments are copied
+ * into the record. Before start(), and in tools that never start the
+ * writer, records are formatted synchronously to stderr.
+ */
+class Logger {
+
+public:
+
+    enum Level {
+        LEVEL_ERROR = 0,
+        LEVEL_WARN,
+        LEVEL_INFO,
+        LEVEL_DEBUG,
+        LEVEL_COUNT,
+    };
+
+    enum Category {
+        CAT_SYSTEM = 0,
+        CAT_RELAY,
+        CAT_LED,
+        CAT_MESH,
+        CAT_SHELL,
+        CAT_COUNT,
+    };
+
+    enum Sink {
+        SINK_STDOUT = 0x1,
+        SINK_FILE = 0x2,
+        SINK_SYSLOG = 0x4,
+    };
+
+    static Logger &get(void);
+    static const char *levelName(Level level);
+    static const char *categoryName(Category cat);
+    static bool parseLevel(const string &s, Level &level);
+    static bool parseCategory(const string &s, Category &cat);
+
+    bool setFile(const string &path, unsigned long maxBytes,
+                 unsigned int keep);
+    void setSinks(unsigned int sinks);
+    unsigned int sinks(void) const;
+    void setLevel(Level level);
+    void setLevel(Category cat, Level level);
+    Level level(Category cat) const;
+
+    void start(void);
+    void stop(void);
+    void reopen(void);
+
+    void getStats(unsigned long &logged, unsigned long &dropped,
+                  unsigned long &rotations) const;
+
+    inline bool enabled(Level level, Category cat) const {
+        return level <= _levels[cat];
+    }
+
+    template <typename... Args>
+    void log(Level level, Category cat, const char *format,
+             Args... args) {
+        Record *rec;
+        uint64_t pos;
+
+        if (!enabled(level, cat)) {
+            return;
+        }
+
+        rec = claim(pos);
+        if (rec == NULL) {
+            return;
+        }
+
+        rec->level = level;
+        rec->category = cat;
+        rec->format = format;
+        rec->nargs = 0;
+        rec->textLen = 0;
+        pack(rec, args...);
+        publish(rec, pos);
+    }
+
+    template <typename... Args>
+    void error(Category cat, const char *format, Args... args) {
+        log(LEVEL_ERROR, cat, format, args...);
+    }
+
+    template <typename... Args>
+    void warn(Category cat, const char *format, Args... args) {
+        log(LEVEL_WARN, cat, format, args...);
+    }
+
+    template <typename... Args>
+    void info(Category cat, const char *format, Args... args) {
+        log(LEVEL_INFO, cat, format, args...);
+    }
+
+    template <typename... Args>
+    void debug(Category cat, const char *format, Args... args) {
+        log(LEVEL_DEBUG, cat, format, args...);
+    }
+
+    int vlog(Level level, Category cat, const char *format, va_list ap);
+
+private:
+
+    enum ArgType {
+        ARG_INT = 0,
+        ARG_UINT,
+        ARG_DOUBLE,
+        ARG_STRING,
+    };
+
+    struct Record {
+        atomic<uint64_t> seq;
+        uint64_t timestamp;
+        const char *format;  // NULL if text is already formatted
+        uint8_t level;
+        uint8_t category;
+        uint8_t nargs;
+        uint8_t types[LOG_MAX_ARGS];
+        union {
+            int64_t i;
+            uint64_t u;
+            double d;
+        } args[LOG_MAX_ARGS];
+        uint16_t textLen;
+        char text[LOG_TEXT_SIZE];
+    };
+
+    Logger();
+    ~Logger();
+
+    Record *claim(uint64_t &pos);
+    void publish(Record *rec, uint64_t pos);
+    void logText(Level level, Category cat, const char *text, size_t len);
+
+    static void pack(Record *rec) { (void)(rec); }
+
+    template <typename T, typename... Rest>
+    static void pack(Record *rec, T first, Rest... rest) {
+        packArg(rec, first);
+        pack(rec, rest...);
+    }
+
+    static void packInt(Record *rec, int64_t v);
+    static void packUint(Record *rec, uint64_t v);
+    static void packArg(Record *rec, int v) { packInt(rec, v); }
+    static void packArg(Record *rec, long v) { packInt(rec, v); }
+    static void packArg(Record *rec, long long v) { packInt(rec, v); }
+    static void packArg(Record *rec, char v) { packInt(rec, v); }
+    static void packArg(Record *rec, bool v) { packUint(rec, v); }
+    static void packArg(Record *rec, unsigned int v) { packUint(rec, v); }
+    static void packArg(Record *rec, unsigned long v) { packUint(rec, v); }
+    static void packArg(Record *rec, unsigned long long v) {
+        packUint(rec, v);
+    }
+    static void packArg(Record *rec, double v);
+    static void packArg(Record *rec, const char *v);
+    static void packArg(Record *rec, const string &v) {
+        packArg(rec, v.c_str());
+    }
+
+    static void format(const Record *rec, string &line);
+
+    static void *thread_func(void *);
+    void run(void);
+    bool drain(void);
+    void emit(const Record *rec);
+    void writeFile(const string &line);
+    void rotate(void);
+    void reopenFile(void);
+
+    Record _ring[LOG_RING_SIZE];
+    atomic<uint64_t> _tail;
+    uint64_t _head;
+
+    atomic<Level> _levels[CAT_COUNT];
+    atomic<unsigned int> _sinks;
+    atomic<bool> _running;
+    shared_ptr<thread> _thread;
+
+    mutex _mutex;  // Held by whoever drains the ring
+    string _path;
+    FILE *_file;
+    unsigned long _fileBytes;
+    unsigned long _maxBytes;
+    unsigned int _keep;
+    atomic<bool> _reopen;
+
+    atomic<unsigned long> _logged;
+    atomic<unsigned long> _dropped;
+    atomic<unsigned long> _rotations;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,224 @@
+/*
+ * Max7219Chain.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <hw.h>
+#include <max7219_defs.h>
+#include <Max7219Chain.hxx>
+#include <Logger.hxx>
+
+#define MAX7219_SPI_SPEED  1000000
+#define MAX7219_SPI_MODE                    \
+    PI_SPI_FLAGS_BITLEN(0)   |              \
+    PI_SPI_FLAGS_RX_LSB(0)   |              \
+    PI_SPI_FLAGS_TX_LSB(0)   |              \
+    PI_SPI_FLAGS_3WREN(0)    |              \
+    PI_SPI_FLAGS_3WIRE(0)    |              \
+    PI_SPI_FLAGS_AUX_SPI(0)  |              \
+    PI_SPI_FLAGS_RESVD(0)    |              \
+    PI_SPI_FLAGS_CSPOLS(0)   |              \
+    PI_SPI_FLAGS_MODE(0)
+
+Max7219Chain::Max7219Chain(unsigned int channel, unsigned int modules)
+    : _modules(modules),
+      _frames(0),
+      _next(modules, 0),
+      _shadow(modules * MAX7219_REG_COUNT, 0),
+      _valid(modules, 0),
+      _stats()
+{
+    _handle = spi_open(channel, MAX7219_SPI_SPEED, MAX7219_SPI_MODE);
+    if (_handle < 0) {
+        Logger::get().error(Logger::CAT_LED, "spiOpen failed!");
+        exit(EXIT_FAILURE);
+    }
+}
+
+Max7219Chain::~Max7219Chain()
+{
+    if (_handle >= 0) {
+        spi_close(_handle);
+        _handle = -1;
+    }
+}
+
+unsigned int Max7219Chain::modules(void) const
+{
+    return _modules;
+}
+
+uint8_t *Max7219Chain::slot(unsigned int frame, unsigned int module)
+{
+    return &_batch[((frame * _modules) + module) * 2];
+}
+
+/*
+ * Queues a write into the first frame in which the module is still
+ * free, after the frame holding its previous write.
+ */
+void Max7219Chain::put(unsigned int module, uint8_t reg, uint8_t data)
+{
+    uint8_t *p;
+
+    if ((module >= _modules) || (reg >= MAX7219_REG_COUNT)) {
+        return;
+    }
+
+    if (_next[module] == _frames) {
+        // A new frame is all NOOPs
+        _batch.resize((_frames + 1) * _modules * 2, NOOP_REG);
+        _frames++;
+    }
+
+    p = slot(_next[module], module);
+    p[0] = reg;
+    p[1] = data;
+    _next[module]++;
+
+    _shadow[(module * MAX7219_REG_COUNT) + reg] = data;
+    _valid[module] |= (1 << reg);
+}
+
+/*
+ * Like put(), but only if the register doesn't hold the data already.
+ */
+bool Max7219Chain::update(unsigned int module, uint8_t reg, uint8_t data)
+{
+    if ((module >= _modules) || (reg >= MAX7219_REG_COUNT)) {
+        return false;
+    }
+
+    if ((_valid[module] & (1 << reg)) &&
+        (_shadow[(module * MAX7219_REG_COUNT) + reg] == data)) {
+        _stats.elided++;
+        return false;
+    }
+
+    put(module, reg, data);
+
+    return true;
+}
+
+void Max7219Chain::broadcast(uint8_t reg, uint8_t data)
+{
+    for (unsigned int m = 0; m < _modules; m++) {
+        put(m, reg, data);
+    }
+}
+
+/*
+ * Re-initializes one module, e.g. one that picked up a glitch: the
+ * mode registers are queued now, and since its shadow is forgotten the
+ * owner's next update()s resend everything else.
+ */
+void Max7219Chain::setup(unsigned int module)
+{
+    invalidate(module);
+    put(module, DECODE_MODE_REG, 0);
+    put(module, SCAN_LIMIT_REG, MAX7219_SCAN_DIGITS - 1);
+    put(module, DISPLAY_TEST_REG, 0);
+}
+
+void Max7219Chain::invalidate(unsigned int module)
+{
+    if (module < _modules) {
+        _valid[module] = 0;
+    }
+}
+
+size_t Max7219Chain::pending(void) const
+{
+    return _frames;
+}
+
+int Max7219Chain::flush(void)
+{
+    int ret = 0;
+    unsigned int size = _modules * 2;
+    unsigned int f, m;
+
+    for (f = 0; f < _frames; f++) {
+        if (spi_write(_handle, (char *) slot(f, 0), size) != (int) size) {
+            Logger::get().error(Logger::CAT_LED, "spi_write failed!");
+            ret = -1;
+            continue;
+        }
+
+        _stats.frames++;
+        _stats.bytes += size;
+        for (m = 0; m < _modules; m++) {
+            if (slot(f, m)[0] != NOOP_REG) {
+                _stats.writes++;
+            }
+        }
+    }
+
+    _batch.clear();
+    _frames = 0;
+    for (m = 0; m < _modules; m++) {
+        _next[m] = 0;
+    }
+
+    return ret;
+}
+
+bool Max7219Chain::isShutdown(unsigned int module) const
+{
+    if (module >= _modules) {
+        return false;
+    }
+
+    return (_valid[module] & (1 << SHUTDOWN_REG)) &&
+        (_shadow[(module * MAX7219_REG_COUNT) + SHUTDOWN_REG] == 0);
+}
+
+/*
+ * Estimated from the shadow registers: every lit segment draws the
+ * segment current for its digit's share of the scan, scaled by the
+ * intensity duty cycle of (2n + 1) / 32.
+ */
+double Max7219Chain::currentMa(void) const
+{
+    double total = 0.0;
+    const uint8_t *regs;
+    unsigned int m, d, lit, digits;
+
+    for (m = 0; m < _modules; m++) {
+        if (isShutdown(m)) {
+            total += MAX7219_ISHDN_MA;
+            continue;
+        }
+
+        regs = &_shadow[m * MAX7219_REG_COUNT];
+        digits = (regs[SCAN_LIMIT_REG] & 0x7) + 1;
+        lit = 0;
+        for (d = 0; d < digits; d++) {
+            lit += __builtin_popcount(regs[DIGIT0_REG + d]);
+        }
+
+        total += MAX7219_IQ_MA +
+            (lit * MAX7219_ISEG_MA *
+             (((regs[INTENSITY_REG] & 0xf) * 2) + 1) / 32.0 / digits);
+    }
+
+    return total;
+}
+
+const Max7219Stats &Max7219Chain::stats(void) const
+{
+    return _stats;
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,98 @@
+/*
+ * Max7219Chain.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef MAX7219CHAIN_HXX
+#define MAX7219CHAIN_HXX
+
+#include <stdint.h>
+#include <vector>
+
+#define MAX7219_REG_COUNT    16
+#define MAX7219_SCAN_DIGITS  8
+
+// Current estimate: segment current set by RSET, supply current of an
+// active chip with all segments off, and of a chip in shutdown
+#define MAX7219_ISEG_MA      40.0
+#define MAX7219_IQ_MA        8.0
+#define MAX7219_ISHDN_MA     0.15
+
+using namespace std;
+
+struct Max7219Stats {
+    unsigned long frames;        // Chain frames sent
+    unsigned long bytes;         // Bytes sent
+    unsigned long writes;        // Register writes sent
+    unsigned long elided;        // Writes dropped as already in place
+};
+
+/*
+ * A daisy chain of MAX7219s behind one SPI chip select. A frame is one
+ * register/data pair per module, latched by all of them together when
+ * chip select rises; modules that have nothing to do in a frame get a
+ * NOOP. Module 0 is the first pair clocked out, i.e. the chip furthest
+ * from the Pi.
+ *
+ * Writes are queued into a batch and packed into as few frames as
+ * possible, keeping each module's writes in order, and flush() sends
+ * the whole batch back to back. Every frame still needs its own chip
+ * select edge, so a batch is one spi_write() per frame.
+ *
+ * The chain keeps a shadow of every register it has written, so that
+ * update() drops writes that would not change anything. invalidate()
+ * forgets a module's shadow so everything is sent again.
+ *
+ * Not thread-safe; the owner serializes access.
+ */
+class Max7219Chain {
+
+public:
+
+    Max7219Chain(unsigned int channel, unsigned int modules);
+    ~Max7219Chain();
+
+    unsigned int modules(void) const;
+
+    void put(unsigned int module, uint8_t reg, uint8_t data);
+    bool update(unsigned int module, uint8_t reg, uint8_t data);
+    void broadcast(uint8_t reg, uint8_t data);
+    void setup(unsigned int module);
+    void invalidate(unsigned int module);
+    size_t pending(void) const;
+    int flush(void);
+
+    bool isShutdown(unsigned int module) const;
+    double currentMa(void) const;
+    const Max7219Stats &stats(void) const;
+
+private:
+
+    uint8_t *slot(unsigned int frame, unsigned int module);
+
+    int _handle;
+    unsigned int _modules;
+
+    vector<uint8_t> _batch;      // Queued frames, _modules pairs each
+    unsigned int _frames;
+    vector<unsigned int> _next;  // First frame each module is free in
+
+    vector<uint8_t> _shadow;     // _modules x MAX7219_REG_COUNT
+    vector<uint16_t> _valid;     // Bit per register, per module
+
+    Max7219Stats _stats;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -7,7 +7,7 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <sys/ioctl.h>
-#include <pigpiod_if.h>
+#include <hw.h>
 #include <csignal>
 #include <sstream>
 #include <iostream>
@@ -16,30 +16,62 @@
 #include <ctime>
 #include <MeshPump.hxx>
 #include <LedMatrix.hxx>
+#include <StatusModel.hxx>
+#include <Clock.hxx>
+#include <LatencyTracer.hxx>
+#include <Logger.hxx>
+#include <HistoryStore.hxx>
+#include <AllocStats.hxx>
+#include <LiveValues.hxx>
 
 extern shared_ptr<MeshPump> meshpump;
 extern shared_ptr<LedMatrix> ledMatrix;
-
-MeshPump::MeshPump()
-    : MeshClient()
+extern shared_ptr<StatusModel> statusModel;
+extern shared_ptr<HistoryStore> historyStore;
+
+MeshPump::MeshPump(const vector<RelayChannel> &relays)
+    : MeshClient(),
+      _cpuTempSampled(0),
+      _liveCpuTemp(-1),
+      _batchDepth(0),
+      _batchSet(0),
+      _batchClear(0),
+      _commands(0),
+      _runtimeLoaded(false),
+      _runtimeSavedHour(-1),
+      _heartbeat("mesh", MESH_HEARTBEAT_TIMEOUT_MS)
 {
-    signal(SIGALRM, alarmHandler);
+    string error;
+
+    Clock::get()->setAlarmHandler(alarmHandler);
+
+    for (vector<RelayChannel>::const_iterator it = relays.begin();
+         it != relays.end(); it++) {
+        if (_relays.add(*it, error) == false) {
+            Logger::get().error(Logger::CAT_RELAY, "%s", error);
+            continue;
+        }
+        set_mode(it->pin, PI_OUTPUT);
+    }
 
-    set_mode(RELAY1_PIN, PI_OUTPUT);
-    set_mode(RELAY2_PIN, PI_OUTPUT);
-    set_mode(RELAY3_PIN, PI_OUTPUT);
+    // Names as templates spell them: "up-pump" gives "uppump_on"
+    _liveCpuTemp = LiveValues::get().intern("cpu_temp");
+    _live.resize(_relays.size());
+    for (unsigned int i = 0; i < _relays.size(); i++) {
+        string name = _relays[i].name;
 
-    setFishPumpOnOff(true);
-    setUpPumpOnOff(false);
-    setUpPumpAutoCutoffSec(10);
-    setLightingOnOff(false);
+        name.erase(remove(name.begin(), name.end(), '-'), name.end());
+        _live[i].on = LiveValues::get().intern(name + "_on");
+        _live[i].remaining = LiveValues::get().intern(name + "_remaining");
+        _live[i].run = LiveValues::get().intern(name + "_run");
+    }
+
+    resetRelays();
 }
 
 MeshPump::~MeshPump()
 {
-    setFishPumpOnOff(true);
-    setUpPumpOnOff(false);
-    setLightingOnOff(false);
+    resetRelays();
 }
 
 void MeshPump::join(void)
@@ -47,116 +79,614 @@ void MeshPump::join(void)
     MeshClient::join();
 }
 
-bool MeshPump::isFishPumpOn(void) const
+unsigned int MeshPump::relayCount(void) const
 {
-    return _fishPump;
+    return _relays.size();
 }
 
-void MeshPump::setFishPumpOnOff(bool onOff)
+int MeshPump::findRelay(const string &name) const
 {
-    _fishPump = onOff;
-    gpio_write(RELAY1_PIN, !onOff);
-    if (ledMatrix) {
-        if (onOff) {
-            ledMatrix->setText(3, "  ON", 60);
-        } else {
-            ledMatrix->setText(3, " OFF", UINT_MAX);
-        }
+    string lower = name;
+
+    toLowercase(lower);
+
+    return _relays.find(lower);
+}
+
+string MeshPump::relayName(unsigned int index) const
+{
+    if (index >= _relays.size()) {
+        return "";
     }
+
+    return _relays[index].name;
 }
 
-void MeshPump::alarmHandler(int signum)
+bool MeshPump::isRelayOn(unsigned int index) const
 {
-    if (signum == SIGALRM) {
-        meshpump->setUpPumpOnOff(false);
+    bool on = false;
+
+    _relayMutex.lock();
+    if (index < _relays.size()) {
+        on = _relays[index].on;
     }
+    _relayMutex.unlock();
+
+    return on;
 }
 
-bool MeshPump::isUpPumpOn(void) const
+bool MeshPump::isRelayAllowed(unsigned int index, uint32_t node_num) const
 {
-    return _upPump;
+    const vector<uint32_t> *nodes;
+
+    if (index >= _relays.size()) {
+        return false;
+    }
+
+    nodes = &_relays[index].nodes;
+
+    return nodes->empty() ||
+        (find(nodes->begin(), nodes->end(), node_num) != nodes->end());
 }
 
-void MeshPump::setUpPumpOnOff(bool onOff)
+/*
+ * Resolves the on-time for switching a relay on: the requested seconds,
+ * else its auto cutoff, else its max on-time. Returns false if the
+ * request exceeds the max on-time.
+ */
+bool MeshPump::relayOnTime(unsigned int index, unsigned int requested,
+                           unsigned int &seconds) const
 {
-    if (onOff) {
-        setUpPumpOnWithCutoffSec(getUpPumpAutoCutoffSec());
-    } else {
-        gpio_write(RELAY2_PIN, !onOff);
-        if (ledMatrix) {
-            ledMatrix->setText(2, " OFF", 60);
+    bool result = false;
+    unsigned int maxOnSec;
+
+    _relayMutex.lock();
+    if (index < _relays.size()) {
+        maxOnSec = _relays[index].maxOnSec;
+        seconds = requested;
+        if (seconds == 0) {
+            seconds = _relays[index].cutoffSec;
+        }
+        if (seconds == 0) {
+            seconds = maxOnSec;
         }
+        result = (maxOnSec == 0) || (seconds <= maxOnSec);
     }
+    _relayMutex.unlock();
+
+    return result;
 }
 
-void MeshPump::setUpPumpOnWithCutoffSec(unsigned int seconds)
+unsigned int MeshPump::getRelayCutoffSec(unsigned int index) const
 {
-    if (seconds > MAX_UPPUMP_AUTO_CUTOFF_SEC) {
+    unsigned int seconds = 0;
+
+    _relayMutex.lock();
+    if (index < _relays.size()) {
+        seconds = _relays[index].cutoffSec;
+    }
+    _relayMutex.unlock();
+
+    return seconds;
+}
+
+bool MeshPump::setRelayCutoffSec(unsigned int index, unsigned int seconds)
+{
+    bool result = false;
+    string name;
+    bool on;
+
+    _relayMutex.lock();
+    if ((index < _relays.size()) &&
+        ((_relays[index].maxOnSec == 0) ||
+         (seconds <= _relays[index].maxOnSec))) {
+        _relays[index].cutoffSec = seconds;
+        name = _relays[index].name;
+        on = _relays[index].on;
+        result = true;
+    }
+    _relayMutex.unlock();
+
+    if (result) {
+        statusModel->setRelay(index, name, on, seconds);
+    }
+
+    return result;
+}
+
+bool MeshPump::setRelay(unsigned int index, bool onOff, unsigned int seconds)
+{
+    return switchRelay(index, onOff, seconds, false);
+}
+
+/*
+ * The one path that switches a relay. Switching on with a non-zero
+ * on-time schedules the cutoff; any other switch cancels it. 'cutoff'
+ * tells the run-time accounting that a deadline, not a user, stopped
+ * it. A non-zero 'due' is the deadline the caller found expired; if the
+ * relay was switched or re-armed since, it is left alone.
+ */
+bool MeshPump::switchRelay(unsigned int index, bool onOff,
+                           unsigned int seconds, bool cutoff, uint64_t due)
+{
+    bool result = false;
+    RelayChannel relay;
+    Clock *clock = Clock::get();
+    uint64_t now = clock->monotonicSec();
+    bool atDefault, changed;
+
+    _relayMutex.lock();
+    if ((index >= _relays.size()) ||
+        (onOff && (_relays[index].maxOnSec > 0) &&
+         ((seconds == 0) || (seconds > _relays[index].maxOnSec))) ||
+        ((due != 0) && (_relays[index].deadline != due))) {
+        _relayMutex.unlock();
         goto done;
     }
+    changed = (_relays[index].on != onOff);
+    _relays[index].on = onOff;
+    _relays[index].deadline = (onOff && (seconds > 0)) ? now + seconds : 0;
+    _relays[index].runtime.edge(onOff, cutoff, clock->monotonicNs(),
+                                clock->wallTime());
+    relay = _relays[index];
+    // Written under the lock so that the pins switch in table order
+    writeRelay(relay.pin, relay.activeLow ? !onOff : onOff);
+    _relayMutex.unlock();
+
+    armCutoff();
+    publishRelay(index);
+
+    if (onOff && (seconds > 0)) {
+        Logger::get().info(Logger::CAT_RELAY, "%s on for %us", relay.name,
+                           seconds);
+    } else {
+        Logger::get().info(Logger::CAT_RELAY, "%s %s", relay.name,
+                           onOff ? "on" : "off");
+    }
 
-    _upPump = true;
-    gpio_write(RELAY2_PIN, !_upPump);
-    if (ledMatrix) {
-        ledMatrix->setText(2, "  ON", UINT_MAX);
+    statusModel->setRelay(index, relay.name, onOff, relay.cutoffSec);
+
+    // Relay state preempts whatever else the row shows, which resumes
+    // afterwards; a sticky relay away from its default then rests on
+    // its state instead
+    if (ledMatrix && (relay.ledRow >= 0)) {
+        atDefault = (onOff == relay.defaultOn);
+        ledMatrix->setText(0, (unsigned int) relay.ledRow,
+                           onOff ? "  ON" : " OFF", 60,
+                           LedQueue::PRIORITY_HIGH);
+        if (relay.ledSticky) {
+            ledMatrix->pinText(0, (unsigned int) relay.ledRow,
+                               atDefault ? "" : (onOff ? "  ON" : " OFF"));
+        }
+        if (changed) {
+            ledMatrix->flash(0, (unsigned int) relay.ledRow);
+        }
     }
-    alarm(seconds);
+
+    result = true;
 
 done:
 
-    return;
+    return result;
+}
+
+void MeshPump::resetRelays(void)
+{
+    for (unsigned int i = 0; i < _relays.size(); i++) {
+        setRelay(i, _relays[i].defaultOn,
+                 _relays[i].defaultOn ? _relays[i].maxOnSec : 0);
+    }
+}
+
+/*
+ * Credits the on-time of the relays that are on. A relay still on well
+ * past its cutoff means the cutoff was lost, so it is switched off here
+ * as a backstop. The deadline, not the start of the run, is what counts:
+ * a run extended by re-arming it is not stuck.
+ */
+void MeshPump::settleRelays(void)
+{
+    Clock *clock = Clock::get();
+    uint64_t nowNs = clock->monotonicNs();
+    uint64_t nowSec = clock->monotonicSec();
+    time_t now = clock->wallTime();
+    vector<pair<unsigned int, uint64_t> > stuck;
+
+    _relayMutex.lock();
+    for (unsigned int i = 0; i < _relays.size(); i++) {
+        _relays[i].runtime.settle(nowNs, now);
+        if ((_relays[i].deadline != 0) &&
+            (nowSec > _relays[i].deadline + RELAY_STUCK_GRACE_SEC)) {
+            stuck.push_back(make_pair(i, _relays[i].deadline));
+        }
+    }
+    _relayMutex.unlock();
+
+    for (vector<pair<unsigned int, uint64_t> >::iterator it =
+             stuck.begin(); it != stuck.end(); it++) {
+        Logger::get().warn(Logger::CAT_RELAY,
+                           "%s on past its cutoff, switching off",
+                           relayName(it->first));
+        switchRelay(it->first, false, 0, true, it->second);
+    }
 }
 
-unsigned int MeshPump::getUpPumpAutoCutoffSec(void) const
+RelayRuntime MeshPump::relayRuntime(unsigned int index)
 {
-    return _upPumpAutoCutoffSec;
+    RelayRuntime runtime;
+    Clock *clock = Clock::get();
+
+    _relayMutex.lock();
+    if (index < _relays.size()) {
+        _relays[index].runtime.settle(clock->monotonicNs(),
+                                      clock->wallTime());
+        runtime = _relays[index].runtime;
+    }
+    _relayMutex.unlock();
+
+    return runtime;
 }
 
-void MeshPump::setUpPumpAutoCutoffSec(unsigned int seconds)
+string MeshPump::runtimeSummary(void)
 {
-    if (seconds > MAX_UPPUMP_AUTO_CUTOFF_SEC) {
+    string s;
+    time_t now = Clock::get()->wallTime();
+
+    for (unsigned int i = 0; i < relayCount(); i++) {
+        if (i > 0) {
+            s += "\n";
+        }
+        s += relayName(i) + " run: " + relayRuntime(i).summary(now);
+    }
+
+    return s;
+}
+
+void MeshPump::setRuntimeFile(const string &path)
+{
+    _runtimePath = path;
+}
+
+/*
+ * Hands the run lines to the status views, which keep them until the
+ * next settle instead of formatting them on every poll.
+ */
+void MeshPump::publishRuntime(void)
+{
+    if (statusModel) {
+        statusModel->setRuntime(runtimeSummary());
+    }
+}
+
+/*
+ * The run-time totals are small and only change on relay edges, so they
+ * ride along with the NVM saves rather than having their own schedule.
+ */
+bool MeshPump::loadRuntime(void)
+{
+    bool result = false;
+    FILE *fp = NULL;
+    uint32_t header[3];
+    RelayRuntime saved;
+    string name;
+    int index;
+
+    if (_runtimePath.empty() || _runtimeLoaded) {
         goto done;
     }
 
-    _upPumpAutoCutoffSec = seconds;
+    // Whatever happens, this run's totals must not be merged twice
+    _runtimeLoaded = true;
+
+    fp = fopen(_runtimePath.c_str(), "r");
+    if (fp == NULL) {
+        goto done;
+    }
+
+    if ((fread(header, sizeof(header), 1, fp) != 1) ||
+        (header[0] != RELAY_RUNTIME_MAGIC) ||
+        (header[1] != RELAY_RUNTIME_VERSION)) {
+        goto done;
+    }
+
+    _relayMutex.lock();
+    for (uint32_t n = 0; n < header[2]; n++) {
+        if (!saved.read(fp, name)) {
+            break;
+        }
+        index = _relays.find(name);
+        if (index >= 0) {
+            _relays[index].runtime.merge(saved);
+        }
+    }
+    _relayMutex.unlock();
+
+    result = true;
 
 done:
 
-    return;
+    if (fp) {
+        fclose(fp);
+    }
+
+    return result;
 }
 
-bool MeshPump::isLightingOn(void) const
+/*
+ * The totals are copied under the relay lock and written out without
+ * it, so that a slow disk never holds up switching a relay.
+ */
+bool MeshPump::saveRuntime(void)
 {
-    return _lighting;
+    bool result = false;
+    string tmp = _runtimePath + ".tmp";
+    FILE *fp;
+    uint32_t header[3];
+    Clock *clock = Clock::get();
+    vector<pair<string, RelayRuntime> > runtimes;
+
+    if (_runtimePath.empty()) {
+        goto done;
+    }
+
+    // Never replace the saved totals before they were merged in
+    loadRuntime();
+
+    _relayMutex.lock();
+    for (unsigned int i = 0; i < _relays.size(); i++) {
+        _relays[i].runtime.settle(clock->monotonicNs(), clock->wallTime());
+        runtimes.push_back(make_pair(_relays[i].name, _relays[i].runtime));
+    }
+    _relayMutex.unlock();
+
+    fp = fopen(tmp.c_str(), "w");
+    if (fp == NULL) {
+        goto done;
+    }
+
+    header[0] = RELAY_RUNTIME_MAGIC;
+    header[1] = RELAY_RUNTIME_VERSION;
+    header[2] = runtimes.size();
+    result = (fwrite(header, sizeof(header), 1, fp) == 1);
+    for (unsigned int i = 0; result && (i < runtimes.size()); i++) {
+        result = runtimes[i].second.write(fp, runtimes[i].first);
+    }
+
+    if (fflush(fp) != 0) {
+        result = false;
+    }
+    if (fsync(fileno(fp)) != 0) {
+        result = false;
+    }
+    if (fclose(fp) != 0) {
+        result = false;
+    }
+
+    if (result) {
+        result = (rename(tmp.c_str(), _runtimePath.c_str()) == 0);
+    }
+    if (!result) {
+        unlink(tmp.c_str());
+    }
+
+done:
+
+    return result;
 }
 
-void MeshPump::setLightingOnOff(bool onOff)
+/*
+ * Points the single Clock alarm at the earliest pending cutoff.
+ */
+void MeshPump::armCutoff(void)
 {
-    _lighting = onOff;
-    gpio_write(RELAY3_PIN, !onOff);
-    if (onOff) {
-        ledMatrix->setText(1, "  ON", 60);
+    uint64_t now = Clock::get()->monotonicSec();
+    uint64_t next = 0;
+
+    _relayMutex.lock();
+    for (unsigned int i = 0; i < _relays.size(); i++) {
+        if ((_relays[i].deadline != 0) &&
+            ((next == 0) || (_relays[i].deadline < next))) {
+            next = _relays[i].deadline;
+        }
+    }
+    _relayMutex.unlock();
+
+    if (next == 0) {
+        Clock::get()->alarm(0);
     } else {
-        ledMatrix->setText(1, " OFF", 60);
+        Clock::get()->alarm((next > now) ? (unsigned int) (next - now) : 1);
     }
 }
 
+void MeshPump::expireRelays(void)
+{
+    uint64_t now = Clock::get()->monotonicSec();
+    vector<pair<unsigned int, uint64_t> > expired;
+
+    _relayMutex.lock();
+    for (unsigned int i = 0; i < _relays.size(); i++) {
+        if ((_relays[i].deadline != 0) && (_relays[i].deadline <= now)) {
+            expired.push_back(make_pair(i, _relays[i].deadline));
+        }
+    }
+    _relayMutex.unlock();
+
+    // A relay re-armed in the meantime keeps running
+    for (vector<pair<unsigned int, uint64_t> >::iterator it =
+             expired.begin(); it != expired.end(); it++) {
+        switchRelay(it->first, false, 0, true, it->second);
+    }
+
+    armCutoff();
+}
+
+/*
+ * Relay cutoffs. In the daemon SIGALRM is consumed by the supervisor,
+ * so this runs on the main thread, not in signal context.
+ */
+void MeshPump::alarmHandler(int signum)
+{
+    if (signum == SIGALRM) {
+        meshpump->expireRelays();
+    }
+}
+
+/*
+ * While a batch is open, relay writes are collected into bank masks and
+ * LED repaints are held, so the whole batch lands in one GPIO bank update
+ * and one frame.
+ */
+void MeshPump::beginBatch(void)
+{
+    _batchMutex.lock();
+    _batchDepth++;
+    _batchMutex.unlock();
+
+    if (ledMatrix) {
+        ledMatrix->beginUpdate();
+    }
+}
+
+void MeshPump::commitBatch(void)
+{
+    uint32_t set = 0, clear = 0;
+
+    // Like a single write, the bank update lands under the relay lock,
+    // so that no later switch reaches the pins first
+    _relayMutex.lock();
+    _batchMutex.lock();
+    if (_batchDepth > 0) {
+        _batchDepth--;
+        if (_batchDepth == 0) {
+            set = _batchSet;
+            clear = _batchClear;
+            _batchSet = 0;
+            _batchClear = 0;
+        }
+    }
+    _batchMutex.unlock();
+
+    if (clear) {
+        clear_bank_1(clear);
+    }
+    if (set) {
+        set_bank_1(set);
+    }
+    _relayMutex.unlock();
+
+    if (ledMatrix) {
+        ledMatrix->endUpdate();
+    }
+}
+
+void MeshPump::writeRelay(unsigned int pin, bool level)
+{
+    uint64_t t0;
+
+    _batchMutex.lock();
+    if (_batchDepth > 0) {
+        if (level) {
+            _batchSet |= (1U << pin);
+            _batchClear &= ~(1U << pin);
+        } else {
+            _batchClear |= (1U << pin);
+            _batchSet &= ~(1U << pin);
+        }
+        _batchMutex.unlock();
+        return;
+    }
+    _batchMutex.unlock();
+
+    t0 = LatencyTracer::nowNs();
+    gpio_write(pin, level);
+    LatencyTracer::get().gpioWritten(LatencyTracer::nowNs() - t0);
+}
+
+void MeshPump::setChatRateLimit(unsigned int ratePerMin, unsigned int burst,
+                                unsigned int coalesceMs)
+{
+    _rateLimiter.configure(ratePerMin, burst, coalesceMs);
+}
+
+void MeshPump::getChatStats(unsigned long &allowed, unsigned long &coalesced,
+                            unsigned long &dropped) const
+{
+    _rateLimiter.getStats(allowed, coalesced, dropped);
+}
+
+unsigned long MeshPump::commandCount(void) const
+{
+    return _commands;
+}
+
+bool MeshPump::startCapture(const string &path)
+{
+    return _capture.openWrite(path);
+}
+
+void MeshPump::stopCapture(void)
+{
+    _capture.close();
+}
+
+void MeshPump::receiveTextMessage(const meshtastic_MeshPacket &packet,
+                                  const string &message)
+{
+    gotTextMessage(packet, message);
+}
+
 void MeshPump::gotTextMessage(const meshtastic_MeshPacket &packet,
                              const string &message)
 {
     bool result = false;
 
+    // Called on a thread libmeshtastic started
+    AllocStats::setSubsystem(ThreadConfig::ROLE_MESH);
+    LatencyTracer::get().begin();
+    _heartbeat.beat();
+    _commands++;
+    Logger::get().debug(Logger::CAT_MESH, "text from 0x%08x: %s",
+                        packet.from, message);
+
+    if (_capture.isOpen()) {
+        _capture.write(packet, message);
+    }
+
     MeshClient::gotTextMessage(packet, message);
     result = handleTextMessage(packet, message);
+    LatencyTracer::get().end();
     if (result) {
         return;
     }
 }
 
+void MeshPump::runCrontab(void)
+{
+    time_t now = Clock::get()->wallTime();
+    struct tm tm;
+
+    localtime_r(&now, &tm);
+    crontab(&tm);
+}
+
+/*
+ * libmeshtastic calls this at least once a minute from its RX thread,
+ * which is the only periodic hook into that thread.
+ */
 void MeshPump::crontab(const struct tm *now)
 {
     int hour = now->tm_hour;
     bool shouldTurnOn = false;
+    int lighting;
+
+    _heartbeat.beat();
+
+    settleRelays();
+    publishRuntime();
+    if ((hour != _runtimeSavedHour) && !_runtimePath.empty()) {
+        _runtimeSavedHour = hour;
+        saveRuntime();
+    }
 
     if ((hour <= 5) || (hour > 18)) {
         shouldTurnOn = true;
@@ -164,8 +694,9 @@ void MeshPump::crontab(const struct tm *now)
         shouldTurnOn = false;
     }
 
-    if (shouldTurnOn != isLightingOn()) {
-        setLightingOnOff(shouldTurnOn);
+    lighting = findRelay("lighting");
+    if ((lighting >= 0) && (shouldTurnOn != isRelayOn(lighting))) {
+        setRelay(lighting, shouldTurnOn);
     }
 }
 
@@ -174,6 +705,8 @@ bool MeshPump::loadNvm(void)
     bool result;
 
     result = MeshNvm::loadNvm();
+    loadRuntime();
+    publishRuntime();
 
     return result;
 }
@@ -183,6 +716,9 @@ bool MeshPump::saveNvm(void)
     bool result;
 
     result = MeshNvm::saveNvm();
+    if (!_runtimePath.empty() && !saveRuntime()) {
+        result = false;
+    }
 
     return result;
 }
@@ -202,7 +738,8 @@ float MeshPump::getCpuTempC(void)
 
     fd = open("/dev/vcio", 0);
     if (fd == -1) {
-        fprintf(stderr, "open: %s!\n", strerror(errno));
+        Logger::get().error(Logger::CAT_SYSTEM, "open /dev/vcio: %s!",
+                            strerror(errno));
         goto done;
     }
 
@@ -220,7 +757,8 @@ float MeshPump::getCpuTempC(void)
 
     ret = ioctl(fd, _IOWR(100, 0, char *), p);
     if (ret == -1) {
-        fprintf(stderr, "ioctl: %s!\n", strerror(errno));
+        Logger::get().error(Logger::CAT_SYSTEM, "ioctl: %s!",
+                            strerror(errno));
         goto done;
     }
 
@@ -249,6 +787,57 @@ done:
     return tempC;
 }
 
+void MeshPump::refreshCpuTemp(void)
+{
+    time_t now = Clock::get()->wallTime();
+    float tempC;
+
+    if ((now - _cpuTempSampled) < CPU_TEMP_SAMPLE_SEC) {
+        return;
+    }
+
+    _cpuTempSampled = now;
+    tempC = getCpuTempC();
+    statusModel->setCpuTempC(tempC);
+    LiveValues::get().set(_liveCpuTemp, tempC);
+}
+
+/*
+ * Called once a second so that the timers count; LiveValues passes on
+ * only what changed, in whole seconds, to the bound LED rows.
+ */
+void MeshPump::publishLive(void)
+{
+    refreshCpuTemp();
+    for (unsigned int i = 0; i < _live.size(); i++) {
+        publishRelay(i);
+    }
+}
+
+void MeshPump::publishRelay(unsigned int index)
+{
+    Clock *clock = Clock::get();
+    uint64_t now = clock->monotonicSec();
+    uint64_t remaining = 0, run;
+    bool on;
+
+    if (index >= _live.size()) {
+        return;
+    }
+
+    _relayMutex.lock();
+    on = _relays[index].on;
+    if (_relays[index].deadline > now) {
+        remaining = _relays[index].deadline - now;
+    }
+    run = _relays[index].runtime.runNs(clock->monotonicNs()) / 1000000000ULL;
+    _relayMutex.unlock();
+
+    LiveValues::get().set(_live[index].on, on ? 1.0 : 0.0);
+    LiveValues::get().set(_live[index].remaining, (double) remaining);
+    LiveValues::get().set(_live[index].run, (double) run);
+}
+
 string MeshPump::handleEnv(uint32_t node_num, string &message)
 {
     stringstream ss;
@@ -258,30 +847,25 @@ string MeshPump::handleEnv(uint32_t node_num, string &message)
         ss << endl;
     }
 
-    ss << "cpu temperature: ";
-    ss <<  setprecision(3) << getCpuTempC();
+    refreshCpuTemp();
+    ss << statusModel->views()->env;
 
     return ss.str();
 }
 
 string MeshPump::handleStatus(uint32_t node_num, string &message)
 {
-    stringstream ss;
-
     (void)(node_num);
     (void)(message);
 
-    ss << "fish-pump: " << (isFishPumpOn() ? "on" : "off") << endl;
-    ss << "up-pump: " << (isUpPumpOn() ? "on" : "off") << endl;
-    ss << "up-pump auto cutoff: " << getUpPumpAutoCutoffSec() << " seconds";
-
-    return ss.str();
+    return statusModel->views()->status;
 }
 
 string MeshPump::handleUnknown(uint32_t node_num, string &message)
 {
     string reply;
     string first_word;
+    RateLimiter::Verdict verdict;
 
     (void)(node_num);
     (void)(message);
@@ -291,47 +875,49 @@ string MeshPump::handleUnknown(uint32_t node_num, string &message)
     message = message.substr(first_word.size());
     trimWhitespace(message);
 
+    if ((first_word == "led") || (first_word == "pump") ||
+        (first_word == "history")) {
+        // Repeats are absorbed and floods are dropped without a reply
+        verdict = _rateLimiter.check(node_num, first_word + " " + message);
+        if (verdict != RateLimiter::ALLOW) {
+            Logger::get().info(Logger::CAT_MESH, "%s from 0x%08x %s",
+                               first_word, node_num,
+                               (verdict == RateLimiter::COALESCE) ?
+                               "coalesced" : "dropped");
+            goto done;
+        }
+    }
+
     if (first_word == "led") {
         reply = handleLed(node_num, message);
     } else if (first_word == "pump") {
         reply = handlePump(node_num, message);
+    } else if (first_word == "history") {
+        reply = handleHistory(node_num, message);
     }
 
-    return reply;
-}
-
-static int getArgY(const char *s)
-{
-    int ret = 0;
-
-    try {
-        ret = stoi(s);
-        if ((ret < 0) || (ret >= MAX7219_Y_COUNT)) {
-            ret = -1;
-        }
-    } catch (const invalid_argument &e) {
-        ret = -1;
-    }
+done:
 
-    return ret;
+    return reply;
 }
 
 string MeshPump::handleLed(uint32_t node_num, string &message)
 {
     stringstream ss;
-    istringstream iss(message);
     vector<string> tokens;
     string token;
     string first_word;
-    int y;
+    unsigned int c = 0, y = 0;
 
-    while (getline(iss, token, ' ')) {
-        tokens.push_back(token);
-    }
-
-    if (tokens.size() > 0) {
-        first_word = tokens[0];
-        toLowercase(first_word);
+    // Row text, the common case, is cut out of the message in place;
+    // only the other subcommands are split into words
+    first_word = message.substr(0, message.find(' '));
+    toLowercase(first_word);
+    if ((first_word == "delay") || (first_word == "sf")) {
+        istringstream iss(message);
+        while (getline(iss, token, ' ')) {
+            tokens.push_back(token);
+        }
     }
 
     if ((first_word == "delay") && (tokens.size() == 2)) {
@@ -350,7 +936,7 @@ string MeshPump::handleLed(uint32_t node_num, string &message)
             goto done;
         }
     } else if ((first_word == "sf") && (tokens.size() == 3) &&
-               ((y = getArgY(tokens[1].c_str())) != -1)) {
+               ledMatrix->parseRow(tokens[1], c, y)) {
         try {
             int sf = stoi(tokens[2]);
             if (sf < 1) {
@@ -358,8 +944,9 @@ string MeshPump::handleLed(uint32_t node_num, string &message)
                 goto done;
             }
 
-            ledMatrix->setSlowdownFactor(y, (unsigned int) sf);
-            ss << "set sf of row " << y << " to " << sf;
+            ledMatrix->setSlowdownFactor(c, y, (unsigned int) sf);
+            ss << "set sf of row " << ledMatrix->rowName(c, y) << " to "
+               << sf;
             goto done;
         } catch (const invalid_argument &e) {
             ss << "sf=" << tokens[2] << " is invalid!";
@@ -369,18 +956,18 @@ string MeshPump::handleLed(uint32_t node_num, string &message)
         ledMatrix->clear();
     } else if (first_word == "welcome") {
         ledMatrix->setWelcomeText();
-    } else if ((y = getArgY(first_word.c_str())) != -1) {
-        message = message.substr(first_word.size());
+    } else if (ledMatrix->parseRow(first_word, c, y)) {
+        message.erase(0, first_word.size());
         trimWhitespace(message);
-        ledMatrix->setText(y, message);
+        LatencyTracer::get().parsed();
+        ledMatrix->setText(c, y, move(message));
     } else {
-        ss << "delay: " << to_string(ledMatrix->delay()) << "ms" << endl;
-        for (unsigned int y = 0; y < MAX7219_Y_COUNT; y++) {
-            ss << "row " << to_string(y) << ": ";
-            ss << "ttl=" << to_string(ledMatrix->ttl(y)) << "s, ";
-            ss << "sf=" << to_string(ledMatrix->slowdownFactor(y));
-            if ((y + 1) != MAX7219_Y_COUNT) {
-                ss << endl;
+        ss << "delay: " << to_string(ledMatrix->delay()) << "ms";
+        for (c = 0; c < ledMatrix->chainCount(); c++) {
+            for (y = 0; y < ledMatrix->rows(c); y++) {
+                ss << endl << "row " << ledMatrix->rowName(c, y) << ": ";
+                ss << "ttl=" << to_string(ledMatrix->ttl(c, y)) << "s, ";
+                ss << "sf=" << to_string(ledMatrix->slowdownFactor(c, y));
             }
         }
         goto done;
@@ -397,29 +984,26 @@ string MeshPump::handlePump(uint32_t node_num, string &message)
 {
     string reply;
     string first_word, second_word, third_word;
-    bool isFish = false;
-    bool isUp = false;
+    int index;
     bool onOff = false;
     unsigned int cutoff = 0;
-
-    (void)(message);
+    unsigned int seconds = 0;
 
     first_word = message.substr(0, message.find(' '));
     toLowercase(first_word);
 
-    if ((first_word == "0") ||
-        (first_word == "fish") ||
-        (first_word == "fish-pump")) {
-        isFish = true;
-    } else if ((first_word == "1") ||
-               (first_word == "up") ||
-               (first_word == "up-pump")) {
-        isUp = true;
-    } else {
+    index = findRelay(first_word);
+    if (index < 0) {
         reply = "no pump specified!";
         goto done;
     }
 
+    if (!isRelayAllowed(index, node_num)) {
+        reply = relayName(index) + " is not allowed for " +
+            getDisplayName(node_num);
+        goto done;
+    }
+
     message = message.substr(first_word.size());
     trimWhitespace(message);
     second_word = message.substr(0, message.find(' '));
@@ -434,66 +1018,90 @@ string MeshPump::handlePump(uint32_t node_num, string &message)
         goto done;
     }
 
-    if (isUp && (onOff == true)) {
+    if (onOff == true) {
         message = message.substr(second_word.size());
         trimWhitespace(message);
         third_word = message.substr(0, message.find(' '));
         toLowercase(third_word);
 
-        try {
-            cutoff = stoi(third_word);
-        } catch (const invalid_argument &e) {
-            reply = "cutoff '" + third_word + "' argument is invalid!";
-            goto done;
+        if (!third_word.empty()) {
+            try {
+                cutoff = stoi(third_word);
+            } catch (const invalid_argument &e) {
+                reply = "cutoff '" + third_word + "' argument is invalid!";
+                goto done;
+            }
         }
 
-        if (cutoff > MAX_UPPUMP_AUTO_CUTOFF_SEC) {
+        if (!relayOnTime(index, cutoff, seconds)) {
             reply = "cut-off of " + to_string(cutoff) +
                 " seconds is too big!";
             goto done;
         }
     }
 
-    if (isFish) {
-        setFishPumpOnOff(onOff);
-        reply = "set fish-pump to ";
-        reply += (onOff ? "on" : "off");
-        reply += " by ";
-        reply += getDisplayName(node_num);
-    } else if (isUp) {
-        if (onOff == false) {
-            setUpPumpOnOff(false);
-            reply = "set up-pump to off by " + getDisplayName(node_num);
-        } else {
-            if (cutoff == 0) {
-                setUpPumpOnOff(true);
-                reply = "set up-pump to on for " +
-                    to_string(getUpPumpAutoCutoffSec()) +
-                    " seconds by " +
-                    getDisplayName(node_num);
-            } else {
-                setUpPumpOnWithCutoffSec(cutoff);
-                reply = "set up-pump to on for " +
-                    to_string(cutoff) +
-                    " seconds by " +
-                    getDisplayName(node_num);
-            }
-        }
+    LatencyTracer::get().parsed();
+
+    setRelay(index, onOff, seconds);
+    reply = "set " + relayName(index) + " to ";
+    reply += (onOff ? "on" : "off");
+    if (onOff && (seconds > 0)) {
+        reply += " for " + to_string(seconds) + " seconds";
     }
+    reply += " by ";
+    reply += getDisplayName(node_num);
 
 done:
 
     return reply;
 }
 
-static inline int stdio_vprintf(const char *format, va_list ap)
+/*
+ * 'history' gives the 1h/1d/30d means of every series; 'history <name>'
+ * gives the mean, min and max of one.
+ */
+string MeshPump::handleHistory(uint32_t node_num, string &message)
 {
-    return vprintf(format, ap);
+    string reply;
+    string name;
+    int index;
+    time_t now = Clock::get()->wallTime();
+
+    (void)(node_num);
+
+    if (historyStore == NULL) {
+        reply = "no history!";
+        goto done;
+    }
+
+    name = message.substr(0, message.find(' '));
+    toLowercase(name);
+    if (name.empty()) {
+        reply = historyStore->summary(now);
+        goto done;
+    }
+
+    index = historyStore->find(name);
+    if (index < 0) {
+        reply = "no history for '" + name + "'!";
+        goto done;
+    }
+
+    reply = historyStore->describe(index, now);
+
+done:
+
+    return reply;
 }
 
+/*
+ * libmeshtastic's own output goes to the log instead of stdout, so it
+ * survives daemon mode and a slow terminal cannot stall the mesh thread.
+ */
 int MeshPump::vprintf(const char *format, va_list ap) const
 {
-    return stdio_vprintf(format, ap);
+    return Logger::get().vlog(Logger::LEVEL_INFO, Logger::CAT_MESH,
+                              format, ap);
 }
 
 /*
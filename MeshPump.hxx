@@ -10,12 +10,18 @@
 #include <LibMeshtastic.hxx>
 #include <HomeChat.hxx>
 #include <MeshNvm.hxx>
-
-#define RELAY1_PIN  26
-#define RELAY2_PIN  20
-#define RELAY3_PIN  21
-
-#define MAX_UPPUMP_AUTO_CUTOFF_SEC  120
+#include <atomic>
+#include <mutex>
+#include <RateLimiter.hxx>
+#include <PacketCapture.hxx>
+#include <Heartbeat.hxx>
+#include <RelayTable.hxx>
+
+#define RELAY_STUCK_GRACE_SEC        60
+#define RELAY_RUNTIME_MAGIC          0x4e52504d  // 'MPRN'
+#define RELAY_RUNTIME_VERSION        1
+#define CPU_TEMP_SAMPLE_SEC          5
+#define MESH_HEARTBEAT_TIMEOUT_MS    150000
 
 using namespace std;
 
@@ -26,24 +32,46 @@ class MeshPump : public MeshClient, public MeshNvm, public HomeChat,
 
 public:
 
-    MeshPump();
+    MeshPump(const vector<RelayChannel> &relays = RelayTable::defaults());
     ~MeshPump();
 
     void join(void);
 
     float getCpuTempC(void);
-
-    bool isFishPumpOn(void) const;
-    void setFishPumpOnOff(bool onOff);
-
-    bool isUpPumpOn(void) const;
-    void setUpPumpOnOff(bool onOff);
-    void setUpPumpOnWithCutoffSec(unsigned int seconds);
-    unsigned int getUpPumpAutoCutoffSec(void) const;
-    void setUpPumpAutoCutoffSec(unsigned int seconds);
-
-    bool isLightingOn(void) const;
-    void setLightingOnOff(bool onOff);
+    void refreshCpuTemp(void);
+    void publishLive(void);
+
+    unsigned int relayCount(void) const;
+    int findRelay(const string &name) const;
+    string relayName(unsigned int index) const;
+    bool isRelayOn(unsigned int index) const;
+    bool isRelayAllowed(unsigned int index, uint32_t node_num) const;
+    bool relayOnTime(unsigned int index, unsigned int requested,
+                     unsigned int &seconds) const;
+    bool setRelay(unsigned int index, bool onOff, unsigned int seconds = 0);
+    unsigned int getRelayCutoffSec(unsigned int index) const;
+    bool setRelayCutoffSec(unsigned int index, unsigned int seconds);
+    void resetRelays(void);
+    void expireRelays(void);
+    void settleRelays(void);
+    RelayRuntime relayRuntime(unsigned int index);
+    string runtimeSummary(void);
+    void setRuntimeFile(const string &path);
+
+    void beginBatch(void);
+    void commitBatch(void);
+
+    void setChatRateLimit(unsigned int ratePerMin, unsigned int burst,
+                          unsigned int coalesceMs);
+    void getChatStats(unsigned long &allowed, unsigned long &coalesced,
+                      unsigned long &dropped) const;
+    unsigned long commandCount(void) const;
+
+    bool startCapture(const string &path);
+    void stopCapture(void);
+    void receiveTextMessage(const meshtastic_MeshPacket &packet,
+                            const string &message);
+    void runCrontab(void);
 
 protected:
 
@@ -74,16 +102,46 @@ protected:
     virtual string handleUnknown(uint32_t node_num, string &message);
     virtual string handleLed(uint32_t node_num, string &message);
     virtual string handlePump(uint32_t node_num, string &message);
+    virtual string handleHistory(uint32_t node_num, string &message);
     virtual int vprintf(const char *format, va_list ap) const;
 
 private:
 
     static void alarmHandler(int signum);
-
-    bool _fishPump;
-    bool _upPump;
-    unsigned int _upPumpAutoCutoffSec;
-    bool _lighting;
+    bool switchRelay(unsigned int index, bool onOff, unsigned int seconds,
+                     bool cutoff, uint64_t due = 0);
+    void armCutoff(void);
+    void publishRuntime(void);
+    bool loadRuntime(void);
+    bool saveRuntime(void);
+    void writeRelay(unsigned int pin, bool level);
+    void publishRelay(unsigned int index);
+
+    // LiveValues source ids of a relay
+    struct RelayLive {
+        int on;
+        int remaining;           // Seconds until the cutoff
+        int run;                 // Seconds into the current run
+    };
+
+    RelayTable _relays;
+    mutable mutex _relayMutex;
+    time_t _cpuTempSampled;
+    int _liveCpuTemp;
+    vector<RelayLive> _live;
+
+    mutex _batchMutex;
+    unsigned int _batchDepth;
+    uint32_t _batchSet;
+    uint32_t _batchClear;
+
+    atomic<unsigned long> _commands;
+    string _runtimePath;
+    bool _runtimeLoaded;
+    int _runtimeSavedHour;
+    RateLimiter _rateLimiter;
+    PacketCapture _capture;
+    Heartbeat _heartbeat;
 
 };
 
@@ -4,20 +4,43 @@
  * Copyright (C) 2025, Charles Chiou
  */
 
+#include <cstdarg>
 #include <string>
 #include <MeshPump.hxx>
 #include <LedMatrix.hxx>
+#include <StripCache.hxx>
+#include <LiveValues.hxx>
+#include <StatusModel.hxx>
+#include <LatencyTracer.hxx>
+#include <ThreadConfig.hxx>
+#include <Logger.hxx>
+#include <Clock.hxx>
+#include <HistoryStore.hxx>
+#include <AllocStats.hxx>
 #include <MeshPumpShell.hxx>
 
 extern shared_ptr<MeshPump> meshpump;
 extern shared_ptr<LedMatrix> ledMatrix;
+extern shared_ptr<StatusModel> statusModel;
+extern shared_ptr<HistoryStore> historyStore;
+
+atomic<unsigned long> MeshPumpShell::_ocommands(0);
+atomic<unsigned long> MeshPumpShell::_ofragments(0);
+atomic<unsigned long> MeshPumpShell::_owrites(0);
+atomic<unsigned long> MeshPumpShell::_obytes(0);
+Heartbeat MeshPumpShell::_acceptHeartbeat("shell", SHELL_HEARTBEAT_TIMEOUT_MS);
 
 MeshPumpShell::MeshPumpShell(shared_ptr<MeshClient> client)
-    : MeshShell(client)
+    : MeshShell(client),
+      _olen(0)
 {
     _help_list.push_back("led");
     _help_list.push_back("pump");
     _help_list.push_back("lighting");
+    _help_list.push_back("latency");
+    _help_list.push_back("log");
+    _help_list.push_back("history");
+    _help_list.push_back("alloc");
 }
 
 MeshPumpShell::~MeshPumpShell()
@@ -25,54 +48,186 @@ MeshPumpShell::~MeshPumpShell()
 
 }
 
+/*
+ * Called by the accept loop for every connection. The loop is idle
+ * between connections, so its heartbeat is parked rather than timed;
+ * the watchdog watches the beats against the listen queue instead.
+ */
 shared_ptr<MeshShell> MeshPumpShell::newInstance(void)
 {
+    _acceptHeartbeat.beat();
+    _acceptHeartbeat.park();
+
     return make_shared<MeshPumpShell>();
 }
 
-int MeshPumpShell::system(int argc, char **argv)
+void MeshPumpShell::getOutputStats(unsigned long &commands,
+                                   unsigned long &fragments,
+                                   unsigned long &writes,
+                                   unsigned long &bytes)
 {
-    shared_ptr<MeshPump> meshpump = dynamic_pointer_cast<MeshPump>(_client);
-    static const char *pump_argv[] = { "pump", };
-    static const char *lighting_argv[] = { "lighting", };
+    commands = _ocommands;
+    fragments = _ofragments;
+    writes = _owrites;
+    bytes = _obytes;
+}
 
-    MeshShell::system(argc, argv);
-    this->pump(1, (char **) pump_argv);
-    this->lighting(1, (char **) lighting_argv);
-    this->printf("CPU temp: %.1fC\n", meshpump->getCpuTempC());
+int MeshPumpShell::print(const char *format, ...)
+{
+    int ret;
+    va_list ap;
 
-    return 0;
+    va_start(ap, format);
+    ret = this->vprint(format, ap);
+    va_end(ap);
+
+    return ret;
 }
 
-static int getArgY(const char *s)
+/*
+ * Command output is appended to a per-connection buffer instead of being
+ * written out one fragment at a time; flush() hands the whole reply to
+ * the connection in a single write when the command completes.
+ */
+int MeshPumpShell::vprint(const char *format, va_list ap)
 {
-    int ret = 0;
+    int ret;
+    va_list aq;
 
-    try {
-        ret = stoi(s);
-        if ((ret < 0) || (ret >= MAX7219_Y_COUNT)) {
-            ret = -1;
-        }
-    } catch (const invalid_argument &e) {
-        ret = -1;
+    va_copy(aq, ap);
+    ret = vsnprintf(_obuf + _olen, sizeof(_obuf) - _olen, format, aq);
+    va_end(aq);
+    if (ret < 0) {
+        goto done;
+    }
+
+    _ofragments++;
+
+    if ((_olen + ret) < sizeof(_obuf)) {
+        _olen += ret;
+        goto done;
     }
 
+    // Did not fit, flush what we have and format again
+    flush();
+    if ((size_t) ret < sizeof(_obuf)) {
+        vsnprintf(_obuf, sizeof(_obuf), format, ap);
+        _olen = ret;
+    } else {
+        string large;
+
+        large.resize(ret + 1);
+        vsnprintf(&large[0], large.size(), format, ap);
+        MeshShell::printf("%s", large.c_str());
+        _owrites++;
+        _obytes += ret;
+    }
+
+done:
+
     return ret;
 }
 
+void MeshPumpShell::flush(void)
+{
+    if (_olen == 0) {
+        return;
+    }
+
+    MeshShell::printf("%.*s", (int) _olen, _obuf);
+    _owrites++;
+    _obytes += _olen;
+    _olen = 0;
+}
+
+int MeshPumpShell::system(int argc, char **argv)
+{
+    shared_ptr<MeshPump> meshpump = dynamic_pointer_cast<MeshPump>(_client);
+    unsigned long commands, fragments, writes, bytes;
+    unsigned long allowed, coalesced, dropped;
+    unsigned long logged, rotations;
+
+    MeshShell::system(argc, argv);
+    meshpump->refreshCpuTemp();
+    this->print("%s", statusModel->views()->system.c_str());
+    meshpump->getChatStats(allowed, coalesced, dropped);
+    this->print("chat commands: %lu allowed, %lu coalesced, "
+                "%lu dropped\n", allowed, coalesced, dropped);
+    getOutputStats(commands, fragments, writes, bytes);
+    this->print("shell output: %lu commands, %lu fragments, "
+                "%lu writes, %lu bytes\n",
+                commands, fragments, writes, bytes);
+    Logger::get().getStats(logged, dropped, rotations);
+    this->print("log: %lu logged, %lu dropped\n", logged, dropped);
+    this->print("%s", ThreadConfig::get().describe().c_str());
+    this->print("%s", Watchdog::get().report().c_str());
+    _ocommands++;
+    flush();
+
+    return 0;
+}
+
 int MeshPumpShell::led(int argc, char **argv)
 {
     int ret = 0;
     string message;
     int startArg = 1;
-    int y = 0;
+    unsigned int c = 0, y = 0;
 
     if (argc == 1) {
-        this->printf("delay: %ums\n", ledMatrix->delay());
-        for (unsigned int y = 0; y < MAX7219_Y_COUNT; y++) {
-            this->printf("row %u: ", y);
-            this->printf("ttl=%us, ", ledMatrix->ttl(y));
-            this->printf("sf=%u\n", ledMatrix->slowdownFactor(y));
+        const Histogram &period = ledMatrix->framePeriod();
+
+        this->print("delay: %ums\n", ledMatrix->delay());
+        this->print("power: %s%s, idle %us\n",
+                    LedMatrix::powerName(ledMatrix->power()),
+                    ledMatrix->powerForced() ? " (forced)" : "",
+                    ledMatrix->idleSeconds());
+        this->print("frame period: mean=%.3fms stddev=%.3fms "
+                    "p99=%.3fms max=%.3fms (%lu frames)\n",
+                    period.mean() / 1000000.0,
+                    period.stddev() / 1000000.0,
+                    period.percentile(99) / 1000000.0,
+                    period.max() / 1000000.0,
+                    period.count());
+        {
+            unsigned int entries;
+            unsigned long hits, misses;
+
+            StripCache::get().getStats(entries, hits, misses);
+            this->print("strip cache: %u/%u entries, %lu hits, "
+                        "%lu misses\n", entries, STRIP_CACHE_ENTRIES,
+                        hits, misses);
+        }
+        for (c = 0; c < ledMatrix->chainCount(); c++) {
+            Max7219Stats spi = ledMatrix->spiStats(c);
+            unsigned long full = ledMatrix->spiFullBytes(c);
+
+            this->print("chain %s: %ux%u panels\n",
+                        ledMatrix->chainName(c).c_str(),
+                        ledMatrix->columns(c), ledMatrix->rows(c));
+            this->print("  spi: %lu frames, %lu bytes (%.1f%% saved), "
+                        "%lu writes, %lu elided\n",
+                        spi.frames, spi.bytes,
+                        (full > spi.bytes) ?
+                        ((full - spi.bytes) * 100.0) / full : 0.0,
+                        spi.writes, spi.elided);
+            this->print("  power: %u/%u modules shut down, ~%.0fmA\n",
+                        ledMatrix->modulesShutdown(c),
+                        ledMatrix->columns(c) * ledMatrix->rows(c),
+                        ledMatrix->currentMa(c));
+            for (y = 0; y < ledMatrix->rows(c); y++) {
+                this->print("row %s: ", ledMatrix->rowName(c, y).c_str());
+                this->print("intensity=%u, ", ledMatrix->intensity(c, y));
+                this->print("ttl=%us, ", ledMatrix->ttl(c, y));
+                this->print("queued=%u, ", ledMatrix->queued(c, y));
+                this->print("sf=%u, ", ledMatrix->slowdownFactor(c, y));
+                this->print("layers=%s", ledMatrix->layers(c, y).c_str());
+                if (!ledMatrix->binding(c, y).empty()) {
+                    this->print(", bind='%s'",
+                                ledMatrix->binding(c, y).c_str());
+                }
+                this->print("\n");
+            }
         }
         goto done;
     } else if ((argc == 3) && (strcmp(argv[1], "delay") == 0)) {
@@ -80,43 +235,233 @@ int MeshPumpShell::led(int argc, char **argv)
             int ms = stoi(argv[2]);
             if (ms <= 0) {
                 ret = -1;
-                this->printf("delay ms=%s is invalid!\n", argv[2]);
+                this->print("delay ms=%s is invalid!\n", argv[2]);
                 goto done;
             }
 
             ledMatrix->setDelay((unsigned int) ms);
-            this->printf("set delay to %ums\n", ms);
+            this->print("set delay to %ums\n", ms);
             goto done;
         } catch (const invalid_argument &e) {
             ret = -1;
-            this->printf("delay ms=%s is invalid!\n", argv[2]);
+            this->print("delay ms=%s is invalid!\n", argv[2]);
             goto done;
         }
     } else if ((argc == 4) && (strcmp(argv[1], "sf") == 0) &&
-               ((y = getArgY(argv[2])) != -1)) {
+               ledMatrix->parseRow(argv[2], c, y)) {
         try {
             int sf = stoi(argv[3]);
             if (sf < 1) {
                 ret = -1;
-                this->printf("sf=%s is invalid!\n", argv[3]);
+                this->print("sf=%s is invalid!\n", argv[3]);
                 goto done;
             }
 
-            ledMatrix->setSlowdownFactor(y, (unsigned int) sf);
-            this->printf("set sf of row %u to %u\n", y, sf);
+            ledMatrix->setSlowdownFactor(c, y, (unsigned int) sf);
+            this->print("set sf of row %s to %u\n",
+                        ledMatrix->rowName(c, y).c_str(), sf);
             goto done;
         } catch (const invalid_argument &e) {
             ret = -1;
-            this->printf("sf=%s is invalid!\n", argv[3]);
+            this->print("sf=%s is invalid!\n", argv[3]);
+            goto done;
+        }
+    } else if (((argc == 3) || (argc == 4)) &&
+               (strcmp(argv[1], "intensity") == 0)) {
+        const char *arg = argv[argc - 1];
+
+        if ((argc == 4) && !ledMatrix->parseRow(argv[2], c, y)) {
+            ret = -1;
+            this->print("row=%s is invalid!\n", argv[2]);
             goto done;
         }
+
+        try {
+            int intensity = stoi(arg);
+            if ((intensity < 0) || (intensity > 15)) {
+                ret = -1;
+                this->print("intensity=%s is invalid!\n", arg);
+                goto done;
+            }
+
+            if (argc == 4) {
+                ledMatrix->setIntensity(c, y, (unsigned int) intensity);
+                this->print("set intensity of row %s to %u\n",
+                            ledMatrix->rowName(c, y).c_str(), intensity);
+            } else {
+                ledMatrix->setIntensity((unsigned int) intensity);
+                this->print("set intensity to %u\n", intensity);
+            }
+            goto done;
+        } catch (const invalid_argument &e) {
+            ret = -1;
+            this->print("intensity=%s is invalid!\n", arg);
+            goto done;
+        }
+    } else if (((argc == 3) || (argc == 4)) &&
+               (strcmp(argv[1], "blink") == 0) &&
+               ledMatrix->parseRow(argv[2], c, y)) {
+        if ((argc == 4) && (strcmp(argv[3], "off") == 0)) {
+            ledMatrix->blink(c, y, false);
+            goto done;
+        }
+
+        try {
+            int seconds = (argc == 4) ? stoi(argv[3]) : 0;
+            if (seconds < 0) {
+                ret = -1;
+                this->print("seconds=%s is invalid!\n", argv[3]);
+                goto done;
+            }
+
+            ledMatrix->blink(c, y, true, (unsigned int) seconds);
+            goto done;
+        } catch (const invalid_argument &e) {
+            ret = -1;
+            this->print("seconds=%s is invalid!\n", argv[3]);
+            goto done;
+        }
+    } else if ((argc == 3) && (strcmp(argv[1], "flash") == 0) &&
+               ledMatrix->parseRow(argv[2], c, y)) {
+        ledMatrix->flash(c, y);
+        goto done;
+    } else if ((argc == 4) && (strcmp(argv[1], "progress") == 0) &&
+               ledMatrix->parseRow(argv[2], c, y)) {
+        try {
+            int percent = stoi(argv[3]);
+            if ((percent < 0) || (percent > 100)) {
+                ret = -1;
+                this->print("percent=%s is invalid!\n", argv[3]);
+                goto done;
+            }
+
+            ledMatrix->setProgress(c, y, (unsigned int) percent);
+            goto done;
+        } catch (const invalid_argument &e) {
+            ret = -1;
+            this->print("percent=%s is invalid!\n", argv[3]);
+            goto done;
+        }
+    } else if ((argc > 3) && (strcmp(argv[1], "vscroll") == 0) &&
+               ledMatrix->parseRow(argv[2], c, y)) {
+        for (int i = 3; i < argc; i++) {
+            if (i > 3) {
+                message += " ";
+            }
+            message += argv[i];
+        }
+
+        ledMatrix->setVerticalText(c, y, message);
+        goto done;
+    } else if ((argc > 4) && (strcmp(argv[1], "repeat") == 0) &&
+               ledMatrix->parseRow(argv[2], c, y)) {
+        try {
+            int repeat = stoi(argv[3]);
+            if (repeat < 0) {
+                ret = -1;
+                this->print("repeat=%s is invalid!\n", argv[3]);
+                goto done;
+            }
+
+            for (int i = 4; i < argc; i++) {
+                if (i > 4) {
+                    message += " ";
+                }
+                message += argv[i];
+            }
+
+            ledMatrix->setText(c, y, move(message), 30,
+                               LedQueue::PRIORITY_NORMAL,
+                               (unsigned int) repeat);
+            goto done;
+        } catch (const invalid_argument &e) {
+            ret = -1;
+            this->print("repeat=%s is invalid!\n", argv[3]);
+            goto done;
+        }
+    } else if ((argc > 3) && (strcmp(argv[1], "bind") == 0) &&
+               ledMatrix->parseRow(argv[2], c, y)) {
+        string error;
+
+        for (int i = 3; i < argc; i++) {
+            if (i > 3) {
+                message += " ";
+            }
+            message += argv[i];
+        }
+
+        if (!ledMatrix->bind(c, y, message, error)) {
+            ret = -1;
+            this->print("template is invalid: %s!\n", error.c_str());
+        }
+        goto done;
+    } else if ((argc == 3) && (strcmp(argv[1], "unbind") == 0) &&
+               ledMatrix->parseRow(argv[2], c, y)) {
+        ledMatrix->unbind(c, y);
+        goto done;
+    } else if ((argc == 2) && (strcmp(argv[1], "live") == 0)) {
+        LiveValues &live = LiveValues::get();
+        double value;
+
+        for (unsigned int i = 0; i < live.count(); i++) {
+            if (live.value(i, value)) {
+                this->print("%s: %g\n", live.name(i).c_str(), value);
+            } else {
+                this->print("%s: -\n", live.name(i).c_str());
+            }
+        }
+        goto done;
+    } else if ((argc >= 2) && (argc <= 4) &&
+               (strcmp(argv[1], "snapshot") == 0)) {
+        bool pbm = false;
+
+        for (int i = 2; i < argc; i++) {
+            int found;
+
+            if (strcmp(argv[i], "pbm") == 0) {
+                pbm = true;
+                continue;
+            }
+
+            found = ledMatrix->findChain(argv[i]);
+            if (found < 0) {
+                ret = -1;
+                this->print("chain=%s is invalid!\n", argv[i]);
+                goto done;
+            }
+            c = (unsigned int) found;
+        }
+
+        this->print("%s", ledMatrix->snapshot(c, pbm).c_str());
+        goto done;
+    } else if ((argc == 3) && (strcmp(argv[1], "power") == 0)) {
+        if (strcmp(argv[2], "active") == 0) {
+            ledMatrix->forcePower(LedMatrix::POWER_ACTIVE);
+        } else if (strcmp(argv[2], "dim") == 0) {
+            ledMatrix->forcePower(LedMatrix::POWER_DIM);
+        } else if (strcmp(argv[2], "off") == 0) {
+            ledMatrix->forcePower(LedMatrix::POWER_OFF);
+        } else if (strcmp(argv[2], "auto") == 0) {
+            ledMatrix->releasePower();
+        } else {
+            ret = -1;
+            this->print("power=%s is invalid!\n", argv[2]);
+        }
+        goto done;
+    } else if ((argc == 2) && (strcmp(argv[1], "reinit") == 0)) {
+        ledMatrix->reinit();
+        goto done;
+    } else if ((argc == 3) && (strcmp(argv[1], "frame") == 0) &&
+               (strcmp(argv[2], "reset") == 0)) {
+        ledMatrix->resetFramePeriod();
+        goto done;
     } else if ((argc == 2) && (strcmp(argv[1], "blank") == 0)) {
         ledMatrix->clear();
         goto done;
     } else if ((argc == 2) && (strcmp(argv[1], "welcome") == 0)) {
         ledMatrix->setWelcomeText();
         goto done;
-    } else if ((argc > 2) && ((y = getArgY(argv[1])) != -1)) {
+    } else if ((argc > 2) && ledMatrix->parseRow(argv[1], c, y)) {
         startArg = 2;
     } else {
         goto done;
@@ -134,7 +479,7 @@ int MeshPumpShell::led(int argc, char **argv)
     }
 
     if (ledMatrix) {
-        ledMatrix->setText((unsigned int) y, message);
+        ledMatrix->setText(c, y, move(message));
     }
 
 done:
@@ -145,32 +490,35 @@ done:
 int MeshPumpShell::pump(int argc, char **argv)
 {
     int ret = 0;
-    bool isFish = false;
-    bool isUp = false;
+    int index;
     bool onOff = false;
     unsigned int cutoff = 0;
+    unsigned int seconds = 0;
+    time_t now;
+    uint64_t nowNs;
 
     if (argc == 1) {
-        this->printf("fish-pump: %s\n",
-                     meshpump->isFishPumpOn() ? "on" : "off");
-        this->printf("up-pump: %s\n",
-                     meshpump->isUpPumpOn() ? "on" : "off");
-        this->printf("up-pump auto cutoff: %u\n",
-                     meshpump->getUpPumpAutoCutoffSec());
+        this->print("%s", statusModel->views()->pump.c_str());
+        now = Clock::get()->wallTime();
+        nowNs = Clock::get()->monotonicNs();
+        for (unsigned int i = 0; i < meshpump->relayCount(); i++) {
+            RelayRuntime runtime = meshpump->relayRuntime(i);
+            this->print("%s: %.3fh on, %lu cycles, %lu cutoff + %lu manual "
+                        "stops, run %.0fs, duty 1d %.1f%% 7d %.1f%% "
+                        "30d %.1f%%\n",
+                        meshpump->relayName(i).c_str(),
+                        runtime.onNs() / 3600e9, runtime.cycles(),
+                        runtime.cutoffStops(), runtime.manualStops(),
+                        runtime.runNs(nowNs) / 1e9,
+                        runtime.dutyPercent(1, now),
+                        runtime.dutyPercent(7, now),
+                        runtime.dutyPercent(30, now));
+        }
     } else {
-        if ((argc > 1) &&
-            ((strcasecmp(argv[1], "0") == 0) ||
-             (strcasecmp(argv[1], "fish") == 0) ||
-             (strcasecmp(argv[1], "fish-pump") == 0))) {
-            isFish = true;
-        } else if ((argc > 1) &&
-                   ((strcasecmp(argv[1], "0") == 0) ||
-                    (strcasecmp(argv[1], "up") == 0) ||
-                    (strcasecmp(argv[1], "up-pump") == 0))) {
-            isUp = true;
-        } else {
+        index = meshpump->findRelay(argv[1]);
+        if (index < 0) {
             ret = -1;
-            this->printf("no pump specified!\n");
+            this->print("no pump specified!\n");
             goto done;
         }
 
@@ -180,44 +528,35 @@ int MeshPumpShell::pump(int argc, char **argv)
             onOff = false;
         } else {
             ret = -1;
-            this->printf("no on/off specified!\n");
+            this->print("no on/off specified!\n");
             goto done;
         }
 
-        if (isUp && (onOff == true) && (argc > 3)) {
+        if ((onOff == true) && (argc > 3)) {
             try {
                 cutoff = stoi(argv[3]);
             } catch (const invalid_argument &e) {
                 ret = -1;
-                this->printf("cutoff '%s' argument is invalid!\n", argv[3]);
+                this->print("cutoff '%s' argument is invalid!\n", argv[3]);
                 goto done;
             }
+        }
 
-            if (cutoff > MAX_UPPUMP_AUTO_CUTOFF_SEC) {
-                ret = -1;
-                this->printf("cut-off of %u seconds is too big!\n", cutoff);
-                goto done;
-            }
+        if ((onOff == true) &&
+            !meshpump->relayOnTime(index, cutoff, seconds)) {
+            ret = -1;
+            this->print("cut-off of %u seconds is too big!\n", cutoff);
+            goto done;
         }
 
-        if (isFish) {
-            meshpump->setFishPumpOnOff(onOff);
-            this->printf("set fish-pump to %s\n", onOff ? "on" : "off");
-        } else if (isUp) {
-            if (onOff == false) {
-                meshpump->setUpPumpOnOff(false);
-                this->printf("set up-pump to off\n");
-            } else {
-                if (cutoff == 0) {
-                    meshpump->setUpPumpOnOff(true);
-                    this->printf("set up-pump to on for %u seconds\n",
-                                 meshpump->getUpPumpAutoCutoffSec());
-                } else {
-                    meshpump->setUpPumpOnWithCutoffSec(cutoff);
-                    this->printf("set up-pump to on for %u seconds\n",
-                                 cutoff);
-                }
-            }
+        meshpump->setRelay(index, onOff, seconds);
+        if (onOff && (seconds > 0)) {
+            this->print("set %s to on for %u seconds\n",
+                        meshpump->relayName(index).c_str(), seconds);
+        } else {
+            this->print("set %s to %s\n",
+                        meshpump->relayName(index).c_str(),
+                        onOff ? "on" : "off");
         }
     }
 
@@ -229,39 +568,195 @@ done:
 int MeshPumpShell::lighting(int argc, char **argv)
 {
     int ret = 0;
+    int index = meshpump->findRelay("lighting");
+
+    if (index < 0) {
+        this->print("no lighting relay!\n");
+        ret = -1;
+        goto done;
+    }
 
     if (argc == 1) {
-        this->printf("lighting: %s\n", meshpump->isLightingOn() ?
-                     "on" : "off");
+        this->print("%s", statusModel->views()->lighting.c_str());
     } else if ((argc == 2) && (strcasecmp(argv[1], "on") == 0)) {
-        meshpump->setLightingOnOff(true);
+        meshpump->setRelay(index, true);
     } else if ((argc == 2) && (strcasecmp(argv[1], "off") == 0)) {
-        meshpump->setLightingOnOff(false);
+        meshpump->setRelay(index, false);
+    } else {
+        this->print("syntax error!\n");
+        ret = -1;
+        goto done;
+    }
+
+done:
+
+    return ret;
+}
+
+int MeshPumpShell::latency(int argc, char **argv)
+{
+    int ret = 0;
+
+    if (argc == 1) {
+        this->print("%s", LatencyTracer::get().report().c_str());
+    } else if ((argc == 2) && (strcmp(argv[1], "-v") == 0)) {
+        this->print("%s", LatencyTracer::get().report(true).c_str());
+    } else if ((argc == 2) && (strcmp(argv[1], "reset") == 0)) {
+        LatencyTracer::get().reset();
+    } else {
+        this->print("syntax error!\n");
+        ret = -1;
+    }
+
+    return ret;
+}
+
+int MeshPumpShell::log(int argc, char **argv)
+{
+    int ret = 0;
+    Logger &logger = Logger::get();
+    Logger::Category cat;
+    Logger::Level level;
+    unsigned int sinks;
+    unsigned long logged, dropped, rotations;
+
+    if (argc == 1) {
+        sinks = logger.sinks();
+        this->print("sinks:%s%s%s\n",
+                    (sinks & Logger::SINK_STDOUT) ? " stdout" : "",
+                    (sinks & Logger::SINK_FILE) ? " file" : "",
+                    (sinks & Logger::SINK_SYSLOG) ? " syslog" : "");
+        for (unsigned int i = 0; i < Logger::CAT_COUNT; i++) {
+            cat = (Logger::Category) i;
+            this->print("%s: %s\n", Logger::categoryName(cat),
+                        Logger::levelName(logger.level(cat)));
+        }
+        logger.getStats(logged, dropped, rotations);
+        this->print("%lu logged, %lu dropped, %lu rotations\n",
+                    logged, dropped, rotations);
+    } else if ((argc == 3) && Logger::parseLevel(argv[2], level)) {
+        if (strcmp(argv[1], "all") == 0) {
+            logger.setLevel(level);
+        } else if (Logger::parseCategory(argv[1], cat)) {
+            logger.setLevel(cat, level);
+        } else {
+            this->print("category '%s' is invalid!\n", argv[1]);
+            ret = -1;
+        }
     } else {
-        this->printf("syntax error!\n");
+        this->print("syntax error!\n");
+        ret = -1;
+    }
+
+    return ret;
+}
+
+/*
+ * history                   1h/1d/30d means of every series
+ * history <name>            mean, min and max of one series
+ * history <name> <tier>     every point of a tier (raw, minute, hour)
+ */
+int MeshPumpShell::history(int argc, char **argv)
+{
+    int ret = 0;
+    int index = -1;
+    TimeSeries::Tier tier;
+    time_t now = Clock::get()->wallTime();
+
+    if (historyStore == NULL) {
+        this->print("no history!\n");
         ret = -1;
         goto done;
     }
 
+    if (argc == 1) {
+        this->print("%s\n", historyStore->summary(now).c_str());
+        this->print("%u series, %zu bytes\n", historyStore->size(),
+                    historyStore->footprint());
+        goto done;
+    }
+
+    index = historyStore->find(argv[1]);
+    if (index < 0) {
+        this->print("no history for '%s'!\n", argv[1]);
+        ret = -1;
+        goto done;
+    }
+
+    if (argc == 2) {
+        this->print("%s\n", historyStore->describe(index, now).c_str());
+    } else if ((argc == 3) && TimeSeries::parseTier(argv[2], tier)) {
+        this->print("%s", historyStore->dump(index, tier).c_str());
+    } else {
+        this->print("syntax error!\n");
+        ret = -1;
+    }
+
 done:
 
     return ret;
 }
 
+/*
+ * Heap allocations and frees per subsystem since the last reset; with
+ * nothing being displayed or commanded, only the shell itself should
+ * be counting.
+ */
+int MeshPumpShell::alloc(int argc, char **argv)
+{
+    int ret = 0;
+
+    if (argc == 1) {
+        for (unsigned int i = 0; i < ALLOC_SUBSYSTEMS; i++) {
+            AllocCounts counts = AllocStats::counts(i);
+
+            this->print("%-8s %lu allocs, %lu frees, %lu bytes\n",
+                        AllocStats::name(i), counts.allocs, counts.frees,
+                        counts.bytes);
+        }
+        this->print("live: %ld bytes\n", AllocStats::liveBytes());
+    } else if ((argc == 2) && (strcmp(argv[1], "reset") == 0)) {
+        AllocStats::reset();
+    } else {
+        this->print("syntax error!\n");
+        ret = -1;
+    }
+
+    return ret;
+}
+
 int MeshPumpShell::unknown_command(int argc, char **argv)
 {
     int ret = 0;
 
+    // Connections run on threads libmeshtastic started
+    AllocStats::setSubsystem(ThreadConfig::ROLE_SHELL);
+
     if (strcmp(argv[0], "led") == 0) {
         ret = this->led(argc, argv);
     } else if (strcmp(argv[0], "pump") == 0) {
         ret = this->pump(argc, argv);
     } else if (strcmp(argv[0], "lighting") == 0) {
         ret = this->lighting(argc, argv);
+    } else if (strcmp(argv[0], "latency") == 0) {
+        ret = this->latency(argc, argv);
+    } else if (strcmp(argv[0], "log") == 0) {
+        ret = this->log(argc, argv);
+    } else if (strcmp(argv[0], "history") == 0) {
+        ret = this->history(argc, argv);
+    } else if (strcmp(argv[0], "alloc") == 0) {
+        ret = this->alloc(argc, argv);
     } else {
         ret = MeshShell::unknown_command(argc, argv);
+        goto done;
     }
 
+    Logger::get().debug(Logger::CAT_SHELL, "%s: %d", argv[0], ret);
+    _ocommands++;
+    flush();
+
+done:
+
     return ret;
 }
 
@@ -7,7 +7,13 @@
 #ifndef MESHPUMPSHELL_HXX
 #define MESHPUMPSHELL_HXX
 
+#include <atomic>
 #include <MeshShell.hxx>
+#include <Heartbeat.hxx>
+#include <Watchdog.hxx>
+
+#define SHELL_OBUF_SIZE  1024
+#define SHELL_HEARTBEAT_TIMEOUT_MS  (3 * WATCHDOG_SHELL_CHECK_MS)
 
 using namespace std;
 
@@ -18,15 +24,43 @@ public:
     MeshPumpShell(shared_ptr<MeshClient> client = NULL);
     ~MeshPumpShell();
 
+    static void getOutputStats(unsigned long &commands,
+                               unsigned long &fragments,
+                               unsigned long &writes,
+                               unsigned long &bytes);
+
 protected:
 
+    // Buffered command output; deliberately not named printf so that
+    // MeshShell's own printf stays the one that writes
+    int print(const char *format, ...)
+        __attribute__((format(printf, 2, 3)));
+    int vprint(const char *format, va_list ap);
+    void flush(void);
+
     virtual shared_ptr<MeshShell> newInstance(void);
     virtual int system(int argc, char **argv);
     virtual int led(int argc, char **argv);
     virtual int pump(int argc, char **argv);
     virtual int lighting(int argc, char **argv);
+    virtual int latency(int argc, char **argv);
+    virtual int log(int argc, char **argv);
+    virtual int history(int argc, char **argv);
+    virtual int alloc(int argc, char **argv);
     virtual int unknown_command(int argc, char **argv);
 
+private:
+
+    char _obuf[SHELL_OBUF_SIZE];
+    size_t _olen;
+
+    static atomic<unsigned long> _ocommands;
+    static atomic<unsigned long> _ofragments;
+    static atomic<unsigned long> _owrites;
+    static atomic<unsigned long> _obytes;
+
+    static Heartbeat _acceptHeartbeat;
+
 };
 
 #endif
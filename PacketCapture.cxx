@@ -0,0 +1,219 @@
+/*
+ * PacketCapture.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <cstring>
+#include <ctime>
+#include <PacketCapture.hxx>
+#include <Logger.hxx>
+
+PacketCapture::PacketCapture()
+    : _file(NULL),
+      _records(0)
+{
+
+}
+
+PacketCapture::~PacketCapture()
+{
+    close();
+}
+
+bool PacketCapture::openWrite(const string &path)
+{
+    bool result = false;
+    char header[8];
+
+    close();
+
+    _mutex.lock();
+
+    _file = fopen(path.c_str(), "ab");
+    if (_file == NULL) {
+        Logger::get().error(Logger::CAT_SYSTEM, "fopen %s: %s", path,
+                            strerror(errno));
+        goto done;
+    }
+
+    if (ftell(_file) == 0) {
+        memset(header, 0, sizeof(header));
+        memcpy(header, CAPTURE_MAGIC, strlen(CAPTURE_MAGIC));
+        header[sizeof(header) - 1] = CAPTURE_VERSION;
+        fwrite(header, sizeof(header), 1, _file);
+        fflush(_file);
+    }
+
+    _records = 0;
+    result = true;
+
+done:
+
+    _mutex.unlock();
+
+    return result;
+}
+
+bool PacketCapture::openRead(const string &path)
+{
+    bool result = false;
+    char header[8];
+
+    close();
+
+    _mutex.lock();
+
+    _file = fopen(path.c_str(), "rb");
+    if (_file == NULL) {
+        Logger::get().error(Logger::CAT_SYSTEM, "fopen %s: %s", path,
+                            strerror(errno));
+        goto done;
+    }
+
+    if ((fread(header, sizeof(header), 1, _file) != 1) ||
+        (memcmp(header, CAPTURE_MAGIC, strlen(CAPTURE_MAGIC)) != 0) ||
+        (header[sizeof(header) - 1] != CAPTURE_VERSION)) {
+        Logger::get().error(Logger::CAT_SYSTEM,
+                            "%s is not a meshpump capture!", path);
+        fclose(_file);
+        _file = NULL;
+        goto done;
+    }
+
+    _records = 0;
+    result = true;
+
+done:
+
+    _mutex.unlock();
+
+    return result;
+}
+
+void PacketCapture::close(void)
+{
+    _mutex.lock();
+    if (_file != NULL) {
+        fclose(_file);
+        _file = NULL;
+    }
+    _mutex.unlock();
+}
+
+bool PacketCapture::isOpen(void) const
+{
+    return _file != NULL;
+}
+
+bool PacketCapture::write(const meshtastic_MeshPacket &packet,
+                          const string &message)
+{
+    bool result = false;
+    struct CaptureRecordHeader hdr;
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.timestamp = ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+    hdr.from = packet.from;
+    hdr.to = packet.to;
+    hdr.id = packet.id;
+    hdr.channel = packet.channel;
+    hdr.rx_time = packet.rx_time;
+    hdr.rx_snr = packet.rx_snr;
+    hdr.rx_rssi = packet.rx_rssi;
+    hdr.hop_limit = packet.hop_limit;
+    hdr.want_ack = packet.want_ack;
+    hdr.length = message.size() > UINT16_MAX ? UINT16_MAX : message.size();
+
+    _mutex.lock();
+
+    if (_file == NULL) {
+        goto done;
+    }
+
+    if ((fwrite(&hdr, sizeof(hdr), 1, _file) != 1) ||
+        (fwrite(message.data(), 1, hdr.length, _file) != hdr.length)) {
+        goto done;
+    }
+
+    fflush(_file);
+    _records++;
+    result = true;
+
+done:
+
+    _mutex.unlock();
+
+    return result;
+}
+
+bool PacketCapture::read(uint64_t &timestamp, meshtastic_MeshPacket &packet,
+                         string &message)
+{
+    bool result = false;
+    struct CaptureRecordHeader hdr;
+    size_t size;
+
+    _mutex.lock();
+
+    if (_file == NULL) {
+        goto done;
+    }
+
+    if (fread(&hdr, sizeof(hdr), 1, _file) != 1) {
+        goto done;
+    }
+
+    message.resize(hdr.length);
+    if ((hdr.length > 0) &&
+        (fread(&message[0], 1, hdr.length, _file) != hdr.length)) {
+        goto done;
+    }
+
+    timestamp = hdr.timestamp;
+    memset(&packet, 0, sizeof(packet));
+    packet.from = hdr.from;
+    packet.to = hdr.to;
+    packet.id = hdr.id;
+    packet.channel = hdr.channel;
+    packet.rx_time = hdr.rx_time;
+    packet.rx_snr = hdr.rx_snr;
+    packet.rx_rssi = hdr.rx_rssi;
+    packet.hop_limit = hdr.hop_limit;
+    packet.want_ack = hdr.want_ack;
+    packet.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    packet.decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+    size = message.size();
+    if (size > sizeof(packet.decoded.payload.bytes)) {
+        size = sizeof(packet.decoded.payload.bytes);
+    }
+    memcpy(packet.decoded.payload.bytes, message.data(), size);
+    packet.decoded.payload.size = size;
+
+    _records++;
+    result = true;
+
+done:
+
+    _mutex.unlock();
+
+    return result;
+}
+
+unsigned long PacketCapture::records(void) const
+{
+    return _records;
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,76 @@
+/*
+ * PacketCapture.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef PACKETCAPTURE_HXX
+#define PACKETCAPTURE_HXX
+
+#include <stdio.h>
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <LibMeshtastic.hxx>
+
+#define CAPTURE_MAGIC    "MPCAP"
+#define CAPTURE_VERSION  1
+
+using namespace std;
+
+/*
+ * Capture file layout (host byte order): a 8-byte file header of
+ * CAPTURE_MAGIC + version, followed by one CaptureRecordHeader and
+ * 'length' bytes of message text per received text message.
+ */
+struct CaptureRecordHeader {
+    uint64_t timestamp;     // CLOCK_REALTIME, ns
+    uint32_t from;
+    uint32_t to;
+    uint32_t id;
+    uint32_t channel;
+    uint32_t rx_time;
+    float rx_snr;
+    int32_t rx_rssi;
+    uint8_t hop_limit;
+    uint8_t want_ack;
+    uint16_t length;
+} __attribute__((packed));
+
+class PacketCapture {
+
+public:
+
+    PacketCapture();
+    ~PacketCapture();
+
+    bool openWrite(const string &path);
+    bool openRead(const string &path);
+    void close(void);
+    bool isOpen(void) const;
+
+    bool write(const meshtastic_MeshPacket &packet, const string &message);
+    bool read(uint64_t &timestamp, meshtastic_MeshPacket &packet,
+              string &message);
+
+    unsigned long records(void) const;
+
+private:
+
+    FILE *_file;
+    mutex _mutex;
+    unsigned long _records;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,138 @@
+/*
+ * RateLimiter.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <Clock.hxx>
+#include <RateLimiter.hxx>
+
+RateLimiter::RateLimiter(unsigned int ratePerMin, unsigned int burst,
+                         unsigned int coalesceMs)
+    : _ratePerMin(ratePerMin),
+      _burst(burst),
+      _coalesceMs(coalesceMs),
+      _allowed(0),
+      _coalesced(0),
+      _dropped(0)
+{
+
+}
+
+RateLimiter::~RateLimiter()
+{
+
+}
+
+void RateLimiter::configure(unsigned int ratePerMin, unsigned int burst,
+                            unsigned int coalesceMs)
+{
+    _mutex.lock();
+    _ratePerMin = ratePerMin;
+    _burst = (burst > 0) ? burst : 1;
+    _coalesceMs = coalesceMs;
+    _buckets.clear();
+    _mutex.unlock();
+}
+
+uint64_t RateLimiter::nowMs(void)
+{
+    return Clock::get()->monotonicMs();
+}
+
+void RateLimiter::evict(void)
+{
+    unordered_map<uint32_t, Bucket>::iterator it, stalest;
+
+    stalest = _buckets.begin();
+    for (it = _buckets.begin(); it != _buckets.end(); it++) {
+        if (it->second.refilled < stalest->second.refilled) {
+            stalest = it;
+        }
+    }
+
+    if (stalest != _buckets.end()) {
+        _buckets.erase(stalest);
+    }
+}
+
+RateLimiter::Verdict RateLimiter::check(uint32_t node_num,
+                                        const string &command)
+{
+    Verdict verdict = ALLOW;
+    uint64_t now = nowMs();
+    unordered_map<uint32_t, Bucket>::iterator it;
+
+    _mutex.lock();
+
+    if (_ratePerMin == 0) {
+        _allowed++;
+        goto done;
+    }
+
+    it = _buckets.find(node_num);
+    if (it == _buckets.end()) {
+        Bucket bucket;
+
+        if (_buckets.size() >= RATELIMIT_MAX_NODES) {
+            evict();
+        }
+
+        bucket.tokens = _burst;
+        bucket.refilled = now;
+        bucket.executed = 0;
+        it = _buckets.insert(make_pair(node_num, bucket)).first;
+    }
+
+    if ((it->second.executed != 0) &&
+        ((now - it->second.executed) < _coalesceMs) &&
+        (it->second.command == command)) {
+        verdict = COALESCE;
+        _coalesced++;
+        goto done;
+    }
+
+    it->second.tokens += ((now - it->second.refilled) * _ratePerMin) /
+        60000.0;
+    if (it->second.tokens > _burst) {
+        it->second.tokens = _burst;
+    }
+    it->second.refilled = now;
+
+    if (it->second.tokens < 1.0) {
+        verdict = DROP;
+        _dropped++;
+        goto done;
+    }
+
+    it->second.tokens -= 1.0;
+    it->second.command = command;
+    it->second.executed = now;
+    _allowed++;
+
+done:
+
+    _mutex.unlock();
+
+    return verdict;
+}
+
+void RateLimiter::getStats(unsigned long &allowed, unsigned long &coalesced,
+                           unsigned long &dropped) const
+{
+    _mutex.lock();
+    allowed = _allowed;
+    coalesced = _coalesced;
+    dropped = _dropped;
+    _mutex.unlock();
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
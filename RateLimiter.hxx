@@ -0,0 +1,79 @@
+/*
+ * RateLimiter.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef RATELIMITER_HXX
+#define RATELIMITER_HXX
+
+#include <stdint.h>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#define RATELIMIT_MAX_NODES  256
+
+using namespace std;
+
+/*
+ * Per-node token bucket for chat commands. An identical command repeated
+ * by the same node within the coalescing window is absorbed without
+ * consuming a token, so it costs neither an action nor a reply.
+ */
+class RateLimiter {
+
+public:
+
+    enum Verdict {
+        ALLOW,
+        COALESCE,
+        DROP,
+    };
+
+    RateLimiter(unsigned int ratePerMin = 12, unsigned int burst = 5,
+                unsigned int coalesceMs = 2000);
+    ~RateLimiter();
+
+    void configure(unsigned int ratePerMin, unsigned int burst,
+                   unsigned int coalesceMs);
+    Verdict check(uint32_t node_num, const string &command);
+
+    void getStats(unsigned long &allowed, unsigned long &coalesced,
+                  unsigned long &dropped) const;
+
+private:
+
+    struct Bucket {
+        double tokens;
+        uint64_t refilled;
+        string command;
+        uint64_t executed;
+    };
+
+    static uint64_t nowMs(void);
+    void evict(void);
+
+    mutable mutex _mutex;
+    unsigned int _ratePerMin;
+    unsigned int _burst;
+    unsigned int _coalesceMs;
+    unordered_map<uint32_t, Bucket> _buckets;
+
+    unsigned long _allowed;
+    unsigned long _coalesced;
+    unsigned long _dropped;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
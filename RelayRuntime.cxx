@@ -0,0 +1,246 @@
+/*
+ * RelayRuntime.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <string.h>
+#include <cstdio>
+#include <RelayRuntime.hxx>
+
+#define MS_PER_DAY  86400000U
+
+RelayRuntime::RelayRuntime()
+    : _on(false),
+      _lastNs(0),
+      _runStartNs(0),
+      _onNs(0),
+      _cycles(0),
+      _cutoffStops(0),
+      _manualStops(0),
+      _day(0)
+{
+    memset(_dayOnMs, 0, sizeof(_dayOnMs));
+}
+
+RelayRuntime::~RelayRuntime()
+{
+
+}
+
+uint32_t RelayRuntime::localDay(time_t t)
+{
+    struct tm tm;
+
+    localtime_r(&t, &tm);
+
+    return (uint32_t) ((t + tm.tm_gmtoff) / 86400);
+}
+
+void RelayRuntime::edge(bool on, bool cutoff, uint64_t nowNs, time_t now)
+{
+    settle(nowNs, now);
+
+    if (on && !_on) {
+        _cycles++;
+        _runStartNs = nowNs;
+    } else if (!on && _on) {
+        if (cutoff) {
+            _cutoffStops++;
+        } else {
+            _manualStops++;
+        }
+    }
+
+    _on = on;
+}
+
+void RelayRuntime::settle(uint64_t nowNs, time_t now)
+{
+    if (_on && (nowNs > _lastNs)) {
+        credit(nowNs - _lastNs, now);
+    }
+    _lastNs = nowNs;
+}
+
+void RelayRuntime::credit(uint64_t ns, time_t now)
+{
+    uint32_t day = localDay(now);
+    uint32_t gap;
+    uint32_t *bucket;
+
+    _onNs += ns;
+
+    if (day > _day) {
+        gap = day - _day;
+        if (gap > RELAY_RUNTIME_DAYS) {
+            gap = RELAY_RUNTIME_DAYS;
+        }
+        for (uint32_t k = 0; k < gap; k++) {
+            _dayOnMs[(day - k) % RELAY_RUNTIME_DAYS] = 0;
+        }
+        _day = day;
+    }
+
+    // A wall clock stepped back keeps crediting the newest day
+    bucket = &_dayOnMs[_day % RELAY_RUNTIME_DAYS];
+    *bucket += ns / 1000000ULL;
+    if (*bucket > MS_PER_DAY) {
+        *bucket = MS_PER_DAY;
+    }
+}
+
+/*
+ * Adds the totals saved by a previous run to this one's.
+ */
+void RelayRuntime::merge(const RelayRuntime &saved)
+{
+    uint32_t day;
+
+    _onNs += saved._onNs;
+    _cycles += saved._cycles;
+    _cutoffStops += saved._cutoffStops;
+    _manualStops += saved._manualStops;
+
+    if (_day == 0) {
+        _day = saved._day;
+        memcpy(_dayOnMs, saved._dayOnMs, sizeof(_dayOnMs));
+        return;
+    }
+
+    for (uint32_t k = 0; k < RELAY_RUNTIME_DAYS; k++) {
+        if (k > saved._day) {
+            break;
+        }
+        day = saved._day - k;
+        if ((day <= _day) && ((_day - day) < RELAY_RUNTIME_DAYS)) {
+            _dayOnMs[day % RELAY_RUNTIME_DAYS] +=
+                saved._dayOnMs[day % RELAY_RUNTIME_DAYS];
+        }
+    }
+}
+
+uint64_t RelayRuntime::onNs(void) const
+{
+    return _onNs;
+}
+
+uint64_t RelayRuntime::runNs(uint64_t nowNs) const
+{
+    return (_on && (nowNs > _runStartNs)) ? nowNs - _runStartNs : 0;
+}
+
+unsigned long RelayRuntime::cycles(void) const
+{
+    return _cycles;
+}
+
+unsigned long RelayRuntime::cutoffStops(void) const
+{
+    return _cutoffStops;
+}
+
+unsigned long RelayRuntime::manualStops(void) const
+{
+    return _manualStops;
+}
+
+/*
+ * The share of the last 'days' local days (today so far included) that
+ * the relay was on.
+ */
+float RelayRuntime::dutyPercent(unsigned int days, time_t now) const
+{
+    uint32_t today = localDay(now);
+    uint64_t windowMs, ms = 0;
+    struct tm tm;
+
+    if (days == 0) {
+        return 0.0;
+    }
+    if (days > RELAY_RUNTIME_DAYS) {
+        days = RELAY_RUNTIME_DAYS;
+    }
+
+    localtime_r(&now, &tm);
+    windowMs = ((uint64_t) (days - 1) * MS_PER_DAY) +
+        ((uint64_t) ((now + tm.tm_gmtoff) % 86400) * 1000);
+
+    for (uint32_t k = 0; (k < days) && (k <= today); k++) {
+        uint32_t day = today - k;
+        if ((day <= _day) && ((_day - day) < RELAY_RUNTIME_DAYS)) {
+            ms += _dayOnMs[day % RELAY_RUNTIME_DAYS];
+        }
+    }
+
+    if (windowMs == 0) {
+        return 0.0;
+    }
+    if (ms > windowMs) {
+        ms = windowMs;
+    }
+
+    return (ms * 100.0) / windowMs;
+}
+
+string RelayRuntime::summary(time_t now) const
+{
+    char buf[96];
+
+    snprintf(buf, sizeof(buf),
+             "%.1fh, %lu cycles, duty 1d %.0f%% 7d %.0f%%",
+             _onNs / 3600e9, (unsigned long) _cycles,
+             dutyPercent(1, now), dutyPercent(7, now));
+
+    return buf;
+}
+
+bool RelayRuntime::write(FILE *fp, const string &name) const
+{
+    char buf[16];
+    uint64_t counters[4];
+
+    memset(buf, 0, sizeof(buf));
+    strncpy(buf, name.c_str(), sizeof(buf) - 1);
+    counters[0] = _onNs;
+    counters[1] = _cycles;
+    counters[2] = _cutoffStops;
+    counters[3] = _manualStops;
+
+    return (fwrite(buf, sizeof(buf), 1, fp) == 1) &&
+        (fwrite(counters, sizeof(counters), 1, fp) == 1) &&
+        (fwrite(&_day, sizeof(_day), 1, fp) == 1) &&
+        (fwrite(_dayOnMs, sizeof(_dayOnMs), 1, fp) == 1);
+}
+
+bool RelayRuntime::read(FILE *fp, string &name)
+{
+    char buf[16];
+    uint64_t counters[4];
+
+    if ((fread(buf, sizeof(buf), 1, fp) != 1) ||
+        (fread(counters, sizeof(counters), 1, fp) != 1) ||
+        (fread(&_day, sizeof(_day), 1, fp) != 1) ||
+        (fread(_dayOnMs, sizeof(_dayOnMs), 1, fp) != 1)) {
+        return false;
+    }
+
+    buf[sizeof(buf) - 1] = '\0';
+    name = buf;
+    _onNs = counters[0];
+    _cycles = counters[1];
+    _cutoffStops = counters[2];
+    _manualStops = counters[3];
+
+    return true;
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
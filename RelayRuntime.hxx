@@ -0,0 +1,77 @@
+/*
+ * RelayRuntime.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef RELAYRUNTIME_HXX
+#define RELAYRUNTIME_HXX
+
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+#include <string>
+
+#define RELAY_RUNTIME_DAYS  30
+
+using namespace std;
+
+/*
+ * Run-time accounting of one relay. Every edge is timed on the monotonic
+ * clock, so on-time is exact to the nanosecond and immune to wall-clock
+ * steps; the wall clock only picks the (local) day bucket that on-time
+ * is credited to. An on relay is credited when it is settled, which
+ * MeshPump does on every edge and from crontab.
+ */
+class RelayRuntime {
+
+public:
+
+    RelayRuntime();
+    ~RelayRuntime();
+
+    void edge(bool on, bool cutoff, uint64_t nowNs, time_t now);
+    void settle(uint64_t nowNs, time_t now);
+    void merge(const RelayRuntime &saved);
+
+    uint64_t onNs(void) const;
+    uint64_t runNs(uint64_t nowNs) const;
+    unsigned long cycles(void) const;
+    unsigned long cutoffStops(void) const;
+    unsigned long manualStops(void) const;
+    float dutyPercent(unsigned int days, time_t now) const;
+
+    string summary(time_t now) const;
+
+    bool write(FILE *fp, const string &name) const;
+    bool read(FILE *fp, string &name);
+
+private:
+
+    static uint32_t localDay(time_t t);
+    void credit(uint64_t ns, time_t now);
+
+    bool _on;
+    uint64_t _lastNs;            // Last edge or settle
+    uint64_t _runStartNs;        // When the current run began
+
+    uint64_t _onNs;
+    uint64_t _cycles;
+    uint64_t _cutoffStops;
+    uint64_t _manualStops;
+    uint32_t _day;               // Local day of the newest bucket
+    uint32_t _dayOnMs[RELAY_RUNTIME_DAYS];
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,197 @@
+/*
+ * RelayTable.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <cctype>
+#include <cstdlib>
+#include <RelayTable.hxx>
+
+RelayChannel::RelayChannel()
+    : pin(0),
+      activeLow(true),
+      defaultOn(false),
+      cutoffSec(0),
+      maxOnSec(0),
+      ledRow(-1),
+      ledSticky(false),
+      on(false),
+      deadline(0)
+{
+
+}
+
+RelayTable::RelayTable()
+{
+
+}
+
+RelayTable::~RelayTable()
+{
+
+}
+
+/*
+ * The original wiring, used when the configuration has no relay table.
+ */
+vector<RelayChannel> RelayTable::defaults(void)
+{
+    vector<RelayChannel> relays;
+    RelayChannel relay;
+
+    relay.name = "fish-pump";
+    relay.pin = 26;
+    relay.defaultOn = true;
+    relay.ledRow = 3;
+    relay.ledSticky = true;
+    relays.push_back(relay);
+
+    relay = RelayChannel();
+    relay.name = "up-pump";
+    relay.pin = 20;
+    relay.cutoffSec = 10;
+    relay.maxOnSec = 120;
+    relay.ledRow = 2;
+    relay.ledSticky = true;
+    relays.push_back(relay);
+
+    relay = RelayChannel();
+    relay.name = "lighting";
+    relay.pin = 21;
+    relay.ledRow = 1;
+    relays.push_back(relay);
+
+    return relays;
+}
+
+bool RelayTable::add(const RelayChannel &relay, string &error)
+{
+    bool result = false;
+    unsigned int index = _relays.size();
+    string name, shortName;
+    size_t dash;
+
+    for (string::const_iterator it = relay.name.begin();
+         it != relay.name.end(); it++) {
+        name += tolower(*it);
+    }
+
+    if (_relays.size() >= RELAY_MAX_CHANNELS) {
+        error = "too many relays";
+        goto done;
+    }
+
+    if (name.empty() || (name.size() > RELAY_MAX_NAME) ||
+        isdigit(name[0]) ||
+        (name.find_first_not_of("abcdefghijklmnopqrstuvwxyz0123456789-_") !=
+         string::npos)) {
+        error = "relay name '" + name + "' is invalid";
+        goto done;
+    }
+
+    if (_byName.find(name) != _byName.end()) {
+        error = "relay '" + name + "' is defined twice";
+        goto done;
+    }
+
+    if (relay.pin > RELAY_MAX_PIN) {
+        error = "pin " + to_string(relay.pin) + " of relay '" + name +
+            "' is out of range";
+        goto done;
+    }
+
+    for (vector<RelayChannel>::const_iterator it = _relays.begin();
+         it != _relays.end(); it++) {
+        if (it->pin == relay.pin) {
+            error = "pin " + to_string(relay.pin) + " is used by '" +
+                it->name + "'";
+            goto done;
+        }
+    }
+
+    if ((relay.maxOnSec > 0) && (relay.cutoffSec > relay.maxOnSec)) {
+        error = "cutoff of relay '" + name + "' exceeds its max on-time";
+        goto done;
+    }
+
+    _relays.push_back(relay);
+    _relays.back().name = name;
+    _byName[name] = index;
+
+    dash = name.find('-');
+    if (dash != string::npos) {
+        shortName = name.substr(0, dash);
+        if (_byShortName.find(shortName) == _byShortName.end()) {
+            _byShortName[shortName] = index;
+        } else {
+            _byShortName[shortName] = -1;
+        }
+    }
+
+    result = true;
+
+done:
+
+    return result;
+}
+
+unsigned int RelayTable::size(void) const
+{
+    return _relays.size();
+}
+
+/*
+ * Returns the index of the relay, or -1. The name must be lowercase.
+ */
+int RelayTable::find(const string &name) const
+{
+    unordered_map<string, unsigned int>::const_iterator it;
+    unordered_map<string, int>::const_iterator sit;
+    char *endp;
+    unsigned long index;
+
+    if (name.empty()) {
+        return -1;
+    }
+
+    if (isdigit(name[0])) {
+        index = strtoul(name.c_str(), &endp, 10);
+        if ((*endp != '\0') || (index >= _relays.size())) {
+            return -1;
+        }
+        return (int) index;
+    }
+
+    it = _byName.find(name);
+    if (it != _byName.end()) {
+        return (int) it->second;
+    }
+
+    sit = _byShortName.find(name);
+    if (sit != _byShortName.end()) {
+        return sit->second;
+    }
+
+    return -1;
+}
+
+RelayChannel &RelayTable::operator[](unsigned int index)
+{
+    return _relays[index];
+}
+
+const RelayChannel &RelayTable::operator[](unsigned int index) const
+{
+    return _relays[index];
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,82 @@
+/*
+ * RelayTable.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef RELAYTABLE_HXX
+#define RELAYTABLE_HXX
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <RelayRuntime.hxx>
+
+#define RELAY_MAX_CHANNELS  16
+#define RELAY_MAX_NAME      15
+#define RELAY_MAX_PIN       31  // Everything is switched on GPIO bank 1
+
+using namespace std;
+
+/*
+ * One relay channel: its wiring and policy from the configuration, plus
+ * the runtime state that MeshPump keeps under its relay mutex.
+ */
+struct RelayChannel {
+    string name;
+    unsigned int pin;
+    bool activeLow;
+    bool defaultOn;
+    unsigned int cutoffSec;     // Auto cutoff when switched on, 0 = none
+    unsigned int maxOnSec;      // Longest allowed on-time, 0 = unlimited
+    int ledRow;                 // -1 if the state isn't shown
+    bool ledSticky;             // Keep the non-default state on the LED
+    vector<uint32_t> nodes;     // Allowed to switch it over chat, empty = all
+
+    bool on;
+    uint64_t deadline;          // Clock seconds when it turns off, 0 = none
+    RelayRuntime runtime;
+
+    RelayChannel();
+};
+
+/*
+ * The relays, looked up in O(1) by index, by name, or by the first word
+ * of a hyphenated name ("fish" for "fish-pump") when that is unique.
+ */
+class RelayTable {
+
+public:
+
+    RelayTable();
+    ~RelayTable();
+
+    static vector<RelayChannel> defaults(void);
+
+    bool add(const RelayChannel &relay, string &error);
+    unsigned int size(void) const;
+    int find(const string &name) const;
+
+    RelayChannel &operator[](unsigned int index);
+    const RelayChannel &operator[](unsigned int index) const;
+
+private:
+
+    vector<RelayChannel> _relays;
+    unordered_map<string, unsigned int> _byName;
+    unordered_map<string, int> _byShortName;  // -1 if ambiguous
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
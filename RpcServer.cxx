@@ -0,0 +1,574 @@
+/*
+ * RpcServer.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <cmath>
+#include <cstring>
+#include <MeshPump.hxx>
+#include <LedMatrix.hxx>
+#include <StatusModel.hxx>
+#include <ThreadConfig.hxx>
+#include <RpcServer.hxx>
+#include <Logger.hxx>
+
+extern shared_ptr<MeshPump> meshpump;
+extern shared_ptr<LedMatrix> ledMatrix;
+extern shared_ptr<StatusModel> statusModel;
+
+RpcServer::RpcServer()
+    : _fd(-1),
+      _running(false),
+      _heartbeat("rpc", 2000)
+{
+
+}
+
+RpcServer::~RpcServer()
+{
+    detach();
+    join();
+
+    for (vector<Connection>::iterator it = _connections.begin();
+         it != _connections.end(); it++) {
+        close(it->fd);
+    }
+    _connections.clear();
+
+    if (_fd != -1) {
+        close(_fd);
+        _fd = -1;
+    }
+}
+
+bool RpcServer::bindPort(uint16_t port)
+{
+    bool result = false;
+    struct sockaddr_in addr;
+    int on = 1;
+
+    if (_thread != NULL) {
+        goto done;
+    }
+
+    _fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (_fd == -1) {
+        Logger::get().error(Logger::CAT_SHELL, "socket: %s", strerror(errno));
+        goto done;
+    }
+
+    setsockopt(_fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(_fd, (struct sockaddr *) &addr, sizeof(addr)) == -1) {
+        Logger::get().error(Logger::CAT_SHELL, "bind %u: %s", port,
+                            strerror(errno));
+        goto done;
+    }
+
+    if (listen(_fd, RPC_MAX_CONNECTIONS) == -1) {
+        Logger::get().error(Logger::CAT_SHELL, "listen: %s", strerror(errno));
+        goto done;
+    }
+
+    _running = true;
+    _thread = make_shared<thread>(RpcServer::thread_func, this);
+    result = true;
+
+done:
+
+    if ((result == false) && (_fd != -1)) {
+        close(_fd);
+        _fd = -1;
+    }
+
+    return result;
+}
+
+void RpcServer::detach(void)
+{
+    _running = false;
+}
+
+void RpcServer::join(void)
+{
+    if (_thread != NULL) {
+        if (_thread->joinable()) {
+            _thread->join();
+        }
+    }
+}
+
+void *RpcServer::thread_func(void *args)
+{
+    RpcServer *server = (RpcServer *) args;
+
+    ThreadConfig::get().apply(ThreadConfig::ROLE_RPC);
+    server->run();
+
+    return NULL;
+}
+
+void RpcServer::run(void)
+{
+    struct pollfd fds[RPC_MAX_CONNECTIONS + 1];
+    unsigned int nfds, i;
+    int ret;
+
+    while (_running) {
+        _heartbeat.beat();
+        nfds = 0;
+        fds[nfds].fd = _fd;
+        fds[nfds].events = POLLIN;
+        fds[nfds].revents = 0;
+        nfds++;
+        for (i = 0; i < _connections.size(); i++) {
+            fds[nfds].fd = _connections[i].fd;
+            fds[nfds].events = POLLIN;
+            fds[nfds].revents = 0;
+            nfds++;
+        }
+
+        ret = poll(fds, nfds, 500);
+        if (ret <= 0) {
+            continue;
+        }
+
+        // Serve the existing connections, newest first so that erasing
+        // keeps the remaining indices valid
+        for (i = nfds - 1; i > 0; i--) {
+            bool closing = false;
+
+            if (fds[i].revents == 0) {
+                continue;
+            }
+
+            serve(_connections[i - 1], closing);
+            if (closing) {
+                close(_connections[i - 1].fd);
+                _connections.erase(_connections.begin() + (i - 1));
+            }
+        }
+
+        if (fds[0].revents & POLLIN) {
+            int fd = accept(_fd, NULL, NULL);
+            if (fd != -1) {
+                if (_connections.size() >= RPC_MAX_CONNECTIONS) {
+                    close(fd);
+                } else {
+                    Connection conn;
+                    conn.fd = fd;
+                    _connections.push_back(conn);
+                }
+            }
+        }
+    }
+
+    _heartbeat.park();
+}
+
+static bool sendAll(int fd, const string &s)
+{
+    size_t sent = 0;
+    ssize_t ret;
+
+    while (sent < s.size()) {
+        ret = send(fd, s.data() + sent, s.size() - sent, MSG_NOSIGNAL);
+        if (ret <= 0) {
+            if ((ret == -1) && (errno == EINTR)) {
+                continue;
+            }
+            return false;
+        }
+        sent += ret;
+    }
+
+    return true;
+}
+
+void RpcServer::serve(Connection &conn, bool &closing)
+{
+    char buf[4096];
+    ssize_t len;
+    size_t pos;
+    string line, out;
+
+    len = read(conn.fd, buf, sizeof(buf));
+    if (len <= 0) {
+        closing = true;
+        return;
+    }
+
+    conn.in.append(buf, len);
+    while ((pos = conn.in.find('\n')) != string::npos) {
+        line = conn.in.substr(0, pos);
+        conn.in.erase(0, pos + 1);
+        if (!line.empty() && (line[line.size() - 1] == '\r')) {
+            line.erase(line.size() - 1);
+        }
+        if (line.find_first_not_of(" \t") == string::npos) {
+            continue;
+        }
+
+        out = handle(line);
+        if (!out.empty()) {
+            out += "\n";
+            if (!sendAll(conn.fd, out)) {
+                closing = true;
+                return;
+            }
+        }
+    }
+
+    if (conn.in.size() > RPC_MAX_LINE) {
+        sendAll(conn.fd, replyError(NULL, RPC_PARSE_ERROR,
+                                    "request too long") + "\n");
+        closing = true;
+    }
+}
+
+static bool getUInt(const JsonValue *v, unsigned int max, unsigned int &u)
+{
+    if ((v == NULL) || !v->isNumber() || (v->number < 0) ||
+        (v->number > max) || (v->number != floor(v->number))) {
+        return false;
+    }
+
+    u = (unsigned int) v->number;
+
+    return true;
+}
+
+/*
+ * A relay is addressed by its name, short name or index in the relay
+ * table.
+ */
+static bool getRelay(const JsonValue *v, unsigned int &index, string &error)
+{
+    int found;
+
+    if ((v != NULL) && v->isString()) {
+        found = meshpump->findRelay(v->str);
+        if (found < 0) {
+            error = "unknown relay '" + v->str + "'";
+            return false;
+        }
+        index = (unsigned int) found;
+    } else if ((meshpump->relayCount() == 0) ||
+               !getUInt(v, meshpump->relayCount() - 1, index)) {
+        error = "relay must be a name or an index";
+        return false;
+    }
+
+    return true;
+}
+
+static bool getChain(const JsonValue *v, unsigned int &index, string &error)
+{
+    int found;
+
+    if ((v != NULL) && v->isString()) {
+        found = ledMatrix->findChain(v->str);
+        if (found < 0) {
+            error = "unknown LED chain '" + v->str + "'";
+            return false;
+        }
+        index = (unsigned int) found;
+    } else if (!getUInt(v, ledMatrix->chainCount() - 1, index)) {
+        error = "chain must be a name or an index";
+        return false;
+    }
+
+    return true;
+}
+
+void RpcServer::prepare(const JsonValue &request, Op &op) const
+{
+    const JsonValue *version, *method, *id, *params, *v;
+    string name;
+
+    op.hasId = false;
+    op.code = 0;
+    op.index = 0;
+    op.chain = 0;
+    op.onOff = false;
+    op.seconds = 0;
+    op.onTime = 0;
+    op.ttl = 30;
+
+    if (!request.isObject()) {
+        op.code = RPC_INVALID_REQUEST;
+        op.error = "request is not an object";
+        return;
+    }
+
+    id = request.get("id");
+    if (id != NULL) {
+        op.id = *id;
+        op.hasId = true;
+    }
+
+    version = request.get("jsonrpc");
+    method = request.get("method");
+    if ((version == NULL) || !version->isString() ||
+        (version->str != "2.0") ||
+        (method == NULL) || !method->isString()) {
+        op.code = RPC_INVALID_REQUEST;
+        op.error = "invalid request";
+        return;
+    }
+
+    params = request.get("params");
+    if ((params != NULL) && !params->isObject()) {
+        op.code = RPC_INVALID_PARAMS;
+        op.error = "params must be an object";
+        return;
+    }
+
+    name = method->str;
+    if (name == "status") {
+        op.kind = Op::STATUS;
+    } else if (name == "set_relay") {
+        op.kind = Op::RELAY;
+        v = params ? params->get("relay") : NULL;
+        if (!getRelay(v, op.index, op.error)) {
+            op.code = RPC_INVALID_PARAMS;
+            return;
+        }
+
+        v = params->get("on");
+        if ((v == NULL) || !v->isBool()) {
+            op.code = RPC_INVALID_PARAMS;
+            op.error = "on must be a boolean";
+            return;
+        }
+        op.onOff = v->boolean;
+
+        v = params->get("cutoff");
+        if ((v != NULL) && !getUInt(v, UINT_MAX, op.seconds)) {
+            op.code = RPC_OUT_OF_RANGE;
+            op.error = "cutoff is out of range";
+            return;
+        }
+
+        if (op.onOff &&
+            !meshpump->relayOnTime(op.index, op.seconds, op.seconds)) {
+            op.code = RPC_OUT_OF_RANGE;
+            op.error = "cutoff is out of range";
+            return;
+        }
+    } else if (name == "set_cutoff") {
+        op.kind = Op::CUTOFF;
+        v = params ? params->get("relay") : NULL;
+        if (v == NULL) {
+            op.index = meshpump->findRelay("up-pump");
+        } else if (!getRelay(v, op.index, op.error)) {
+            op.code = RPC_INVALID_PARAMS;
+            return;
+        }
+        if (op.index >= meshpump->relayCount()) {
+            op.code = RPC_INVALID_PARAMS;
+            op.error = "relay is missing";
+            return;
+        }
+
+        v = params ? params->get("seconds") : NULL;
+        if (!getUInt(v, UINT_MAX, op.seconds) ||
+            !meshpump->relayOnTime(op.index, op.seconds, op.onTime)) {
+            op.code = RPC_OUT_OF_RANGE;
+            op.error = "seconds is missing or out of range";
+            return;
+        }
+    } else if (name == "set_led") {
+        op.kind = Op::LED;
+        v = params ? params->get("chain") : NULL;
+        if (v == NULL) {
+            op.chain = 0;
+        } else if (!getChain(v, op.chain, op.error)) {
+            op.code = RPC_INVALID_PARAMS;
+            return;
+        }
+
+        v = params ? params->get("row") : NULL;
+        if (!getUInt(v, ledMatrix->rows(op.chain) - 1, op.index)) {
+            op.code = RPC_OUT_OF_RANGE;
+            op.error = "row is missing or out of range";
+            return;
+        }
+
+        v = params->get("text");
+        if ((v == NULL) || !v->isString()) {
+            op.code = RPC_INVALID_PARAMS;
+            op.error = "text must be a string";
+            return;
+        }
+        op.text = v->str;
+
+        v = params->get("ttl");
+        if ((v != NULL) && !getUInt(v, UINT_MAX, op.ttl)) {
+            op.code = RPC_INVALID_PARAMS;
+            op.error = "ttl must be a non-negative integer";
+            return;
+        }
+    } else if (name == "led_clear") {
+        op.kind = Op::LED_CLEAR;
+    } else if (name == "led_welcome") {
+        op.kind = Op::LED_WELCOME;
+    } else {
+        op.code = RPC_METHOD_NOT_FOUND;
+        op.error = "method '" + name + "' not found";
+        return;
+    }
+}
+
+string RpcServer::apply(const Op &op)
+{
+    string result = "true";
+
+    switch (op.kind) {
+    case Op::STATUS:
+        meshpump->refreshCpuTemp();
+        result = statusModel->views()->json;
+        break;
+    case Op::RELAY:
+        meshpump->setRelay(op.index, op.onOff, op.seconds);
+        break;
+    case Op::CUTOFF:
+        meshpump->setRelayCutoffSec(op.index, op.seconds);
+        break;
+    case Op::LED:
+        ledMatrix->setText(op.chain, op.index, op.text, op.ttl);
+        break;
+    case Op::LED_CLEAR:
+        ledMatrix->clear();
+        break;
+    case Op::LED_WELCOME:
+        ledMatrix->setWelcomeText();
+        break;
+    }
+
+    return result;
+}
+
+string RpcServer::reply(const Op &op, const string &result)
+{
+    string s;
+
+    if (op.code != 0) {
+        return replyError(op.hasId ? &op.id : NULL, op.code, op.error);
+    }
+
+    s = "{\"jsonrpc\":\"2.0\",\"id\":";
+    s += op.id.toString();
+    s += ",\"result\":";
+    s += result;
+    s += "}";
+
+    return s;
+}
+
+string RpcServer::replyError(const JsonValue *id, int code,
+                             const string &message)
+{
+    string s;
+
+    s = "{\"jsonrpc\":\"2.0\",\"id\":";
+    s += (id != NULL) ? id->toString() : "null";
+    s += ",\"error\":{\"code\":";
+    s += to_string(code);
+    s += ",\"message\":";
+    s += JsonValue::quote(message);
+    s += "}}";
+
+    return s;
+}
+
+string RpcServer::handle(const string &line)
+{
+    JsonValue request;
+    string error;
+    vector<Op> ops;
+    vector<string> results;
+    bool isBatch, aborted = false;
+    string out;
+    unsigned int replies = 0;
+
+    if (!JsonValue::parse(line, request, error)) {
+        return replyError(NULL, RPC_PARSE_ERROR, error);
+    }
+
+    isBatch = request.isArray();
+    if (isBatch) {
+        if (request.array.empty()) {
+            return replyError(NULL, RPC_INVALID_REQUEST, "empty batch");
+        }
+        ops.resize(request.array.size());
+        for (size_t i = 0; i < request.array.size(); i++) {
+            prepare(request.array[i], ops[i]);
+        }
+    } else {
+        ops.resize(1);
+        prepare(request, ops[0]);
+    }
+
+    // The batch is one unit: if anything is invalid nothing is applied
+    for (size_t i = 0; i < ops.size(); i++) {
+        if (ops[i].code != 0) {
+            aborted = true;
+        }
+    }
+
+    results.resize(ops.size());
+    if (aborted) {
+        for (size_t i = 0; i < ops.size(); i++) {
+            if (ops[i].code == 0) {
+                ops[i].code = RPC_BATCH_ABORTED;
+                ops[i].error = "batch aborted";
+            }
+        }
+    } else {
+        meshpump->beginBatch();
+        for (size_t i = 0; i < ops.size(); i++) {
+            results[i] = apply(ops[i]);
+        }
+        meshpump->commitBatch();
+    }
+
+    for (size_t i = 0; i < ops.size(); i++) {
+        // Notifications get no reply unless they failed
+        if (!ops[i].hasId && (ops[i].code == 0)) {
+            continue;
+        }
+
+        if (replies > 0) {
+            out += ",";
+        }
+        out += reply(ops[i], results[i]);
+        replies++;
+    }
+
+    if (isBatch && (replies > 0)) {
+        out = "[" + out + "]";
+    }
+
+    return out;
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
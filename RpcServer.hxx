@@ -0,0 +1,106 @@
+/*
+ * RpcServer.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef RPCSERVER_HXX
+#define RPCSERVER_HXX
+
+#include <stdint.h>
+#include <memory>
+#include <thread>
+#include <string>
+#include <vector>
+#include <Json.hxx>
+#include <Heartbeat.hxx>
+
+#define RPC_MAX_CONNECTIONS  8
+#define RPC_MAX_LINE         65536
+
+/* JSON-RPC 2.0 error codes */
+#define RPC_PARSE_ERROR       -32700
+#define RPC_INVALID_REQUEST   -32600
+#define RPC_METHOD_NOT_FOUND  -32601
+#define RPC_INVALID_PARAMS    -32602
+#define RPC_OUT_OF_RANGE      -32000
+#define RPC_BATCH_ABORTED     -32001
+
+using namespace std;
+
+/*
+ * Newline-delimited JSON-RPC 2.0 control API. Each line is one request
+ * or a batch (array) of requests; a batch is validated as a whole and
+ * then applied as one relay/LED update.
+ */
+class RpcServer {
+
+public:
+
+    RpcServer();
+    ~RpcServer();
+
+    bool bindPort(uint16_t port);
+    void detach(void);
+    void join(void);
+
+    string handle(const string &line);
+
+private:
+
+    struct Op {
+        enum {
+            STATUS,
+            RELAY,
+            CUTOFF,
+            LED,
+            LED_CLEAR,
+            LED_WELCOME,
+        } kind;
+        JsonValue id;
+        bool hasId;
+        int code;
+        string error;
+        unsigned int index;
+        unsigned int chain;
+        bool onOff;
+        unsigned int seconds;
+        unsigned int onTime;
+        string text;
+        unsigned int ttl;
+    };
+
+    struct Connection {
+        int fd;
+        string in;
+    };
+
+    static void *thread_func(void *);
+    void run(void);
+    void serve(Connection &conn, bool &closing);
+
+    void prepare(const JsonValue &request, Op &op) const;
+    string apply(const Op &op);
+    static string reply(const Op &op, const string &result);
+    static string replyError(const JsonValue *id, int code,
+                             const string &message);
+
+    int _fd;
+    bool _running;
+    shared_ptr<thread> _thread;
+    Heartbeat _heartbeat;
+    vector<Connection> _connections;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
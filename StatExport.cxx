@@ -0,0 +1,188 @@
+/*
+ * StatExport.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <cstring>
+#include <ctime>
+#include <MeshPump.hxx>
+#include <LedMatrix.hxx>
+#include <StatusModel.hxx>
+#include <MeshPumpShell.hxx>
+#include <StatExport.hxx>
+#include <Logger.hxx>
+
+extern shared_ptr<MeshPump> meshpump;
+extern shared_ptr<LedMatrix> ledMatrix;
+
+StatExport::StatExport()
+    : _fd(-1),
+      _stat(NULL)
+{
+
+}
+
+StatExport::~StatExport()
+{
+    close();
+}
+
+bool StatExport::open(const char *name)
+{
+    bool result = false;
+    void *addr;
+
+    if (_stat != NULL) {
+        result = true;
+        goto done;
+    }
+
+    _fd = shm_open(name, O_CREAT | O_RDWR, 0644);
+    if (_fd == -1) {
+        Logger::get().error(Logger::CAT_SYSTEM, "shm_open %s: %s", name,
+                            strerror(errno));
+        goto done;
+    }
+
+    if (ftruncate(_fd, sizeof(struct meshpump_stat)) == -1) {
+        Logger::get().error(Logger::CAT_SYSTEM, "ftruncate: %s",
+                            strerror(errno));
+        goto done;
+    }
+
+    addr = mmap(NULL, sizeof(struct meshpump_stat),
+                PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0);
+    if (addr == MAP_FAILED) {
+        Logger::get().error(Logger::CAT_SYSTEM, "mmap: %s", strerror(errno));
+        goto done;
+    }
+
+    _name = name;
+    _stat = (struct meshpump_stat *) addr;
+
+    _mutex.lock();
+    // A leftover segment from a process that died mid-update has an odd
+    // sequence number, which would invert the parity for good
+    __atomic_store_n(&_stat->seq, 0, __ATOMIC_RELEASE);
+    meshpump_stat_write_begin(_stat);
+    _stat->magic = MESHPUMP_STAT_MAGIC;
+    _stat->version = MESHPUMP_STAT_VERSION;
+    _stat->pid = getpid();
+    stamp();
+    meshpump_stat_write_end(_stat);
+    _mutex.unlock();
+
+    result = true;
+
+done:
+
+    if ((result == false) && (_fd != -1)) {
+        ::close(_fd);
+        _fd = -1;
+    }
+
+    return result;
+}
+
+void StatExport::close(void)
+{
+    if (_stat != NULL) {
+        munmap(_stat, sizeof(struct meshpump_stat));
+        _stat = NULL;
+        shm_unlink(_name.c_str());
+    }
+
+    if (_fd != -1) {
+        ::close(_fd);
+        _fd = -1;
+    }
+}
+
+void StatExport::stamp(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_REALTIME, &ts);
+    _stat->updated = ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+    _stat->publishes++;
+}
+
+void StatExport::publish(const StatusSnapshot &state,
+                         unsigned long generation)
+{
+    if (_stat == NULL) {
+        return;
+    }
+
+    _mutex.lock();
+    meshpump_stat_write_begin(_stat);
+    _stat->generation = generation;
+    _stat->relay_count = 0;
+    for (unsigned int i = 0;
+         (i < state.relays.size()) && (i < MESHPUMP_STAT_RELAYS); i++) {
+        strncpy(_stat->relays[i].name, state.relays[i].name.c_str(),
+                MESHPUMP_STAT_NAME_LEN - 1);
+        _stat->relays[i].name[MESHPUMP_STAT_NAME_LEN - 1] = '\0';
+        _stat->relays[i].on = state.relays[i].on;
+        _stat->relays[i].cutoff = state.relays[i].cutoffSec;
+        _stat->relay_count = i + 1;
+    }
+    _stat->cpu_temp = state.cpuTempC;
+    for (unsigned int y = 0;
+         (y < MAX7219_Y_COUNT) && (y < MESHPUMP_STAT_ROWS); y++) {
+        strncpy(_stat->led_text[y], state.ledText[y].c_str(),
+                MESHPUMP_STAT_TEXT_LEN - 1);
+        _stat->led_text[y][MESHPUMP_STAT_TEXT_LEN - 1] = '\0';
+    }
+    stamp();
+    meshpump_stat_write_end(_stat);
+    _mutex.unlock();
+}
+
+void StatExport::tick(void)
+{
+    unsigned long commands, fragments, writes, bytes;
+    unsigned long allowed = 0, coalesced = 0, dropped = 0;
+
+    if (_stat == NULL) {
+        return;
+    }
+
+    MeshPumpShell::getOutputStats(commands, fragments, writes, bytes);
+    if (meshpump) {
+        meshpump->getChatStats(allowed, coalesced, dropped);
+    }
+
+    _mutex.lock();
+    meshpump_stat_write_begin(_stat);
+    if (ledMatrix) {
+        for (unsigned int y = 0;
+             (y < MAX7219_Y_COUNT) && (y < MESHPUMP_STAT_ROWS); y++) {
+            _stat->led_ttl[y] = ledMatrix->ttl(y);
+        }
+    }
+    _stat->shell_commands = commands;
+    _stat->shell_writes = writes;
+    _stat->shell_bytes = bytes;
+    _stat->chat_allowed = allowed;
+    _stat->chat_coalesced = coalesced;
+    _stat->chat_dropped = dropped;
+    stamp();
+    meshpump_stat_write_end(_stat);
+    _mutex.unlock();
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,52 @@
+/*
+ * StatExport.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef STATEXPORT_HXX
+#define STATEXPORT_HXX
+
+#include <mutex>
+#include <string>
+#include <meshpump_stat.h>
+
+using namespace std;
+
+struct StatusSnapshot;
+
+class StatExport {
+
+public:
+
+    StatExport();
+    ~StatExport();
+
+    bool open(const char *name = MESHPUMP_STAT_SHM_NAME);
+    void close(void);
+
+    void publish(const StatusSnapshot &state, unsigned long generation);
+    void tick(void);
+
+private:
+
+    void stamp(void);
+
+    string _name;
+    int _fd;
+    struct meshpump_stat *_stat;
+    mutex _mutex;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,214 @@
+/*
+ * StatusModel.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <sstream>
+#include <iomanip>
+#include <Json.hxx>
+#include <StatExport.hxx>
+#include <StatusModel.hxx>
+
+extern shared_ptr<StatExport> statExport;
+
+StatusModel::StatusModel()
+    : _generation(1),
+      _state()
+{
+
+}
+
+StatusModel::~StatusModel()
+{
+
+}
+
+unsigned long StatusModel::generation(void) const
+{
+    return _generation;
+}
+
+void StatusModel::bump(void)
+{
+    _generation++;
+}
+
+void StatusModel::changed(void)
+{
+    bump();
+    if (statExport) {
+        statExport->publish(_state, _generation);
+    }
+}
+
+void StatusModel::setRelay(unsigned int index, const string &name,
+                           bool onOff, unsigned int cutoffSec)
+{
+    RelayStatus *relay;
+
+    _mutex.lock();
+    if (index >= _state.relays.size()) {
+        _state.relays.resize(index + 1);
+    }
+    relay = &_state.relays[index];
+    if ((relay->name != name) || (relay->on != onOff) ||
+        (relay->cutoffSec != cutoffSec)) {
+        relay->name = name;
+        relay->on = onOff;
+        relay->cutoffSec = cutoffSec;
+        changed();
+    }
+    _mutex.unlock();
+}
+
+void StatusModel::setCpuTempC(float tempC)
+{
+    _mutex.lock();
+    // Only a change visible at the rendered precision is a new generation
+    if (lround(_state.cpuTempC * 10.0) != lround(tempC * 10.0)) {
+        _state.cpuTempC = tempC;
+        changed();
+    }
+    _mutex.unlock();
+}
+
+void StatusModel::setLedText(unsigned int y, const char *text)
+{
+    if (y >= MAX7219_Y_COUNT) {
+        return;
+    }
+
+    _mutex.lock();
+    if (_state.ledText[y] != text) {
+        _state.ledText[y] = text;
+        changed();
+    }
+    _mutex.unlock();
+}
+
+void StatusModel::setRuntime(const string &summary)
+{
+    _mutex.lock();
+    if (_state.runtime != summary) {
+        _state.runtime = summary;
+        changed();
+    }
+    _mutex.unlock();
+}
+
+/*
+ * The temperature as last sampled, without touching the hardware.
+ */
+float StatusModel::cpuTempC(void) const
+{
+    float tempC;
+
+    _mutex.lock();
+    tempC = _state.cpuTempC;
+    _mutex.unlock();
+
+    return tempC;
+}
+
+void StatusModel::snapshot(StatusSnapshot &state) const
+{
+    _mutex.lock();
+    state = _state;
+    _mutex.unlock();
+}
+
+shared_ptr<const StatusViews> StatusModel::views(void)
+{
+    shared_ptr<const StatusViews> views;
+
+    _mutex.lock();
+    if ((_views == NULL) || (_views->generation != _generation)) {
+        shared_ptr<StatusViews> fresh = make_shared<StatusViews>();
+        fresh->generation = _generation;
+        render(*fresh);
+        _views = fresh;
+    }
+    views = _views;
+    _mutex.unlock();
+
+    return views;
+}
+
+void StatusModel::render(StatusViews &views) const
+{
+    stringstream ss;
+    char buf[64];
+
+    for (vector<RelayStatus>::const_iterator it = _state.relays.begin();
+         it != _state.relays.end(); it++) {
+        ss << it->name << ": " << (it->on ? "on" : "off") << endl;
+    }
+    for (vector<RelayStatus>::const_iterator it = _state.relays.begin();
+         it != _state.relays.end(); it++) {
+        if (it->cutoffSec > 0) {
+            ss << it->name << " auto cutoff: " << it->cutoffSec
+               << " seconds" << endl;
+        }
+    }
+    views.pump = ss.str();
+    views.status = views.pump;
+    views.status += _state.runtime;
+    if (!views.status.empty() &&
+        (views.status[views.status.size() - 1] == '\n')) {
+        views.status.erase(views.status.size() - 1);
+    }
+
+    ss.str("");
+    ss << "cpu temperature: " << setprecision(3) << _state.cpuTempC;
+    views.env = ss.str();
+
+    views.lighting = "";
+    for (vector<RelayStatus>::const_iterator it = _state.relays.begin();
+         it != _state.relays.end(); it++) {
+        if (it->name == "lighting") {
+            views.lighting = string("lighting: ") +
+                (it->on ? "on" : "off") + "\n";
+        }
+    }
+
+    snprintf(buf, sizeof(buf), "CPU temp: %.1fC\n", _state.cpuTempC);
+    views.system = views.pump + buf;
+
+    ss.str("");
+    ss << "{\"generation\":" << views.generation;
+    ss << ",\"relays\":{";
+    for (vector<RelayStatus>::const_iterator it = _state.relays.begin();
+         it != _state.relays.end(); it++) {
+        if (it != _state.relays.begin()) {
+            ss << ",";
+        }
+        ss << JsonValue::quote(it->name) << ":{\"on\":"
+           << (it->on ? "true" : "false")
+           << ",\"cutoff\":" << it->cutoffSec << "}";
+    }
+    ss << "}";
+    snprintf(buf, sizeof(buf), "%.1f", _state.cpuTempC);
+    ss << ",\"cpu_temp\":" << buf;
+    ss << ",\"led\":[";
+    for (unsigned int y = 0; y < MAX7219_Y_COUNT; y++) {
+        if (y > 0) {
+            ss << ",";
+        }
+        ss << JsonValue::quote(_state.ledText[y]);
+    }
+    ss << "]}";
+    views.json = ss.str();
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,93 @@
+/*
+ * StatusModel.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef STATUSMODEL_HXX
+#define STATUSMODEL_HXX
+
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <string>
+#include <vector>
+#include <LedMatrix.hxx>
+
+using namespace std;
+
+struct RelayStatus {
+    string name;
+    bool on;
+    unsigned int cutoffSec;
+};
+
+/*
+ * The state that the status views are rendered from.
+ */
+struct StatusSnapshot {
+    vector<RelayStatus> relays;  // In relay table order
+    float cpuTempC;
+    string ledText[MAX7219_Y_COUNT];
+    string runtime;              // Run lines, settled once a minute
+};
+
+/*
+ * Rendered views of the status, all built from the same generation.
+ */
+struct StatusViews {
+    unsigned long generation;
+    string status;      // chat 'status'
+    string env;         // chat 'env' (meshpump part)
+    string pump;        // shell 'pump'
+    string lighting;    // shell 'lighting'
+    string system;      // shell 'system' (meshpump part)
+    string json;
+};
+
+class StatusModel {
+
+public:
+
+    StatusModel();
+    ~StatusModel();
+
+    unsigned long generation(void) const;
+    void bump(void);
+
+    void setRelay(unsigned int index, const string &name, bool onOff,
+                  unsigned int cutoffSec);
+    void setCpuTempC(float tempC);
+    void setLedText(unsigned int y, const char *text);
+    void setRuntime(const string &summary);
+
+    float cpuTempC(void) const;
+
+    shared_ptr<const StatusViews> views(void);
+    void snapshot(StatusSnapshot &state) const;
+
+private:
+
+    void changed(void);
+    void render(StatusViews &views) const;
+
+    mutable mutex _mutex;
+    atomic<unsigned long> _generation;
+
+    StatusSnapshot _state;
+
+    shared_ptr<const StatusViews> _views;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
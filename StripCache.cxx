@@ -0,0 +1,130 @@
+/*
+ * StripCache.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <string.h>
+#include <GlyphAtlas.hxx>
+#include <StripCache.hxx>
+
+LedStrip::LedStrip()
+    : _length(0)
+{
+
+}
+
+LedStrip::LedStrip(const string &text)
+{
+    assign(text.data(), text.size());
+}
+
+/*
+ * Text past LED_MAX_TEXT is cut, as a row would.
+ */
+void LedStrip::assign(const char *text, size_t len)
+{
+    const GlyphAtlas &atlas = GlyphAtlas::get();
+    Glyph glyphs[LED_MAX_TEXT];
+
+    _text.assign(text, len);
+    _length = atlas.decode(_text.c_str(), _text.size(), glyphs);
+    for (unsigned int i = 0; i < _length; i++) {
+        memcpy(&_bitmaps[i * 8], atlas.bitmap(glyphs[i]), 8);
+    }
+}
+
+const char *LedStrip::text(void) const
+{
+    return _text.c_str();
+}
+
+unsigned int LedStrip::length(void) const
+{
+    return _length;
+}
+
+/*
+ * Past either end of the strip is blank.
+ */
+const uint8_t *LedStrip::bitmap(int i) const
+{
+    if ((i < 0) || (i >= (int) _length)) {
+        return GlyphAtlas::get().bitmap(GLYPH_SPACE);
+    }
+
+    return &_bitmaps[i * 8];
+}
+
+/*
+ * Never destroyed, so that the signs can still show text from the
+ * cleanup at exit.
+ */
+StripCache &StripCache::get(void)
+{
+    static StripCache *cache = new StripCache;
+
+    return *cache;
+}
+
+StripCache::StripCache()
+    : _hits(0),
+      _misses(0)
+{
+
+}
+
+shared_ptr<const LedStrip> StripCache::lookup(const string &text)
+{
+    unordered_map<string, Lru::iterator>::iterator it;
+    shared_ptr<const LedStrip> strip;
+
+    _mutex.lock();
+    it = _index.find(text);
+    if (it != _index.end()) {
+        _lru.splice(_lru.begin(), _lru, it->second);
+        strip = *it->second;
+        _hits++;
+        _mutex.unlock();
+        return strip;
+    }
+    _misses++;
+    _mutex.unlock();
+
+    // Rendered outside the lock; a racing miss on the same text just
+    // renders it twice
+    strip = make_shared<const LedStrip>(text);
+
+    _mutex.lock();
+    if (_index.find(text) == _index.end()) {
+        if (_lru.size() >= STRIP_CACHE_ENTRIES) {
+            _index.erase(_lru.back()->text());
+            _lru.pop_back();
+        }
+        _lru.push_front(strip);
+        _index[text] = _lru.begin();
+    }
+    _mutex.unlock();
+
+    return strip;
+}
+
+void StripCache::getStats(unsigned int &entries, unsigned long &hits,
+                          unsigned long &misses) const
+{
+    _mutex.lock();
+    entries = _lru.size();
+    hits = _hits;
+    misses = _misses;
+    _mutex.unlock();
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,91 @@
+/*
+ * StripCache.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef STRIPCACHE_HXX
+#define STRIPCACHE_HXX
+
+#include <stdint.h>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <LedText.hxx>
+
+#define STRIP_CACHE_ENTRIES  32
+
+using namespace std;
+
+/*
+ * A string rendered once into the bitmaps of its glyphs, eight bytes
+ * each, in panel order. Text and bitmaps are inline and sized for
+ * LED_MAX_TEXT, so rendering into a strip again never allocates. A
+ * shared strip is immutable once built, so rows and layers share those
+ * freely.
+ */
+class LedStrip {
+
+public:
+
+    LedStrip();
+    LedStrip(const string &text);
+
+    void assign(const char *text, size_t len);
+    const char *text(void) const;
+    unsigned int length(void) const;
+    const uint8_t *bitmap(int i) const;
+
+private:
+
+    LedText _text;
+    unsigned int _length;        // In glyphs
+    uint8_t _bitmaps[LED_MAX_TEXT * 8];
+
+};
+
+/*
+ * Least-recently-used cache of rendered strips, keyed by text and
+ * shared by every row of every chain; the short strings that are shown
+ * again and again (relay states, welcome texts) are rendered once.
+ */
+class StripCache {
+
+public:
+
+    static StripCache &get(void);
+
+    shared_ptr<const LedStrip> lookup(const string &text);
+
+    void getStats(unsigned int &entries, unsigned long &hits,
+                  unsigned long &misses) const;
+
+private:
+
+    StripCache();
+
+    typedef list<shared_ptr<const LedStrip> > Lru;
+
+    mutable mutex _mutex;
+    Lru _lru;                    // Most recently used first
+    unordered_map<string, Lru::iterator> _index;
+
+    unsigned long _hits;
+    unsigned long _misses;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,305 @@
+/*
+ * Supervisor.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <unistd.h>
+#include <poll.h>
+#include <signal.h>
+#include <pthread.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+#include <Supervisor.hxx>
+#include <Heartbeat.hxx>
+#include <Watchdog.hxx>
+#include <Clock.hxx>
+#include <Logger.hxx>
+
+static void supervisedSignals(sigset_t *set)
+{
+    sigemptyset(set);
+    sigaddset(set, SIGINT);
+    sigaddset(set, SIGTERM);
+    sigaddset(set, SIGHUP);
+    sigaddset(set, SIGALRM);
+}
+
+Supervisor::Supervisor()
+    : _sfd(-1),
+      _tfd(-1),
+      _efd(-1),
+      _stop(NULL),
+      _join(NULL),
+      _tick(NULL),
+      _shutdownTimeout(SUPERVISOR_SHUTDOWN_TIMEOUT),
+      _shuttingDown(false),
+      _shutdownDeadline(0),
+      _requested(false),
+      _joined(false),
+      _joiner(NULL)
+{
+
+}
+
+Supervisor::~Supervisor()
+{
+    if (_joiner != NULL) {
+        if (_joiner->joinable()) {
+            _joiner->join();
+        }
+    }
+
+    if (_sfd != -1) {
+        close(_sfd);
+    }
+    if (_tfd != -1) {
+        close(_tfd);
+    }
+    if (_efd != -1) {
+        close(_efd);
+    }
+}
+
+/*
+ * Must be called before any thread is created, so that every thread
+ * inherits the mask and the signals can only be consumed by the
+ * signalfd.
+ */
+void Supervisor::blockSignals(void)
+{
+    sigset_t set;
+
+    supervisedSignals(&set);
+    pthread_sigmask(SIG_BLOCK, &set, NULL);
+}
+
+bool Supervisor::open(void)
+{
+    bool result = false;
+    sigset_t set;
+    struct itimerspec its;
+
+    supervisedSignals(&set);
+    _sfd = signalfd(-1, &set, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (_sfd == -1) {
+        Logger::get().error(Logger::CAT_SYSTEM, "signalfd: %s",
+                            strerror(errno));
+        goto done;
+    }
+
+    _tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (_tfd == -1) {
+        Logger::get().error(Logger::CAT_SYSTEM, "timerfd_create: %s",
+                            strerror(errno));
+        goto done;
+    }
+
+    memset(&its, 0, sizeof(its));
+    its.it_value.tv_sec = SUPERVISOR_TICK_MS / 1000;
+    its.it_value.tv_nsec = (SUPERVISOR_TICK_MS % 1000) * 1000000;
+    its.it_interval = its.it_value;
+    if (timerfd_settime(_tfd, 0, &its, NULL) == -1) {
+        Logger::get().error(Logger::CAT_SYSTEM, "timerfd_settime: %s",
+                            strerror(errno));
+        goto done;
+    }
+
+    _efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (_efd == -1) {
+        Logger::get().error(Logger::CAT_SYSTEM, "eventfd: %s",
+                            strerror(errno));
+        goto done;
+    }
+
+    result = true;
+
+done:
+
+    return result;
+}
+
+void Supervisor::setStopAction(Action action)
+{
+    _stop = action;
+}
+
+void Supervisor::setJoinAction(Action action)
+{
+    _join = action;
+}
+
+/*
+ * Runs on the main thread once per tick until shutdown begins.
+ */
+void Supervisor::setTickAction(Action action)
+{
+    _tick = action;
+}
+
+void Supervisor::setShutdownTimeout(unsigned int seconds)
+{
+    _shutdownTimeout = seconds;
+}
+
+/*
+ * Safe to call from any thread.
+ */
+void Supervisor::requestShutdown(void)
+{
+    _requested = true;
+    wake();
+}
+
+void Supervisor::wake(void)
+{
+    uint64_t one = 1;
+
+    if (write(_efd, &one, sizeof(one)) != sizeof(one)) {
+        // The counter saturating still leaves the eventfd readable
+    }
+}
+
+/*
+ * Returns 0 once every thread has been joined, or -1 if the shutdown
+ * did not complete within the timeout; the caller must then exit
+ * without running destructors for the threads that are still stuck.
+ */
+int Supervisor::run(void)
+{
+    int ret = -1;
+    struct pollfd fds[3];
+    struct signalfd_siginfo info;
+    uint64_t value;
+
+    fds[0].fd = _sfd;
+    fds[0].events = POLLIN;
+    fds[1].fd = _tfd;
+    fds[1].events = POLLIN;
+    fds[2].fd = _efd;
+    fds[2].events = POLLIN;
+
+    for (;;) {
+        if (poll(fds, 3, -1) == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            Logger::get().error(Logger::CAT_SYSTEM, "poll: %s",
+                                strerror(errno));
+            beginShutdown("poll failure");
+            continue;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            while (read(_sfd, &info, sizeof(info)) == sizeof(info)) {
+                handleSignal(info.ssi_signo);
+            }
+        }
+
+        if (fds[2].revents & POLLIN) {
+            if (read(_efd, &value, sizeof(value)) != sizeof(value)) {
+                value = 0;
+            }
+            if (_joined) {
+                _joiner->join();
+                _joiner = NULL;
+                ret = 0;
+                break;
+            }
+            if (_requested) {
+                beginShutdown("request");
+            }
+        }
+
+        if (fds[1].revents & POLLIN) {
+            if (read(_tfd, &value, sizeof(value)) != sizeof(value)) {
+                value = 0;
+            }
+            Watchdog::get().check();
+            if (_tick && !_shuttingDown) {
+                _tick();
+            }
+            if (_shuttingDown && (Heartbeat::nowMs() >= _shutdownDeadline)) {
+                Logger::get().error(Logger::CAT_SYSTEM,
+                                    "shutdown timed out after %us",
+                                    _shutdownTimeout);
+                ret = -1;
+                break;
+            }
+        }
+    }
+
+    return ret;
+}
+
+void Supervisor::handleSignal(uint32_t signo)
+{
+    switch (signo) {
+    case SIGINT:
+        beginShutdown("SIGINT");
+        break;
+    case SIGTERM:
+        beginShutdown("SIGTERM");
+        break;
+    case SIGHUP:
+        Logger::get().info(Logger::CAT_SYSTEM, "SIGHUP: reopening log");
+        Logger::get().reopen();
+        break;
+    case SIGALRM:
+        Clock::get()->deliverAlarm();
+        break;
+    default:
+        break;
+    }
+}
+
+/*
+ * Stops every subsystem, then joins them on a helper thread so that the
+ * loop keeps running and can give up once the deadline passes.
+ */
+void Supervisor::beginShutdown(const char *reason)
+{
+    if (_shuttingDown) {
+        Logger::get().info(Logger::CAT_SYSTEM, "%s: already shutting down",
+                           reason);
+        return;
+    }
+
+    Logger::get().info(Logger::CAT_SYSTEM, "%s: shutting down", reason);
+    Watchdog::notify("STOPPING=1");
+    _shuttingDown = true;
+    _shutdownDeadline = Heartbeat::nowMs() + (_shutdownTimeout * 1000ULL);
+
+    if (_stop) {
+        _stop();
+    }
+
+    _joiner = make_shared<thread>(Supervisor::join_func, this);
+}
+
+void *Supervisor::join_func(void *args)
+{
+    Supervisor *supervisor = (Supervisor *) args;
+
+    if (supervisor->_join) {
+        supervisor->_join();
+    }
+    supervisor->_joined = true;
+    supervisor->wake();
+
+    return NULL;
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,80 @@
+/*
+ * Supervisor.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef SUPERVISOR_HXX
+#define SUPERVISOR_HXX
+
+#include <stdint.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+
+#define SUPERVISOR_TICK_MS           1000
+#define SUPERVISOR_SHUTDOWN_TIMEOUT  5
+
+using namespace std;
+
+/*
+ * The main thread's event loop. SIGINT, SIGTERM, SIGHUP and SIGALRM are
+ * blocked in every thread and read from a signalfd, so they are handled
+ * here synchronously rather than in signal context. A timerfd ticks
+ * the watchdog and the periodic work, and bounds the shutdown; an eventfd lets other
+ * threads request a shutdown and reports when all threads are joined.
+ */
+class Supervisor {
+
+public:
+
+    typedef void (*Action)(void);
+
+    Supervisor();
+    ~Supervisor();
+
+    static void blockSignals(void);
+
+    bool open(void);
+    void setStopAction(Action action);
+    void setJoinAction(Action action);
+    void setTickAction(Action action);
+    void setShutdownTimeout(unsigned int seconds);
+
+    void requestShutdown(void);
+    int run(void);
+
+private:
+
+    static void *join_func(void *);
+
+    void handleSignal(uint32_t signo);
+    void beginShutdown(const char *reason);
+    void wake(void);
+
+    int _sfd;
+    int _tfd;
+    int _efd;
+    Action _stop;
+    Action _join;
+    Action _tick;
+    unsigned int _shutdownTimeout;
+    bool _shuttingDown;
+    uint64_t _shutdownDeadline;
+    atomic<bool> _requested;
+    atomic<bool> _joined;
+    shared_ptr<thread> _joiner;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
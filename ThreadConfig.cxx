@@ -0,0 +1,228 @@
+/*
+ * ThreadConfig.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <pthread.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ThreadConfig.hxx>
+#include <AllocStats.hxx>
+#include <Logger.hxx>
+
+ThreadConfig::ThreadConfig()
+{
+    for (unsigned int i = 0; i < ROLE_COUNT; i++) {
+        _placements[i].configured = false;
+        CPU_ZERO(&_placements[i].cpus);
+        _placements[i].policy = SCHED_OTHER;
+        _placements[i].priority = 0;
+    }
+}
+
+ThreadConfig &ThreadConfig::get(void)
+{
+    static ThreadConfig config;
+
+    return config;
+}
+
+const char *ThreadConfig::roleName(Role role)
+{
+    static const char *names[ROLE_COUNT] = {
+        "main",
+        "render",
+        "mesh",
+        "shell",
+        "rpc",
+    };
+
+    if (role >= ROLE_COUNT) {
+        return "?";
+    }
+
+    return names[role];
+}
+
+/*
+ * Parses a CPU list such as "3" or "0-1,3"; an empty list means all CPUs.
+ */
+bool ThreadConfig::parseCpus(const string &s, cpu_set_t &cpus)
+{
+    const char *p = s.c_str();
+    char *endp;
+    long first, last;
+    long ncpus = sysconf(_SC_NPROCESSORS_CONF);
+
+    CPU_ZERO(&cpus);
+
+    if (s.empty()) {
+        for (long i = 0; i < ncpus; i++) {
+            CPU_SET(i, &cpus);
+        }
+        return true;
+    }
+
+    while (*p != '\0') {
+        first = strtol(p, &endp, 10);
+        if ((endp == p) || (first < 0) || (first >= ncpus)) {
+            return false;
+        }
+        p = endp;
+        last = first;
+        if (*p == '-') {
+            p++;
+            last = strtol(p, &endp, 10);
+            if ((endp == p) || (last < first) || (last >= ncpus)) {
+                return false;
+            }
+            p = endp;
+        }
+        for (long i = first; i <= last; i++) {
+            CPU_SET(i, &cpus);
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p != '\0') {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+bool ThreadConfig::configure(Role role, const string &cpus,
+                             const string &policy, int priority,
+                             string &error)
+{
+    Placement placement;
+
+    if (role >= ROLE_COUNT) {
+        error = "invalid role";
+        return false;
+    }
+
+    if (!parseCpus(cpus, placement.cpus)) {
+        error = "invalid cpus '" + cpus + "'";
+        return false;
+    }
+
+    if (policy.empty() || (policy == "other")) {
+        placement.policy = SCHED_OTHER;
+        priority = 0;
+    } else if (policy == "fifo") {
+        placement.policy = SCHED_FIFO;
+    } else if (policy == "rr") {
+        placement.policy = SCHED_RR;
+    } else {
+        error = "invalid policy '" + policy + "'";
+        return false;
+    }
+
+    if ((priority < sched_get_priority_min(placement.policy)) ||
+        (priority > sched_get_priority_max(placement.policy))) {
+        error = "priority " + to_string(priority) + " is out of range";
+        return false;
+    }
+
+    placement.priority = priority;
+    placement.configured = true;
+    _placements[role] = placement;
+
+    return true;
+}
+
+/*
+ * Applies the role to the calling thread. An unconfigured role restores
+ * the defaults, so that nothing leaks to threads started afterwards.
+ */
+bool ThreadConfig::apply(Role role) const
+{
+    bool result = true;
+    Placement placement;
+    struct sched_param param;
+    int ret;
+
+    if (role >= ROLE_COUNT) {
+        return false;
+    }
+
+    AllocStats::setSubsystem(role);
+
+    placement = _placements[role];
+    if (!placement.configured) {
+        parseCpus("", placement.cpus);
+        placement.policy = SCHED_OTHER;
+        placement.priority = 0;
+    }
+
+    ret = pthread_setaffinity_np(pthread_self(), sizeof(placement.cpus),
+                                 &placement.cpus);
+    if (ret != 0) {
+        Logger::get().error(Logger::CAT_SYSTEM,
+                            "%s: pthread_setaffinity_np: %s",
+                            roleName(role), strerror(ret));
+        result = false;
+    }
+
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = placement.priority;
+    ret = pthread_setschedparam(pthread_self(), placement.policy, &param);
+    if (ret != 0) {
+        Logger::get().error(Logger::CAT_SYSTEM,
+                            "%s: pthread_setschedparam: %s",
+                            roleName(role), strerror(ret));
+        result = false;
+    }
+
+    return result;
+}
+
+string ThreadConfig::describe(void) const
+{
+    string s;
+    char buf[128];
+
+    for (unsigned int i = 0; i < ROLE_COUNT; i++) {
+        const Placement &placement = _placements[i];
+        string cpus;
+
+        if (!placement.configured) {
+            snprintf(buf, sizeof(buf), "%s: default\n",
+                     roleName((Role) i));
+            s += buf;
+            continue;
+        }
+
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &placement.cpus)) {
+                if (!cpus.empty()) {
+                    cpus += ",";
+                }
+                cpus += to_string(cpu);
+            }
+        }
+
+        snprintf(buf, sizeof(buf), "%s: cpus=%s policy=%s priority=%d\n",
+                 roleName((Role) i), cpus.c_str(),
+                 (placement.policy == SCHED_FIFO) ? "fifo" :
+                 (placement.policy == SCHED_RR) ? "rr" : "other",
+                 placement.priority);
+        s += buf;
+    }
+
+    return s;
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
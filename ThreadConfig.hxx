@@ -0,0 +1,69 @@
+/*
+ * ThreadConfig.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef THREADCONFIG_HXX
+#define THREADCONFIG_HXX
+
+#include <sched.h>
+#include <string>
+
+using namespace std;
+
+/*
+ * CPU affinity and scheduling policy per thread role. Our own threads
+ * apply their role when they start; threads created inside libmeshtastic
+ * inherit the role that the creating (main) thread applied just before
+ * starting them.
+ */
+class ThreadConfig {
+
+public:
+
+    enum Role {
+        ROLE_MAIN = 0,
+        ROLE_RENDER,
+        ROLE_MESH,
+        ROLE_SHELL,
+        ROLE_RPC,
+        ROLE_COUNT,
+    };
+
+    static ThreadConfig &get(void);
+    static const char *roleName(Role role);
+
+    bool configure(Role role, const string &cpus, const string &policy,
+                   int priority, string &error);
+    bool apply(Role role) const;
+    string describe(void) const;
+
+private:
+
+    struct Placement {
+        bool configured;
+        cpu_set_t cpus;
+        int policy;
+        int priority;
+    };
+
+    ThreadConfig();
+
+    static bool parseCpus(const string &s, cpu_set_t &cpus);
+
+    Placement _placements[ROLE_COUNT];
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,271 @@
+/*
+ * Watchdog.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <Watchdog.hxx>
+#include <Heartbeat.hxx>
+#include <Logger.hxx>
+
+Watchdog::Watchdog()
+    : _watchdogMs(0),
+      _lastKick(0),
+      _acceptPort(0),
+      _acceptChecked(0),
+      _acceptBeats(0),
+      _acceptWaiting(false),
+      _acceptStuck(false),
+      _healthy(true)
+{
+    const char *usec = getenv("WATCHDOG_USEC");
+    const char *pid = getenv("WATCHDOG_PID");
+
+    if ((usec != NULL) &&
+        ((pid == NULL) || (strtol(pid, NULL, 10) == getpid()))) {
+        _watchdogMs = strtoull(usec, NULL, 10) / 1000;
+    }
+}
+
+Watchdog &Watchdog::get(void)
+{
+    static Watchdog watchdog;
+
+    return watchdog;
+}
+
+/*
+ * sd_notify(3) without libsystemd: one datagram to $NOTIFY_SOCKET.
+ */
+bool Watchdog::notify(const char *state)
+{
+    bool result = false;
+    const char *path = getenv("NOTIFY_SOCKET");
+    struct sockaddr_un addr;
+    socklen_t len;
+    int fd = -1;
+
+    if ((path == NULL) || ((path[0] != '/') && (path[0] != '@')) ||
+        (strlen(path) >= sizeof(addr.sun_path))) {
+        goto done;
+    }
+
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, path, strlen(path));
+    if (addr.sun_path[0] == '@') {
+        addr.sun_path[0] = '\0';  // Abstract namespace
+    }
+    len = offsetof(struct sockaddr_un, sun_path) + strlen(path);
+
+    fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        goto done;
+    }
+
+    if (sendto(fd, state, strlen(state), MSG_NOSIGNAL,
+               (struct sockaddr *) &addr, len) == (ssize_t) strlen(state)) {
+        result = true;
+    }
+
+done:
+
+    if (fd != -1) {
+        close(fd);
+    }
+
+    return result;
+}
+
+void Watchdog::watchAccept(const string &heartbeat, uint16_t port)
+{
+    _acceptName = heartbeat;
+    _acceptPort = port;
+}
+
+void Watchdog::check(void)
+{
+    vector<Heartbeat *> heartbeats;
+    uint64_t now = Heartbeat::nowMs();
+    uint64_t age;
+    bool healthy = true;
+
+    Heartbeat::lock();
+    Heartbeat::list(heartbeats);
+    for (vector<Heartbeat *>::iterator it = heartbeats.begin();
+         it != heartbeats.end(); it++) {
+        Heartbeat *hb = *it;
+
+        if (!hb->active()) {
+            hb->stalled = false;
+            continue;
+        }
+
+        age = now - hb->last();
+        if (age > hb->timeoutMs()) {
+            healthy = false;
+            if (!hb->stalled) {
+                Logger::get().warn(Logger::CAT_SYSTEM,
+                                   "%s: no heartbeat for %lums",
+                                   hb->name(), (unsigned long) age);
+                hb->stalled = true;
+            }
+        } else if (hb->stalled) {
+            Logger::get().info(Logger::CAT_SYSTEM, "%s: recovered",
+                               hb->name());
+            hb->stalled = false;
+        }
+    }
+    Heartbeat::unlock();
+
+    if ((_acceptPort != 0) &&
+        ((now - _acceptChecked) >= WATCHDOG_SHELL_CHECK_MS)) {
+        _acceptChecked = now;
+        checkAccept();
+    }
+    if (_acceptStuck) {
+        healthy = false;
+    }
+
+    if (healthy != _healthy) {
+        Logger::get().info(Logger::CAT_SYSTEM, "watchdog: %s",
+                           healthy ? "healthy" : "withholding keep-alive");
+    }
+    _healthy = healthy;
+
+    if (healthy && (_watchdogMs > 0) &&
+        ((now - _lastKick) >= (_watchdogMs / 4))) {
+        _lastKick = now;
+        notify("WATCHDOG=1");
+    }
+}
+
+bool Watchdog::healthy(void) const
+{
+    return _healthy;
+}
+
+/*
+ * Connections completed by the kernel but not yet accepted on a
+ * listening port: the rx_queue of its LISTEN (0A) sockets in
+ * /proc/net/tcp and tcp6.
+ */
+unsigned long Watchdog::acceptQueue(uint16_t port)
+{
+    static const char *paths[] = { "/proc/net/tcp", "/proc/net/tcp6" };
+    unsigned long queued = 0;
+    unsigned long tx, rx;
+    unsigned int local, state;
+    char line[512];
+    FILE *fp;
+
+    for (unsigned int i = 0; i < sizeof(paths) / sizeof(paths[0]); i++) {
+        fp = fopen(paths[i], "r");
+        if (fp == NULL) {
+            continue;
+        }
+        while (fgets(line, sizeof(line), fp) != NULL) {
+            if ((sscanf(line, " %*u: %*[0-9A-Fa-f]:%x %*[0-9A-Fa-f]:%*x "
+                        "%x %lx:%lx", &local, &state, &tx, &rx) == 4) &&
+                (local == port) && (state == 0x0a)) {
+                queued += rx;
+            }
+        }
+        fclose(fp);
+    }
+
+    return queued;
+}
+
+/*
+ * The accept loop is stuck if connections were waiting at the last
+ * check, still are, and its heartbeat has not beaten since. Nothing
+ * connects to find out, so an idle loop costs nothing.
+ */
+void Watchdog::checkAccept(void)
+{
+    vector<Heartbeat *> heartbeats;
+    unsigned long beats = 0;
+    unsigned long queued;
+    bool stuck;
+
+    Heartbeat::lock();
+    Heartbeat::list(heartbeats);
+    for (vector<Heartbeat *>::iterator it = heartbeats.begin();
+         it != heartbeats.end(); it++) {
+        if ((*it)->name() == _acceptName) {
+            beats = (*it)->beats();
+        }
+    }
+    Heartbeat::unlock();
+
+    queued = acceptQueue(_acceptPort);
+    stuck = (queued > 0) && _acceptWaiting && (beats == _acceptBeats);
+    if (stuck && !_acceptStuck) {
+        Logger::get().warn(Logger::CAT_SYSTEM,
+                           "%s: %lu connections not accepted",
+                           _acceptName, queued);
+    } else if (!stuck && _acceptStuck) {
+        Logger::get().info(Logger::CAT_SYSTEM, "%s: recovered",
+                           _acceptName);
+    }
+    _acceptStuck = stuck;
+    _acceptWaiting = (queued > 0);
+    _acceptBeats = beats;
+}
+
+string Watchdog::report(void) const
+{
+    vector<Heartbeat *> heartbeats;
+    uint64_t now = Heartbeat::nowMs();
+    string s;
+    char buf[192];
+
+    snprintf(buf, sizeof(buf), "watchdog: %s%s\n",
+             _healthy ? "healthy" : "stalled",
+             (_watchdogMs > 0) ? "" : " (no systemd watchdog)");
+    s += buf;
+
+    Heartbeat::lock();
+    Heartbeat::list(heartbeats);
+    for (vector<Heartbeat *>::iterator it = heartbeats.begin();
+         it != heartbeats.end(); it++) {
+        Heartbeat *hb = *it;
+        const Histogram &gaps = hb->gaps();
+
+        if (!hb->active()) {
+            snprintf(buf, sizeof(buf), "%s: parked\n", hb->name().c_str());
+        } else {
+            snprintf(buf, sizeof(buf),
+                     "%s: age=%lums stalls=%lu gap p99=%.1fms "
+                     "max=%.1fms (%lu beats)\n",
+                     hb->name().c_str(),
+                     (unsigned long) (now - hb->last()),
+                     hb->stalls(),
+                     gaps.percentile(99) / 1e6, gaps.max() / 1e6,
+                     hb->beats());
+        }
+        s += buf;
+    }
+    Heartbeat::unlock();
+
+    return s;
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
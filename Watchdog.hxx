@@ -0,0 +1,68 @@
+/*
+ * Watchdog.hxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef WATCHDOG_HXX
+#define WATCHDOG_HXX
+
+#include <stdint.h>
+#include <atomic>
+#include <string>
+
+#define WATCHDOG_SHELL_CHECK_MS  30000
+
+using namespace std;
+
+/*
+ * Checks every registered Heartbeat once per supervisor tick, and keeps
+ * the systemd watchdog fed (WATCHDOG=1) only while all of them are
+ * healthy, so that a thread stuck in e.g. spi_write gets the service
+ * restarted. The shell server's accept loop belongs to libmeshtastic
+ * and blocks in accept() while idle, so its heartbeat only beats per
+ * connection; it is stuck if connections wait in its listen queue while
+ * the heartbeat stands still.
+ */
+class Watchdog {
+
+public:
+
+    static Watchdog &get(void);
+    static bool notify(const char *state);
+
+    void watchAccept(const string &heartbeat, uint16_t port);
+    void check(void);
+    bool healthy(void) const;
+    string report(void) const;
+
+private:
+
+    Watchdog();
+
+    static unsigned long acceptQueue(uint16_t port);
+    void checkAccept(void);
+
+    uint64_t _watchdogMs;
+    uint64_t _lastKick;
+    string _acceptName;
+    uint16_t _acceptPort;
+    uint64_t _acceptChecked;
+    unsigned long _acceptBeats;
+    bool _acceptWaiting;
+    bool _acceptStuck;
+    atomic<bool> _healthy;
+
+};
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,80 @@
+/*
+ * hw.h
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef HW_H
+#define HW_H
+
+/*
+ * GPIO/SPI access goes through pigpiod when USE_PIGPIO is defined. Without
+ * it, the same calls are served by an in-process simulator (HwSim.cxx)
+ * so that the daemon logic can run without the Raspberry Pi attached.
+ */
+
+#if defined(USE_PIGPIO)
+
+#include <pigpiod_if.h>
+
+#else
+
+#include <stdint.h>
+
+#define PI_INPUT                 0
+#define PI_OUTPUT                1
+
+#define PI_SPI_FLAGS_BITLEN(x)   ((x) << 16)
+#define PI_SPI_FLAGS_RX_LSB(x)   ((x) << 15)
+#define PI_SPI_FLAGS_TX_LSB(x)   ((x) << 14)
+#define PI_SPI_FLAGS_3WREN(x)    ((x) << 10)
+#define PI_SPI_FLAGS_3WIRE(x)    ((x) << 9)
+#define PI_SPI_FLAGS_AUX_SPI(x)  ((x) << 8)
+#define PI_SPI_FLAGS_RESVD(x)    ((x) << 5)
+#define PI_SPI_FLAGS_CSPOLS(x)   ((x) << 2)
+#define PI_SPI_FLAGS_MODE(x)     ((x))
+
+#define HWSIM_GPIO_COUNT         54
+#define HWSIM_SPI_CHANNELS       2
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct hwsim_stats {
+    unsigned long gpio_writes;
+    unsigned long bank_writes;
+    unsigned long spi_writes;
+    unsigned long spi_bytes;
+};
+
+extern int pigpio_start(char *addrStr, char *portStr);
+extern void pigpio_stop(void);
+extern int set_mode(unsigned gpio, unsigned mode);
+extern int gpio_read(unsigned gpio);
+extern int gpio_write(unsigned gpio, unsigned level);
+extern int set_bank_1(uint32_t bits);
+extern int clear_bank_1(uint32_t bits);
+extern int spi_open(unsigned channel, unsigned speed, unsigned flags);
+extern int spi_close(unsigned handle);
+extern int spi_write(unsigned handle, char *buf, unsigned count);
+
+extern void hwsim_get_stats(struct hwsim_stats *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,188 @@
+/*
+ * meshpump-replay.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <getopt.h>
+#include <unistd.h>
+#include <ctime>
+#include <iostream>
+#include <vector>
+#include <algorithm>
+#include <hw.h>
+#include "MeshPump.hxx"
+#include "LedMatrix.hxx"
+#include "StatusModel.hxx"
+#include "StatExport.hxx"
+#include "HistoryStore.hxx"
+#include "PacketCapture.hxx"
+#include "Clock.hxx"
+#include "LatencyTracer.hxx"
+
+shared_ptr<MeshPump> meshpump = NULL;
+shared_ptr<LedMatrix> ledMatrix = NULL;
+shared_ptr<StatusModel> statusModel = NULL;
+shared_ptr<StatExport> statExport = NULL;
+shared_ptr<HistoryStore> historyStore = NULL;
+
+static const struct option long_options[] = {
+    { "fast", no_argument, NULL, 'f', },
+    { "verbose", no_argument, NULL, 'v', },
+    { NULL, 0, NULL, 0, },
+};
+
+static uint64_t monotonicNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static uint64_t percentile(const vector<uint64_t> &sorted, unsigned int p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+
+    return sorted[((sorted.size() - 1) * p) / 100];
+}
+
+int main(int argc, char **argv)
+{
+    PacketCapture capture;
+    bool fast = false;
+    bool verbose = false;
+    meshtastic_MeshPacket packet;
+    string message;
+    uint64_t timestamp, first = 0, start, t0, t1, elapsed;
+    vector<uint64_t> latencies;
+    shared_ptr<SimClock> simClock;
+    struct hwsim_stats hwstats;
+    shared_ptr<const StatusViews> views;
+    StatusSnapshot state;
+
+    for (;;) {
+        int option_index = 0;
+        int c = getopt_long(argc, argv, "fv", long_options, &option_index);
+        if (c == -1) {
+            break;
+        }
+
+        switch (c) {
+        case 'f':
+            fast = true;
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            fprintf(stderr, "Unrecognized argument specified!\n");
+            exit(EXIT_FAILURE);
+            break;
+        }
+    }
+
+    if (optind >= argc) {
+        cerr << "usage: meshpump-replay [--fast] [--verbose] <capture>"
+             << endl;
+        exit(EXIT_FAILURE);
+    }
+
+    if (capture.openRead(argv[optind]) == false) {
+        exit(EXIT_FAILURE);
+    }
+
+    if (fast) {
+        // Run on simulated time that follows the capture timestamps, so
+        // that cutoffs, TTLs and rate limiting behave as in the field
+        simClock = make_shared<SimClock>(time(NULL));
+        Clock::set(simClock);
+    }
+
+    statusModel = make_shared<StatusModel>();
+    ledMatrix = make_shared<LedMatrix>();
+    ledMatrix->start();
+    meshpump = make_shared<MeshPump>();
+    meshpump->setClient(meshpump);
+    meshpump->setNvm(meshpump);
+    meshpump->setVerbose(verbose);
+
+    start = monotonicNs();
+    while (capture.read(timestamp, packet, message)) {
+        if (first == 0) {
+            first = timestamp;
+        }
+
+        if (simClock && (timestamp > first)) {
+            simClock->advanceTo(timestamp - first);
+        } else if (!fast && (timestamp > first)) {
+            uint64_t due = start + (timestamp - first);
+            uint64_t now = monotonicNs();
+            if (due > now) {
+                usleep((due - now) / 1000);
+            }
+        }
+
+        if (verbose) {
+            cout << "!" << hex << packet.from << dec << ": "
+                 << message << endl;
+        }
+
+        t0 = monotonicNs();
+        meshpump->receiveTextMessage(packet, message);
+        t1 = monotonicNs();
+        latencies.push_back(t1 - t0);
+    }
+    elapsed = monotonicNs() - start;
+
+    sort(latencies.begin(), latencies.end());
+    hwsim_get_stats(&hwstats);
+    views = statusModel->views();
+    statusModel->snapshot(state);
+
+    printf("replayed %lu packets in %.3f s (%s)\n",
+           capture.records(), elapsed / 1e9, fast ? "fast" : "1x");
+    printf("latency us: min=%.1f p50=%.1f p90=%.1f p99=%.1f max=%.1f\n",
+           percentile(latencies, 0) / 1e3,
+           percentile(latencies, 50) / 1e3,
+           percentile(latencies, 90) / 1e3,
+           percentile(latencies, 99) / 1e3,
+           percentile(latencies, 100) / 1e3);
+    if (elapsed > 0) {
+        printf("throughput: %.1f packets/s\n",
+               capture.records() / (elapsed / 1e9));
+    }
+    printf("%s", LatencyTracer::get().report().c_str());
+    printf("gpio: %lu writes, %lu bank writes\n",
+           hwstats.gpio_writes, hwstats.bank_writes);
+    printf("spi: %lu writes, %lu bytes\n",
+           hwstats.spi_writes, hwstats.spi_bytes);
+    printf("%s", views->system.c_str());
+    for (unsigned int y = 0; y < MAX7219_Y_COUNT; y++) {
+        printf("row %u: ttl=%us, text=\"%s\"\n", y, ledMatrix->ttl(y),
+               state.ledText[y].c_str());
+    }
+    printf("%s\n", views->json.c_str());
+
+    ledMatrix->stop();
+    ledMatrix->join();
+
+    // Release the relays and the sign while the simulated clock is alive
+    meshpump = NULL;
+    ledMatrix = NULL;
+
+    return 0;
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,182 @@
+/*
+ * meshpump-sim.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <getopt.h>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <hw.h>
+#include "MeshPump.hxx"
+#include "LedMatrix.hxx"
+#include "StatusModel.hxx"
+#include "StatExport.hxx"
+#include "HistoryStore.hxx"
+#include "Clock.hxx"
+
+shared_ptr<MeshPump> meshpump = NULL;
+shared_ptr<LedMatrix> ledMatrix = NULL;
+shared_ptr<StatusModel> statusModel = NULL;
+shared_ptr<StatExport> statExport = NULL;
+shared_ptr<HistoryStore> historyStore = NULL;
+
+static const struct option long_options[] = {
+    { "days", required_argument, NULL, 'd', },
+    { "verbose", no_argument, NULL, 'v', },
+    { NULL, 0, NULL, 0, },
+};
+
+static uint64_t wallNs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ((uint64_t) ts.tv_sec * 1000000000ULL) + ts.tv_nsec;
+}
+
+static void chat(uint32_t from, const char *text)
+{
+    meshtastic_MeshPacket packet;
+
+    memset(&packet, 0, sizeof(packet));
+    packet.from = from;
+    packet.to = meshpump->whoami();
+    packet.which_payload_variant = meshtastic_MeshPacket_decoded_tag;
+    packet.decoded.portnum = meshtastic_PortNum_TEXT_MESSAGE_APP;
+    packet.decoded.payload.size = strlen(text);
+    memcpy(packet.decoded.payload.bytes, text, packet.decoded.payload.size);
+
+    meshpump->receiveTextMessage(packet, text);
+}
+
+/*
+ * Simulate a stretch of days of crontab, LED TTL and up-pump cutoff
+ * behavior on a SimClock, one simulated second per step, and report how
+ * fast simulated time runs compared to real time.
+ */
+int main(int argc, char **argv)
+{
+    unsigned int days = 365;
+    bool verbose = false;
+    shared_ptr<SimClock> simClock;
+    struct tm start;
+    uint64_t seconds, s, t0, t1;
+    unsigned long lightingToggles = 0, cutoffs = 0, expiries = 0;
+    unsigned long commands = 0;
+    bool lighting, upPump;
+    int lightingRelay, upPumpRelay;
+    unsigned int ttl;
+
+    for (;;) {
+        int option_index = 0;
+        int c = getopt_long(argc, argv, "d:v", long_options, &option_index);
+        if (c == -1) {
+            break;
+        }
+
+        switch (c) {
+        case 'd':
+            days = atoi(optarg);
+            break;
+        case 'v':
+            verbose = true;
+            break;
+        default:
+            fprintf(stderr, "Unrecognized argument specified!\n");
+            exit(EXIT_FAILURE);
+            break;
+        }
+    }
+
+    memset(&start, 0, sizeof(start));
+    start.tm_year = 2026 - 1900;
+    start.tm_mon = 0;
+    start.tm_mday = 1;
+    start.tm_isdst = -1;
+    simClock = make_shared<SimClock>(mktime(&start));
+    Clock::set(simClock);
+
+    statusModel = make_shared<StatusModel>();
+    ledMatrix = make_shared<LedMatrix>();
+    meshpump = make_shared<MeshPump>();
+    meshpump->setClient(meshpump);
+    meshpump->setNvm(meshpump);
+
+    lightingRelay = meshpump->findRelay("lighting");
+    upPumpRelay = meshpump->findRelay("up-pump");
+    lighting = meshpump->isRelayOn(lightingRelay);
+    upPump = meshpump->isRelayOn(upPumpRelay);
+    ttl = ledMatrix->ttl(0);
+
+    seconds = (uint64_t) days * 86400;
+    t0 = wallNs();
+    for (s = 0; s < seconds; s++) {
+        simClock->advance(1000000000ULL);
+        ledMatrix->tick();
+
+        if ((s % 60) == 0) {
+            meshpump->runCrontab();
+        }
+
+        // Scripted traffic: the up-pump every 6 hours, a message on the
+        // sign every day at noon
+        if ((s % 21600) == 10800) {
+            chat(0x1001, "pump up on 60");
+            commands++;
+        }
+        if ((s % 86400) == 43200) {
+            chat(0x1002, "led 0 noon");
+            commands++;
+        }
+
+        if (meshpump->isRelayOn(lightingRelay) != lighting) {
+            lighting = !lighting;
+            lightingToggles++;
+            if (verbose) {
+                time_t now = simClock->wallTime();
+                printf("%.24s lighting %s\n", ctime(&now),
+                       lighting ? "on" : "off");
+            }
+        }
+        if (meshpump->isRelayOn(upPumpRelay) != upPump) {
+            upPump = !upPump;
+            if (!upPump) {
+                cutoffs++;
+            }
+        }
+        if ((ttl > 0) && (ledMatrix->ttl(0) == 0)) {
+            expiries++;
+        }
+        ttl = ledMatrix->ttl(0);
+    }
+    t1 = wallNs();
+
+    printf("simulated %u days (%llu s) in %.3f s wall\n", days,
+           (unsigned long long) seconds, (t1 - t0) / 1e9);
+    if (t1 > t0) {
+        printf("%.0f simulated-seconds per wall-second\n",
+               seconds / ((t1 - t0) / 1e9));
+    }
+    printf("commands: %lu, lighting toggles: %lu, up-pump cutoffs: %lu, "
+           "led ttl expiries: %lu\n",
+           commands, lightingToggles, cutoffs, expiries);
+
+    // Release the relays and the sign while the simulated clock is alive
+    meshpump = NULL;
+    ledMatrix = NULL;
+
+    return 0;
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
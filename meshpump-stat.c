@@ -0,0 +1,192 @@
+/*
+ * meshpump-stat.c
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <meshpump_stat.h>
+
+static const struct option long_options[] = {
+    { "interval", required_argument, NULL, 'i', },
+    { "count", required_argument, NULL, 'c', },
+    { "json", no_argument, NULL, 'j', },
+    { NULL, 0, NULL, 0, },
+};
+
+static void print_text(const struct meshpump_stat *stat)
+{
+    unsigned int i, y;
+
+    printf("generation: %llu\n", (unsigned long long) stat->generation);
+    for (i = 0; (i < stat->relay_count) && (i < MESHPUMP_STAT_RELAYS); i++) {
+        printf("%s: %s", stat->relays[i].name,
+               stat->relays[i].on ? "on" : "off");
+        if (stat->relays[i].cutoff > 0) {
+            printf(" (auto cutoff: %us)", stat->relays[i].cutoff);
+        }
+        printf("\n");
+    }
+    printf("CPU temp: %.1fC\n", stat->cpu_temp);
+    for (y = 0; y < MESHPUMP_STAT_ROWS; y++) {
+        printf("row %u: ttl=%us, text=\"%s\"\n",
+               y, stat->led_ttl[y], stat->led_text[y]);
+    }
+    printf("shell: %llu commands, %llu writes, %llu bytes\n",
+           (unsigned long long) stat->shell_commands,
+           (unsigned long long) stat->shell_writes,
+           (unsigned long long) stat->shell_bytes);
+    printf("chat: %llu allowed, %llu coalesced, %llu dropped\n",
+           (unsigned long long) stat->chat_allowed,
+           (unsigned long long) stat->chat_coalesced,
+           (unsigned long long) stat->chat_dropped);
+}
+
+static void print_json(const struct meshpump_stat *stat)
+{
+    unsigned int i, y;
+    const char *s;
+
+    printf("{\"pid\":%u,\"updated\":%llu,\"generation\":%llu,",
+           stat->pid,
+           (unsigned long long) stat->updated,
+           (unsigned long long) stat->generation);
+    printf("\"relays\":{");
+    for (i = 0; (i < stat->relay_count) && (i < MESHPUMP_STAT_RELAYS); i++) {
+        /* Relay names are restricted to [a-z0-9_-], so need no escaping */
+        printf("%s\"%s\":{\"on\":%s,\"cutoff\":%u}", i > 0 ? "," : "",
+               stat->relays[i].name,
+               stat->relays[i].on ? "true" : "false",
+               stat->relays[i].cutoff);
+    }
+    printf("},\"cpu_temp\":%.1f,\"led\":[", stat->cpu_temp);
+    for (y = 0; y < MESHPUMP_STAT_ROWS; y++) {
+        printf("%s{\"ttl\":%u,\"text\":\"", y > 0 ? "," : "",
+               stat->led_ttl[y]);
+        for (s = stat->led_text[y]; *s != '\0'; s++) {
+            if ((*s == '"') || (*s == '\\')) {
+                printf("\\%c", *s);
+            } else if ((unsigned char) *s < 0x20) {
+                printf("\\u%04x", (unsigned char) *s);
+            } else {
+                putchar(*s);
+            }
+        }
+        printf("\"}");
+    }
+    printf("],\"shell_commands\":%llu,\"shell_writes\":%llu,"
+           "\"shell_bytes\":%llu,",
+           (unsigned long long) stat->shell_commands,
+           (unsigned long long) stat->shell_writes,
+           (unsigned long long) stat->shell_bytes);
+    printf("\"chat_allowed\":%llu,\"chat_coalesced\":%llu,"
+           "\"chat_dropped\":%llu}\n",
+           (unsigned long long) stat->chat_allowed,
+           (unsigned long long) stat->chat_coalesced,
+           (unsigned long long) stat->chat_dropped);
+}
+
+int main(int argc, char **argv)
+{
+    int ret = 0;
+    int fd = -1;
+    const struct meshpump_stat *stat = MAP_FAILED;
+    struct meshpump_stat copy;
+    unsigned int interval = 0;
+    int count = 0;
+    int json = 0;
+
+    for (;;) {
+        int option_index = 0;
+        int c = getopt_long(argc, argv, "i:c:j",
+                            long_options, &option_index);
+        if (c == -1) {
+            break;
+        }
+
+        switch (c) {
+        case 'i':
+            interval = atoi(optarg);
+            break;
+        case 'c':
+            count = atoi(optarg);
+            break;
+        case 'j':
+            json = 1;
+            break;
+        default:
+            fprintf(stderr, "Unrecognized argument specified!\n");
+            exit(EXIT_FAILURE);
+            break;
+        }
+    }
+
+    if (count == 0) {
+        count = (interval > 0) ? -1 : 1;
+    }
+
+    fd = shm_open(MESHPUMP_STAT_SHM_NAME, O_RDONLY, 0);
+    if (fd == -1) {
+        fprintf(stderr, "shm_open: %s!\n", strerror(errno));
+        ret = -1;
+        goto done;
+    }
+
+    stat = (const struct meshpump_stat *)
+        mmap(NULL, sizeof(*stat), PROT_READ, MAP_SHARED, fd, 0);
+    if (stat == MAP_FAILED) {
+        fprintf(stderr, "mmap: %s!\n", strerror(errno));
+        ret = -1;
+        goto done;
+    }
+
+    while (count != 0) {
+        if (meshpump_stat_read(stat, &copy) != 0) {
+            fprintf(stderr, "meshpump is not publishing!\n");
+            ret = -1;
+            goto done;
+        }
+
+        if (json) {
+            print_json(&copy);
+        } else {
+            print_text(&copy);
+        }
+        fflush(stdout);
+
+        if (count > 0) {
+            count--;
+        }
+        if ((count != 0) && (interval > 0)) {
+            usleep(interval * 1000);
+        }
+    }
+
+done:
+
+    if (stat != MAP_FAILED) {
+        munmap((void *) stat, sizeof(*stat));
+    }
+    if (fd != -1) {
+        close(fd);
+    }
+
+    return ret == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+/*
+ * Local variables:
+ * mode: C
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
@@ -0,0 +1,921 @@
+/*
+ * meshpump-test.cxx
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <vector>
+#include <unistd.h>
+#include "MeshPump.hxx"
+#include "LedMatrix.hxx"
+#include "StatusModel.hxx"
+#include "StatExport.hxx"
+#include "HistoryStore.hxx"
+#include "FrameStream.hxx"
+#include "LedText.hxx"
+#include "GlyphAtlas.hxx"
+#include "LedTemplate.hxx"
+#include "LiveValues.hxx"
+#include "LedQueue.hxx"
+#include "Clock.hxx"
+#include "AllocStats.hxx"
+#include "ThreadConfig.hxx"
+#include "Logger.hxx"
+#include "Json.hxx"
+#include "RateLimiter.hxx"
+#include "RelayTable.hxx"
+#include "RelayRuntime.hxx"
+
+shared_ptr<MeshPump> meshpump = NULL;
+shared_ptr<LedMatrix> ledMatrix = NULL;
+shared_ptr<StatusModel> statusModel = NULL;
+shared_ptr<StatExport> statExport = NULL;
+shared_ptr<HistoryStore> historyStore = NULL;
+
+static unsigned int failures = 0;
+
+#define CHECK(cond)                                                     \
+    do {                                                                \
+        if (!(cond)) {                                                  \
+            fprintf(stderr, "%s:%d: %s\n", __FILE__, __LINE__, #cond);  \
+            failures++;                                                 \
+        }                                                               \
+    } while (0)
+
+/*
+ * Applies a delta message to a frame buffer the way a viewer does.
+ */
+static bool applyDelta(const string &msg, vector<uint8_t> &fb)
+{
+    size_t i = 4, pos = 0, length;
+    unsigned int skip, count;
+
+    if ((msg.size() < 4) || (msg[0] != FRAME_DELTA)) {
+        return false;
+    }
+    length = ((uint8_t) msg[2] << 8) | (uint8_t) msg[3];
+    if (msg.size() != length + 4) {
+        return false;
+    }
+
+    while (i < msg.size()) {
+        if (i + 2 > msg.size()) {
+            return false;
+        }
+        skip = (uint8_t) msg[i++];
+        count = (uint8_t) msg[i++];
+        pos += skip;
+        if ((i + count > msg.size()) || (pos + count > fb.size())) {
+            return false;
+        }
+        for (; count > 0; count--) {
+            fb[pos++] ^= (uint8_t) msg[i++];
+        }
+    }
+
+    return true;
+}
+
+static void testFrameDelta(void)
+{
+    vector<uint8_t> prev(LED_MAX_ROWS * LED_MAX_COLUMNS * 8, 0);
+    vector<uint8_t> fb, shown;
+    string msg;
+
+    // Nothing changed: at most empty runs that skip ahead
+    msg = FrameStream::delta(1, prev, prev);
+    CHECK((msg.size() >= 4) && (msg[0] == FRAME_DELTA) && (msg[1] == 1));
+    shown = prev;
+    CHECK(applyDelta(msg, shown) && (shown == prev));
+
+    // Frames of different sizes cannot be coded against each other
+    fb.assign(prev.size() - 8, 0);
+    CHECK(FrameStream::delta(0, prev, fb).empty());
+
+    // One byte changed past a run of more than 255 equal bytes
+    fb = prev;
+    fb[300] = 0x5a;
+    msg = FrameStream::delta(0, prev, fb);
+    shown = prev;
+    CHECK(applyDelta(msg, shown) && (shown == fb));
+
+    // A changed run longer than 255 bytes, ending at the last byte
+    fb = prev;
+    for (size_t i = 100; i < fb.size(); i++) {
+        fb[i] = (uint8_t) (i * 7 + 1);
+    }
+    msg = FrameStream::delta(0, prev, fb);
+    shown = prev;
+    CHECK(applyDelta(msg, shown) && (shown == fb));
+
+    // Scattered changes against a non-blank previous frame
+    prev = fb;
+    for (size_t i = 0; i < fb.size(); i += 13) {
+        fb[i] ^= 0x81;
+    }
+    msg = FrameStream::delta(0, prev, fb);
+    shown = prev;
+    CHECK(applyDelta(msg, shown) && (shown == fb));
+}
+
+static void testTextFit(void)
+{
+    string s;
+    LedText text;
+
+    // Text that fits is kept whole, however it ends
+    s.assign(LED_MAX_TEXT - 2, 'a');
+    s += "\xc3\xa9";                     // U+00E9, 2 bytes
+    CHECK(LedText::fit(s) == s.size());
+
+    // ASCII is cut at the bound
+    s.assign(LED_MAX_TEXT + 10, 'a');
+    CHECK(LedText::fit(s) == LED_MAX_TEXT);
+
+    // A 2-byte character straddling the bound is dropped whole
+    s.assign(LED_MAX_TEXT - 1, 'a');
+    s += "\xc3\xa9" "bc";
+    CHECK(LedText::fit(s) == LED_MAX_TEXT - 1);
+
+    // A 3-byte character ending right at the bound is kept
+    s.assign(LED_MAX_TEXT - 3, 'a');
+    s += "\xe2\x94\x80xyz";              // U+2500
+    CHECK(LedText::fit(s) == LED_MAX_TEXT);
+
+    // A 4-byte character cut after any of its bytes is dropped whole
+    for (unsigned int k = 1; k < 4; k++) {
+        s.assign(LED_MAX_TEXT - k, 'a');
+        s += "\xf0\x9f\x98\x80z";        // U+1F600
+        CHECK(LedText::fit(s) == LED_MAX_TEXT - k);
+    }
+
+    // Assigning stores only what fits
+    s.assign(LED_MAX_TEXT - 1, 'a');
+    s += "\xc3\xa9";
+    s += s;
+    text = s;
+    CHECK(text.size() == LED_MAX_TEXT - 1);
+    CHECK(string(text.c_str()) == s.substr(0, LED_MAX_TEXT - 1));
+}
+
+/*
+ * Parses and formats a template, or returns the parse error.
+ */
+static string expand(const string &text)
+{
+    LedTemplate tmpl;
+    string error, out;
+
+    if (!tmpl.parse(text, error)) {
+        return "error: " + error;
+    }
+    tmpl.format(out);
+
+    return out;
+}
+
+static void testTemplate(void)
+{
+    LiveValues &live = LiveValues::get();
+    int a = live.intern("test_a");
+    int b = live.intern("test_b");
+    LedTemplate tmpl;
+    string error;
+
+    CHECK((a >= 0) && (b >= 0) && (a != b));
+
+    // Literals and escaped braces; unpublished values show as "-"
+    CHECK(expand("UP") == "UP");
+    CHECK(expand("{{x}}") == "{x}");
+    CHECK(expand("{test_unset}s") == "-s");
+
+    // Whole values print as integers unless a conversion says otherwise
+    live.set(a, 1000000);
+    CHECK(expand("{test_a}") == "1000000");
+    CHECK(expand("{test_a:5}|") == "1000000|");
+    CHECK(expand("{test_a:.1f}") == "1000000.0");
+    live.set(a, 2.5);
+    CHECK(expand("{test_a}") == "2.5");
+    CHECK(expand("{test_a:d}") == "2");
+    CHECK(expand("{test_a:4.1f}C") == " 2.5C");
+    live.set(a, -3);
+    CHECK(expand("{test_a:u}") == "0");
+    CHECK(expand("{test_a:x}") == "0");
+    live.set(b, 255);
+    CHECK(expand("{test_a}/{test_b:x}") == "-3/ff");
+
+    // Bad fields are rejected
+    CHECK(expand("{test_a") == "error: unterminated field");
+    CHECK(expand("{}") == "error: invalid source ''");
+    CHECK(expand("{Test}") == "error: invalid source 'Test'");
+    CHECK(expand("{test_a:s}") == "error: invalid format 's'");
+    CHECK(expand("{test_a:.}") == "error: invalid format '.'");
+    CHECK(expand("{test_a:5dd}") == "error: invalid format '5dd'");
+
+    // The mask covers exactly the sources used
+    CHECK(tmpl.parse("{test_b} {test_b:x}", error));
+    CHECK(tmpl.sources() == (1ULL << b));
+}
+
+/*
+ * Parses a document and prints it back, or returns the parse error.
+ */
+static string json(const string &text)
+{
+    JsonValue value;
+    string error;
+
+    if (!JsonValue::parse(text, value, error)) {
+        return "error: " + error;
+    }
+
+    return value.toString();
+}
+
+static void testJson(void)
+{
+    JsonValue value;
+    string error;
+
+    // Values print back compactly, members in their order
+    CHECK(json("{\"b\":[true,false,null],\"a\":\"x\"}") ==
+          "{\"b\":[true,false,null],\"a\":\"x\"}");
+    CHECK(json(" { \"a\" : [ ] ,\"b\":{}}\n") == "{\"a\":[],\"b\":{}}");
+    CHECK(json("-3") == "-3");
+    CHECK(json("2.5") == "2.5");
+    CHECK(json("1e3") == "1000");
+
+    // Escapes, including a surrogate pair, decode to UTF-8
+    CHECK(JsonValue::parse("\"a\\n\\u00e9\\ud83d\\ude00\\/\"", value, error));
+    CHECK(value.isString() &&
+          (value.str == "a\n\xc3\xa9\xf0\x9f\x98\x80/"));
+    CHECK(JsonValue::quote("q\"\\\n\x01") == "\"q\\\"\\\\\\n\\u0001\"");
+
+    // Members are looked up by name, on objects only
+    CHECK(JsonValue::parse("{\"on\":true,\"n\":[1,2]}", value, error));
+    CHECK((value.get("on") != NULL) && value.get("on")->boolean);
+    CHECK((value.get("n") != NULL) && (value.get("n")->array.size() == 2));
+    CHECK(value.get("off") == NULL);
+    CHECK(value.get("n")->get("on") == NULL);
+
+    // Malformed documents are rejected with a reason
+    CHECK(json("") == "error: unexpected end of input");
+    CHECK(json("tru") == "error: invalid literal");
+    CHECK(json("1.2.3") == "error: invalid number");
+    CHECK(json("[1,]") == "error: invalid number");
+    CHECK(json("[1 2]") == "error: expected ',' or ']'");
+    CHECK(json("{\"a\" 1}") == "error: expected ':'");
+    CHECK(json("{1:2}") == "error: expected member name");
+    CHECK(json("{\"a\":1") == "error: unterminated object");
+    CHECK(json("\"abc") == "error: unterminated string");
+    CHECK(json("\"\\x\"") == "error: invalid escape");
+    CHECK(json("\"\\u12\"") == "error: invalid unicode escape");
+    CHECK(json("\"\\ud800\\u0041\"") == "error: invalid surrogate pair");
+    CHECK(json("1 x") == "error: trailing characters");
+    CHECK(json(string(20, '[')) == "error: nested too deeply");
+    CHECK(json(string(16, '[') + string(16, ']')) ==
+          string(16, '[') + string(16, ']'));
+}
+
+static void testRateLimiter(void)
+{
+    shared_ptr<SimClock> clock = make_shared<SimClock>(0);
+    RateLimiter limiter(60, 2, 2000);
+    unsigned long allowed, coalesced, dropped;
+    uint32_t node;
+
+    Clock::set(clock);
+    clock->advance(1000000000ULL);
+
+    // A repeat inside the window is absorbed and costs no token
+    CHECK(limiter.check(1, "pump up on") == RateLimiter::ALLOW);
+    CHECK(limiter.check(1, "pump up on") == RateLimiter::COALESCE);
+    CHECK(limiter.check(1, "status") == RateLimiter::ALLOW);
+    CHECK(limiter.check(1, "env") == RateLimiter::DROP);
+    CHECK(limiter.check(2, "env") == RateLimiter::ALLOW);
+
+    // Tokens come back at the configured rate, up to the burst
+    clock->advance(1000000000ULL);
+    CHECK(limiter.check(1, "env") == RateLimiter::ALLOW);
+    CHECK(limiter.check(1, "env") == RateLimiter::COALESCE);
+    clock->advance(2500000000ULL);
+    CHECK(limiter.check(1, "env") == RateLimiter::ALLOW);
+    CHECK(limiter.check(1, "status") == RateLimiter::ALLOW);
+    CHECK(limiter.check(1, "pump") == RateLimiter::DROP);
+
+    limiter.getStats(allowed, coalesced, dropped);
+    CHECK((allowed == 6) && (coalesced == 2) && (dropped == 2));
+
+    // A full table makes room by dropping the node heard from longest
+    // ago, which then starts over with a full bucket
+    limiter.configure(60, 1, 0);
+    for (node = 0; node < RATELIMIT_MAX_NODES; node++) {
+        CHECK(limiter.check(node, "x") == RateLimiter::ALLOW);
+        clock->advance(1000000ULL);
+    }
+    CHECK(limiter.check(node - 1, "x") == RateLimiter::DROP);
+    CHECK(limiter.check(node, "x") == RateLimiter::ALLOW);
+    CHECK(limiter.check(0, "x") == RateLimiter::ALLOW);
+    CHECK(limiter.check(2, "x") == RateLimiter::DROP);
+
+    // A rate of 0 turns limiting off
+    limiter.configure(0, 1, 0);
+    CHECK(limiter.check(2, "x") == RateLimiter::ALLOW);
+    CHECK(limiter.check(2, "x") == RateLimiter::ALLOW);
+
+    Clock::set(NULL);
+}
+
+static RelayChannel relay(const string &name, unsigned int pin)
+{
+    RelayChannel channel;
+
+    channel.name = name;
+    channel.pin = pin;
+
+    return channel;
+}
+
+static void testRelayTable(void)
+{
+    vector<RelayChannel> defaults = RelayTable::defaults();
+    RelayTable table, builtin;
+    RelayChannel channel;
+    string error;
+
+    // The built-in relays, used when the configured ones are rejected,
+    // are a valid table themselves
+    for (unsigned int i = 0; i < defaults.size(); i++) {
+        CHECK(builtin.add(defaults[i], error));
+    }
+    CHECK(builtin.size() == 3);
+    CHECK(builtin.find("fish") == builtin.find("fish-pump"));
+    CHECK(builtin.find("up") == 1);
+    CHECK(builtin[(unsigned int) builtin.find("up")].cutoffSec <=
+          builtin[(unsigned int) builtin.find("up")].maxOnSec);
+
+    // Names are folded to lowercase; hyphenated ones are found by their
+    // first word while that is unique
+    CHECK(table.add(relay("Fish-Pump", 26), error));
+    CHECK(table[0].name == "fish-pump");
+    CHECK(table.add(relay("fish-light", 21), error));
+    CHECK(table.add(relay("up-pump", 20), error));
+    CHECK(table.find("fish-light") == 1);
+    CHECK(table.find("fish") == -1);
+    CHECK(table.find("up") == 2);
+    CHECK(table.find("2") == 2);
+    CHECK(table.find("3") == -1);
+    CHECK(table.find("2x") == -1);
+    CHECK(table.find("pump") == -1);
+    CHECK(table.find("") == -1);
+
+    // Entries that would leave a relay unswitchable are rejected
+    CHECK(!table.add(relay("up-pump", 5), error) &&
+          (error == "relay 'up-pump' is defined twice"));
+    CHECK(!table.add(relay("2pump", 5), error) &&
+          (error == "relay name '2pump' is invalid"));
+    CHECK(!table.add(relay("a pump", 5), error));
+    CHECK(!table.add(relay("", 5), error));
+    CHECK(!table.add(relay(string(RELAY_MAX_NAME + 1, 'a'), 5), error));
+    CHECK(!table.add(relay("valve", RELAY_MAX_PIN + 1), error) &&
+          (error == "pin 32 of relay 'valve' is out of range"));
+    CHECK(!table.add(relay("valve", 20), error) &&
+          (error == "pin 20 is used by 'up-pump'"));
+    channel = relay("valve", 5);
+    channel.cutoffSec = 60;
+    channel.maxOnSec = 30;
+    CHECK(!table.add(channel, error) &&
+          (error == "cutoff of relay 'valve' exceeds its max on-time"));
+    channel.maxOnSec = 0;
+    CHECK(table.add(channel, error));
+    CHECK(table.size() == 4);
+
+    for (unsigned int pin = 0; table.size() < RELAY_MAX_CHANNELS; pin++) {
+        if ((pin != 5) && (pin != 20) && (pin != 21) && (pin != 26)) {
+            CHECK(table.add(relay("r" + to_string(pin), pin), error));
+        }
+    }
+    CHECK(!table.add(relay("extra", 30), error) &&
+          (error == "too many relays"));
+}
+
+static void testHistory(void)
+{
+    const time_t t0 = 1699999200;   // On an hour boundary
+    TimeSeries series("temp", "C");
+    vector<pair<time_t, HistoryPoint> > points;
+    HistoryPoint p;
+    HistoryStore saved, loaded;
+    char path[64];
+    FILE *fp;
+
+    // Each sample lands in one slot of every tier
+    series.add(t0, 10.0);
+    series.add(t0 + 5, 20.0);
+    series.add(t0 + 10, 30.0);
+    series.add(t0 + 70, 40.0);
+
+    series.dump(TimeSeries::TIER_RAW, points);
+    CHECK(points.size() == 3);
+    CHECK((points[0].first == t0) && (points[0].second.count == 2));
+    CHECK((points[0].second.min == 10.0) && (points[0].second.max == 20.0));
+    CHECK(points[0].second.avg == 15.0);
+    CHECK(points[2].first == t0 + 70);
+
+    series.dump(TimeSeries::TIER_MINUTE, points);
+    CHECK(points.size() == 2);
+    CHECK((points[0].second.count == 3) && (points[0].second.avg == 20.0));
+    CHECK((points[1].first == t0 + 60) && (points[1].second.count == 1));
+
+    series.dump(TimeSeries::TIER_HOUR, points);
+    CHECK((points.size() == 1) && (points[0].second.avg == 25.0));
+
+    // A late sample only counts in tiers whose newest slot still holds it
+    series.add(t0 + 5, 99.0);
+    series.dump(TimeSeries::TIER_RAW, points);
+    CHECK((points.size() == 3) && (points[0].second.count == 2));
+    series.dump(TimeSeries::TIER_MINUTE, points);
+    CHECK(points[0].second.count == 3);
+    series.dump(TimeSeries::TIER_HOUR, points);
+    CHECK((points[0].second.count == 5) && (points[0].second.max == 99.0));
+
+    CHECK(series.summarize(TimeSeries::TIER_RAW, t0 + 70, 70, p));
+    CHECK((p.count == 2) && (p.min == 30.0) && (p.max == 40.0));
+    CHECK(p.avg == 35.0);
+
+    // A gap longer than a tier's ring empties it; coarser tiers keep
+    // their history
+    series.add(t0 + 7200, 50.0);
+    series.dump(TimeSeries::TIER_RAW, points);
+    CHECK((points.size() == 1) && (points[0].first == t0 + 7200));
+    series.dump(TimeSeries::TIER_MINUTE, points);
+    CHECK(points.size() == 3);
+    series.dump(TimeSeries::TIER_HOUR, points);
+    CHECK((points.size() == 2) && (points[1].first == t0 + 7200));
+    CHECK(!series.summarize(TimeSeries::TIER_MINUTE, t0 + 3600, 600, p));
+
+    // A checkpoint restores each series by name, whatever the order
+    CHECK(saved.addSeries("temp", "C") == 0);
+    CHECK(saved.addSeries("hum", "%") == 1);
+    CHECK(saved.addSeries("temp", "C") == 0);
+    CHECK(saved.find("hum") == 1);
+    for (unsigned int i = 0; i < 500; i++) {
+        saved.add(0, t0 + i * 7, 20.0 + (i % 13));
+        saved.add(1, t0 + i * 11, 40.0 + (i % 7));
+    }
+    CHECK(loaded.addSeries("hum", "%") == 0);
+    CHECK(loaded.addSeries("temp", "C") == 1);
+
+    snprintf(path, sizeof(path), "/tmp/meshpump-test-%d.hist",
+             (int) getpid());
+    CHECK(!loaded.load(path));
+    CHECK(saved.save(path));
+    CHECK(loaded.load(path));
+    for (unsigned int i = 0; i < TimeSeries::TIER_COUNT; i++) {
+        TimeSeries::Tier tier = (TimeSeries::Tier) i;
+        CHECK(!saved.dump(0, tier).empty());
+        CHECK(saved.dump(0, tier) == loaded.dump(1, tier));
+        CHECK(saved.dump(1, tier) == loaded.dump(0, tier));
+    }
+
+    // A file that is not a checkpoint is refused
+    fp = fopen(path, "w");
+    if (fp) {
+        fputs("not a checkpoint", fp);
+        fclose(fp);
+    }
+    CHECK(!loaded.load(path));
+    unlink(path);
+}
+
+static uint64_t sec(time_t s)
+{
+    return (uint64_t) s * 1000000000ULL;
+}
+
+static bool near(float value, float expect)
+{
+    return (value > expect - 0.01) && (value < expect + 0.01);
+}
+
+static void testRuntime(void)
+{
+    const time_t noon = 1699963200;     // 12:00 UTC
+    const char *tz = getenv("TZ");
+    string oldTz = tz ? tz : "";
+    RelayRuntime runtime, fresh, live, stale, copy;
+    string name;
+    FILE *fp;
+
+    // Day buckets follow local days, so pin them to UTC
+    setenv("TZ", "UTC0", 1);
+    tzset();
+
+    // Two hours on the first day, cut off; half an hour the next
+    runtime.edge(true, false, sec(100), noon);
+    runtime.settle(sec(3700), noon + 3600);
+    CHECK(runtime.onNs() == sec(3600));
+    CHECK(runtime.runNs(sec(3700)) == sec(3600));
+    runtime.edge(false, true, sec(7300), noon + 7200);
+    CHECK(runtime.onNs() == sec(7200));
+    CHECK(runtime.runNs(sec(7300)) == 0);
+    CHECK(near(runtime.dutyPercent(1, noon + 7200),
+               100.0 * 7200 / (43200 + 7200)));
+
+    runtime.edge(true, false, sec(86400 + 100), noon + 86400);
+    runtime.edge(false, false, sec(86400 + 1900), noon + 86400 + 1800);
+    CHECK((runtime.cycles() == 2) && (runtime.cutoffStops() == 1) &&
+          (runtime.manualStops() == 1));
+    CHECK(near(runtime.dutyPercent(1, noon + 86400 + 1800),
+               100.0 * 1800 / 45000));
+    CHECK(near(runtime.dutyPercent(2, noon + 86400 + 1800),
+               100.0 * 9000 / (86400 + 45000)));
+    CHECK(runtime.dutyPercent(0, noon + 86400) == 0.0);
+
+    // A fresh run takes the saved buckets as they are
+    fresh.merge(runtime);
+    CHECK((fresh.onNs() == runtime.onNs()) && (fresh.cycles() == 2));
+    CHECK(fresh.summary(noon + 86400 + 1800) ==
+          runtime.summary(noon + 86400 + 1800));
+
+    // A run already under way adds the saved days to its own
+    live.edge(true, false, sec(0), noon + 86400 + 3600);
+    live.edge(false, false, sec(600), noon + 86400 + 4200);
+    live.edge(true, false, sec(86400), noon + 2 * 86400);
+    live.edge(false, false, sec(86400 + 1200), noon + 2 * 86400 + 1200);
+    live.merge(runtime);
+    CHECK((live.cycles() == 4) && (live.manualStops() == 3));
+    CHECK(live.onNs() == sec(7200 + 1800 + 600 + 1200));
+    CHECK(near(live.dutyPercent(3, noon + 2 * 86400 + 1200),
+               100.0 * (7200 + 2400 + 1200) / (2 * 86400 + 44400)));
+
+    // Saved days that have aged out of the window are dropped
+    stale.edge(true, false, sec(0), noon + 40 * 86400);
+    stale.edge(false, false, sec(60), noon + 40 * 86400 + 60);
+    stale.merge(runtime);
+    CHECK(stale.onNs() == sec(60 + 9000));
+    CHECK(near(stale.dutyPercent(30, noon + 40 * 86400 + 60),
+               100.0 * 60 / (29 * 86400 + 43260)));
+
+    // The checkpoint record round-trips
+    fp = tmpfile();
+    CHECK(fp != NULL);
+    if (fp) {
+        CHECK(runtime.write(fp, "up"));
+        rewind(fp);
+        CHECK(copy.read(fp, name));
+        CHECK(!copy.read(fp, name));
+        fclose(fp);
+    }
+    CHECK(name == "up");
+    CHECK((copy.onNs() == runtime.onNs()) && (copy.cycles() == 2));
+    CHECK((copy.cutoffStops() == 1) && (copy.manualStops() == 1));
+    CHECK(copy.summary(noon + 86400 + 1800) ==
+          runtime.summary(noon + 86400 + 1800));
+
+    if (tz) {
+        setenv("TZ", oldTz.c_str(), 1);
+    } else {
+        unsetenv("TZ");
+    }
+    tzset();
+}
+
+/*
+ * Decodes with both overloads, checking that they agree and that the
+ * pointer one writes no more glyphs than it reports.
+ */
+static vector<Glyph> decoded(const string &utf8)
+{
+    const GlyphAtlas &atlas = GlyphAtlas::get();
+    vector<Glyph> glyphs, raw(utf8.size() + 1, 0xffff);
+    size_t n;
+
+    atlas.decode(utf8, glyphs);
+    n = atlas.decode(utf8.data(), utf8.size(), raw.data());
+    CHECK(n == glyphs.size());
+    CHECK(raw[n] == 0xffff);
+    raw.resize(n);
+    CHECK(raw == glyphs);
+
+    return glyphs;
+}
+
+static void testDecode(void)
+{
+    const GlyphAtlas &atlas = GlyphAtlas::get();
+    const Glyph q = GLYPH_UNKNOWN;
+
+    CHECK(decoded("").empty());
+    CHECK(decoded("Up 1") == vector<Glyph>({ 'U', 'p', ' ', '1' }));
+    CHECK(decoded(string("a\0b", 3)) == vector<Glyph>({ 'a', 0, 'b' }));
+
+    // Each supported block maps to its own glyph; anything else shows
+    // as unknown, one glyph per code point
+    CHECK(atlas.lookup(0xe9) != q);
+    CHECK(atlas.lookup(0x3b1) != q);
+    CHECK(atlas.lookup(0x2500) != q);
+    CHECK(decoded("\xc3\xa9\xce\xb1\xe2\x94\x80") ==
+          vector<Glyph>({ atlas.lookup(0xe9), atlas.lookup(0x3b1),
+                          atlas.lookup(0x2500) }));
+    CHECK(decoded("\xe2\x82\xac\xf0\x9f\x98\x80") ==
+          vector<Glyph>({ q, q }));
+
+    // Malformed input costs one unknown glyph per byte and never eats
+    // the valid text that follows
+    CHECK(decoded("\x80\xff") == vector<Glyph>({ q, q }));
+    CHECK(decoded("a\xc3") == vector<Glyph>({ 'a', q }));
+    CHECK(decoded("\xe2\x94" "a") == vector<Glyph>({ q, q, 'a' }));
+
+    // Overlong forms, surrogates and code points past U+10FFFF
+    CHECK(decoded("\xc0\xaf") == vector<Glyph>({ q, q }));
+    CHECK(decoded("\xe0\x80\xaf") == vector<Glyph>({ q, q, q }));
+    CHECK(decoded("\xed\xa0\x80") == vector<Glyph>({ q, q, q }));
+    CHECK(decoded("\xf4\x90\x80\x80") == vector<Glyph>({ q, q, q, q }));
+}
+
+static LedMessage message(const string &text, unsigned int repeat = 0)
+{
+    LedMessage m;
+
+    m.layer = make_shared<TextLayer>(text, MAX7219_X_COUNT, 5);
+    m.ttl = 5;
+    m.repeat = repeat;
+
+    return m;
+}
+
+/*
+ * The texts of the queued messages in the order they will be shown,
+ * expiring each in turn; the queue is emptied.
+ */
+static string drain(LedQueue &queue)
+{
+    string order;
+
+    while (!queue.empty()) {
+        if (!order.empty()) {
+            order += ",";
+        }
+        order += queue.front()->layer->text();
+        queue.expire();
+    }
+
+    return order;
+}
+
+static void testQueue(void)
+{
+    LedQueue queue;
+
+    CHECK(queue.front() == NULL);
+
+    // Priority first, then arrival; a preempted message resumes
+    CHECK(queue.push(LedQueue::PRIORITY_NORMAL, message("n1")));
+    CHECK(queue.push(LedQueue::PRIORITY_LOW, message("l1")));
+    CHECK(queue.push(LedQueue::PRIORITY_NORMAL, message("n2")));
+    CHECK(queue.push(LedQueue::PRIORITY_HIGH, message("h1")));
+    CHECK(string(queue.front()->layer->text()) == "h1");
+    CHECK(drain(queue) == "h1,n1,n2,l1");
+
+    // Only the latest high priority message is kept
+    queue.push(LedQueue::PRIORITY_HIGH, message("on"));
+    queue.push(LedQueue::PRIORITY_HIGH, message("off"));
+    CHECK(queue.size(LedQueue::PRIORITY_HIGH) == 1);
+    CHECK(drain(queue) == "off");
+
+    // Repeats go to the back of their priority, even with the ring
+    // wrapped around
+    for (unsigned int i = 0; i < LED_QUEUE_DEPTH - 1; i++) {
+        queue.push(LedQueue::PRIORITY_NORMAL, message("x"));
+        queue.expire();
+    }
+    queue.push(LedQueue::PRIORITY_NORMAL, message("a", 2));
+    queue.push(LedQueue::PRIORITY_NORMAL, message("b", 1));
+    queue.push(LedQueue::PRIORITY_NORMAL, message("c"));
+    CHECK(drain(queue) == "a,b,c,a,b,a");
+
+    // A full ring rotates a repeat in place
+    queue.push(LedQueue::PRIORITY_NORMAL, message("r", 1));
+    for (unsigned int i = 0; i < LED_QUEUE_DEPTH - 1; i++) {
+        queue.push(LedQueue::PRIORITY_NORMAL, message("f"));
+    }
+    CHECK(queue.size() == LED_QUEUE_DEPTH);
+    CHECK(drain(queue) == "r,f,f,f,f,f,f,f,r");
+
+    // A full queue drops its oldest lowest priority message, and a
+    // message lower than everything queued is dropped instead
+    for (unsigned int i = 0; i < LED_QUEUE_DEPTH - 1; i++) {
+        queue.push(LedQueue::PRIORITY_NORMAL, message("n"));
+    }
+    queue.push(LedQueue::PRIORITY_LOW, message("l"));
+    CHECK(queue.size() == LED_QUEUE_DEPTH);
+    CHECK(queue.push(LedQueue::PRIORITY_NORMAL, message("new")));
+    CHECK(queue.size() == LED_QUEUE_DEPTH);
+    CHECK(queue.size(LedQueue::PRIORITY_LOW) == 0);
+    CHECK(!queue.push(LedQueue::PRIORITY_LOW, message("lost")));
+    CHECK(queue.push(LedQueue::PRIORITY_NORMAL, message("last")));
+    CHECK(queue.size() == LED_QUEUE_DEPTH);
+    CHECK(drain(queue) == "n,n,n,n,n,n,new,last");
+
+    queue.push(LedQueue::PRIORITY_LOW, message("l"));
+    queue.clear();
+    CHECK(queue.empty() && (queue.front() == NULL));
+}
+
+/*
+ * The text the status shows for a row of the first chain.
+ */
+static string shown(unsigned int y)
+{
+    StatusSnapshot state;
+
+    statusModel->snapshot(state);
+
+    return state.ledText[y];
+}
+
+static void ticks(LedMatrix &matrix, unsigned int seconds)
+{
+    for (unsigned int s = 0; s < seconds; s++) {
+        matrix.tick();
+    }
+}
+
+static void testPin(void)
+{
+    shared_ptr<LedMatrix> matrix = make_shared<LedMatrix>();
+
+    statusModel = make_shared<StatusModel>();
+    matrix->setText(0, 0, "hello");
+    CHECK(shown(0) == "hello");
+
+    // A sticky relay switched away from its default, as MeshPump does it
+    matrix->setText(0, 0, " OFF", 60, LedQueue::PRIORITY_HIGH);
+    matrix->pinText(0, 0, " OFF");
+    CHECK(shown(0) == " OFF");
+
+    // A message sent meanwhile shows once the relay's own has run out,
+    // and the row then rests on the relay state
+    matrix->setText(0, 0, "msg", 30);
+    ticks(*matrix, 59);
+    CHECK(shown(0) == " OFF");
+    ticks(*matrix, 1);
+    CHECK(shown(0) == "msg");
+    ticks(*matrix, 30);
+    CHECK(shown(0) == " OFF");
+    CHECK(matrix->ttl(0, 0) == 0);
+
+    // Back at its default the row rests on its welcome text again
+    matrix->setText(0, 0, "  ON", 60, LedQueue::PRIORITY_HIGH);
+    matrix->pinText(0, 0, "");
+    ticks(*matrix, 60);
+    CHECK(shown(0) == "hello");
+
+    matrix = NULL;
+    statusModel = NULL;
+}
+
+static unsigned long allocs(void)
+{
+    return AllocStats::counts(ThreadConfig::ROLE_MESH).allocs;
+}
+
+/*
+ * Row text and relay states are posted into the rows' preallocated
+ * layers, so once every row has shown something neither allocates.
+ */
+static void testAlloc(void)
+{
+    string text(LED_MAX_TEXT, 'm');
+    unsigned long before;
+    int fish, lighting;
+
+    AllocStats::setSubsystem(ThreadConfig::ROLE_MESH);
+    Logger::get().start();
+    statusModel = make_shared<StatusModel>();
+    ledMatrix = make_shared<LedMatrix>();
+    meshpump = make_shared<MeshPump>();
+    fish = meshpump->findRelay("fish-pump");
+    lighting = meshpump->findRelay("lighting");
+    CHECK((fish >= 0) && (lighting >= 0));
+
+    for (unsigned int round = 0; round < 3; round++) {
+        string message("a message long enough to leave the SSO buffer");
+
+        before = allocs();
+        ledMatrix->setText(0, 0, text);
+        ledMatrix->setText(0, 0, move(message));
+        meshpump->setRelay(fish, false);
+        meshpump->setRelay(lighting, true);
+        meshpump->setRelay(fish, true);
+        meshpump->setRelay(lighting, false);
+        CHECK((round == 0) || (allocs() == before));
+
+        // Out of the count, as the render thread does it
+        ticks(*ledMatrix, 120);
+    }
+
+    meshpump = NULL;
+    ledMatrix = NULL;
+    statusModel = NULL;
+    Logger::get().stop();
+}
+
+/*
+ * Seconds of simulated time, a tick each as the render thread would.
+ */
+static void run(SimClock &clock, LedMatrix &matrix, unsigned int seconds)
+{
+    for (unsigned int s = 0; s < seconds; s++) {
+        clock.advance(1000000000ULL);
+        matrix.tick();
+    }
+}
+
+static void testSleep(void)
+{
+    shared_ptr<SimClock> clock;
+    shared_ptr<LedMatrix> matrix;
+    LedPowerConfig config = LedPowerConfig();
+    struct tm start;
+
+    memset(&start, 0, sizeof(start));
+    start.tm_year = 2026 - 1900;
+    start.tm_mday = 1;
+    start.tm_hour = 0;
+    start.tm_min = 59;
+    start.tm_isdst = -1;
+    clock = make_shared<SimClock>(mktime(&start));
+    Clock::set(clock);
+
+    matrix = make_shared<LedMatrix>();
+    config.offFrom = 1;
+    config.offUntil = 2;
+    matrix->setPowerConfig(config);
+
+    // The off hours begin and end on the simulated clock
+    run(*clock, *matrix, 30);
+    CHECK(matrix->power() == LedMatrix::POWER_ACTIVE);
+    run(*clock, *matrix, 60);
+    CHECK(matrix->power() == LedMatrix::POWER_OFF);
+    run(*clock, *matrix, 3500);
+    CHECK(matrix->power() == LedMatrix::POWER_OFF);
+    run(*clock, *matrix, 120);
+    CHECK(matrix->power() == LedMatrix::POWER_ACTIVE);
+
+    // A message wakes the signs in the off hours until they idle again
+    run(*clock, *matrix, 23 * 3600);
+    CHECK(matrix->power() == LedMatrix::POWER_OFF);
+    matrix->setText(0, 0, "hi");
+    CHECK(matrix->power() == LedMatrix::POWER_ACTIVE);
+    run(*clock, *matrix, LED_WAKE_SEC + 1);
+    CHECK(matrix->power() == LedMatrix::POWER_OFF);
+
+    matrix = NULL;
+    Clock::set(NULL);
+}
+
+/*
+ * Checks the pieces whose edge cases are easy to get subtly wrong
+ * without hardware. Exits non-zero if any check fails.
+ */
+int main(void)
+{
+    testFrameDelta();
+    testTextFit();
+    testDecode();
+    testTemplate();
+    testQueue();
+    testJson();
+    testRateLimiter();
+    testRelayTable();
+    testHistory();
+    testRuntime();
+    testPin();
+    testAlloc();
+    testSleep();
+
+    if (failures > 0) {
+        fprintf(stderr, "%u checks failed\n", failures);
+        return EXIT_FAILURE;
+    }
+
+    printf("all checks passed\n");
+
+    return EXIT_SUCCESS;
+}
+
+/*
+ * Local variables:
+ * mode: C++
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */
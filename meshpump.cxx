@@ -8,6 +8,7 @@
 #include <getopt.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <sys/mman.h>
 #include <libconfig.h++>
 #if defined(USE_PIGPIO)
 #include <pigpiod_if.h>
@@ -15,9 +16,21 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
+#include <atomic>
+#include <thread>
 #include "MeshPump.hxx"
 #include "LedMatrix.hxx"
+#include "StatusModel.hxx"
+#include "StatExport.hxx"
 #include <MeshPumpShell.hxx>
+#include <RpcServer.hxx>
+#include <FrameStream.hxx>
+#include <ThreadConfig.hxx>
+#include <Logger.hxx>
+#include <Supervisor.hxx>
+#include <Watchdog.hxx>
+#include <HistoryStore.hxx>
+#include <Clock.hxx>
 #include "version.h"
 
 using namespace libconfig;
@@ -26,13 +39,22 @@ using namespace libconfig;
 
 shared_ptr<MeshPump> meshpump = NULL;
 shared_ptr<LedMatrix> ledMatrix = NULL;
+shared_ptr<StatusModel> statusModel = NULL;
+shared_ptr<StatExport> statExport = NULL;
+shared_ptr<HistoryStore> historyStore = NULL;
 static shared_ptr<MeshPumpShell> stdioShell = NULL;
 static shared_ptr<MeshPumpShell> netShell = NULL;
+static shared_ptr<RpcServer> rpcServer = NULL;
+static shared_ptr<FrameStream> frameStream = NULL;
+static shared_ptr<Supervisor> supervisor = NULL;
+static string historyPath;
+static unsigned int historyCheckpointSec = HISTORY_CHECKPOINT_SEC;
+static int cpuTempSeries = -1;
+static int commandSeries = -1;
+static vector<int> relaySeries;
 
-void sighandler(int signum)
+static void stopAll(void)
 {
-    (void)(signum);
-
     if (meshpump) {
         meshpump->detach();
     }
@@ -42,20 +64,118 @@ void sighandler(int signum)
     if (netShell) {
         netShell->detach();
     }
+    if (rpcServer) {
+        rpcServer->detach();
+    }
+    if (frameStream) {
+        frameStream->detach();
+    }
     if (ledMatrix) {
         ledMatrix->stop();
     }
 }
 
+static void joinAll(void)
+{
+    if (meshpump) {
+        meshpump->join();
+    }
+    if (stdioShell) {
+        stdioShell->join();
+    }
+    if (netShell) {
+        netShell->join();
+    }
+    if (rpcServer) {
+        rpcServer->join();
+    }
+    if (frameStream) {
+        frameStream->join();
+    }
+    if (ledMatrix) {
+        ledMatrix->join();
+    }
+}
+
+/*
+ * The history series: CPU temperature, the duty cycle of each relay
+ * (sampled each second, so a slot's mean is its duty cycle) and the
+ * chat command rate.
+ */
+static void setupHistory(void)
+{
+    historyStore = make_shared<HistoryStore>();
+    cpuTempSeries = historyStore->addSeries("cpu-temp", "C");
+    for (unsigned int i = 0; i < meshpump->relayCount(); i++) {
+        relaySeries.push_back(historyStore->addSeries(meshpump->relayName(i),
+                                                      "%"));
+    }
+    commandSeries = historyStore->addSeries("commands", "/min");
+
+    if (!historyPath.empty() && historyStore->load(historyPath)) {
+        Logger::get().info(Logger::CAT_SYSTEM, "history restored from %s",
+                           historyPath);
+    }
+    if (!historyPath.empty()) {
+        historyStore->startCheckpoints(historyPath);
+    }
+}
+
+static void tickAll(void)
+{
+    static unsigned long lastCommands = 0;
+    static unsigned int ticks = 0;
+    time_t now = Clock::get()->wallTime();
+    unsigned long commands;
+
+    // Not left to the render thread, which sleeps while the signs are off
+    if (statExport) {
+        statExport->tick();
+    }
+
+    if (meshpump) {
+        meshpump->publishLive();
+    }
+
+    if (historyStore == NULL) {
+        return;
+    }
+
+    // add() ignores the -1 of a series that did not fit; the temperature
+    // is the one publishLive() sampled, at most every CPU_TEMP_SAMPLE_SEC
+    historyStore->add(cpuTempSeries, now, statusModel->cpuTempC());
+    for (unsigned int i = 0; i < relaySeries.size(); i++) {
+        historyStore->add(relaySeries[i], now,
+                          meshpump->isRelayOn(i) ? 100.0 : 0.0);
+    }
+    commands = meshpump->commandCount();
+    historyStore->add(commandSeries, now, (commands - lastCommands) * 60.0);
+    lastCommands = commands;
+
+    ticks++;
+    if (!historyPath.empty() && (historyCheckpointSec > 0) &&
+        ((ticks % historyCheckpointSec) == 0)) {
+        historyStore->checkpoint();
+    }
+}
+
 void cleanup(void)
 {
-    meshpump->setFishPumpOnOff(true);
-    meshpump->setUpPumpOnOff(false);
-    meshpump->setLightingOnOff(false);
+    if (meshpump) {
+        meshpump->resetRelays();
+        meshpump->saveNvm();
+    }
+
+    if (historyStore && !historyPath.empty()) {
+        historyStore->stopCheckpoints();
+        historyStore->save(historyPath);
+    }
 
 #if defined(USE_PIGPIO)
     pigpio_stop();
 #endif
+
+    Logger::get().stop();
 }
 
 static void loadLibConfig(Config &cfg, string &path)
@@ -95,13 +215,394 @@ done:
     return;
 }
 
+/*
+ * threads = {
+ *     render = { cpus = "3"; policy = "fifo"; priority = 40; };
+ *     mesh = { cpus = "2"; policy = "fifo"; priority = 30; };
+ *     shell = { cpus = "0-1"; };
+ * };
+ */
+static void loadThreadConfig(Config &cfg)
+{
+    for (unsigned int i = 0; i < ThreadConfig::ROLE_COUNT; i++) {
+        ThreadConfig::Role role = (ThreadConfig::Role) i;
+        string path = string("threads.") + ThreadConfig::roleName(role);
+        string cpus, policy, error;
+        int priority = 0;
+
+        try {
+            if (!cfg.exists(path.c_str())) {
+                continue;
+            }
+            Setting &setting = cfg.lookup(path.c_str());
+            setting.lookupValue("cpus", cpus);
+            setting.lookupValue("policy", policy);
+            setting.lookupValue("priority", priority);
+        } catch (SettingNotFoundException &e) {
+            continue;
+        } catch (SettingTypeException &e) {
+            cerr << path << ": invalid setting" << endl;
+            continue;
+        }
+
+        if (ThreadConfig::get().configure(role, cpus, policy, priority,
+                                          error) == false) {
+            cerr << path << ": " << error << endl;
+        }
+    }
+}
+
+/*
+ * relays = (
+ *     { name = "fish-pump"; pin = 26; defaultOn = true; led = 3; },
+ *     { name = "up-pump"; pin = 20; cutoff = 10; maxOn = 120;
+ *       led = 2; nodes = [ 0x8ab1c2d3 ]; },
+ *     { name = "lighting"; pin = 21; activeLow = false; }
+ * );
+ *
+ * The whole list is rejected, and the built-in relays used, if any entry
+ * is invalid, so that a typo cannot leave a pump unswitchable.
+ */
+static void loadRelayConfig(Config &cfg, unsigned int ledRows,
+                            vector<RelayChannel> &relays)
+{
+    RelayTable table;
+    vector<RelayChannel> parsed;
+    string error;
+
+    relays = RelayTable::defaults();
+
+    try {
+        if (!cfg.exists("relays")) {
+            return;
+        }
+
+        Setting &list = cfg.lookup("relays");
+
+        for (int i = 0; i < list.getLength(); i++) {
+            Setting &entry = list[i];
+            RelayChannel relay;
+            int pin = -1;
+            int led = -1;
+            int cutoff = relay.cutoffSec;
+            int maxOn = relay.maxOnSec;
+
+            entry.lookupValue("name", relay.name);
+            entry.lookupValue("pin", pin);
+            entry.lookupValue("activeLow", relay.activeLow);
+            entry.lookupValue("defaultOn", relay.defaultOn);
+            entry.lookupValue("cutoff", cutoff);
+            entry.lookupValue("maxOn", maxOn);
+            entry.lookupValue("led", led);
+            entry.lookupValue("ledSticky", relay.ledSticky);
+            if (entry.exists("nodes")) {
+                Setting &nodes = entry.lookup("nodes");
+                for (int j = 0; j < nodes.getLength(); j++) {
+                    relay.nodes.push_back((unsigned int) nodes[j]);
+                }
+            }
+
+            if (pin < 0) {
+                cerr << "relays[" << i << "]: pin is missing" << endl;
+                return;
+            }
+            if ((cutoff < 0) || (maxOn < 0)) {
+                cerr << "relays[" << i << "]: invalid setting" << endl;
+                return;
+            }
+            relay.pin = (unsigned int) pin;
+            relay.cutoffSec = (unsigned int) cutoff;
+            relay.maxOnSec = (unsigned int) maxOn;
+            relay.ledRow = ((led >= 0) && ((unsigned int) led < ledRows)) ?
+                led : -1;
+
+            if (table.add(relay, error) == false) {
+                cerr << "relays[" << i << "]: " << error << endl;
+                return;
+            }
+            parsed.push_back(relay);
+        }
+    } catch (SettingNotFoundException &e) {
+        return;
+    } catch (SettingTypeException &e) {
+        cerr << "relays: invalid setting" << endl;
+        return;
+    }
+
+    relays = parsed;
+}
+
+static void loadLedPowerConfig(Config &cfg, LedPowerConfig &power)
+{
+    int dimAfter = 0;
+    int offAfter = 0;
+    int dimIntensity = 0;
+    int offFrom = 0;
+    int offUntil = 0;
+
+    power = LedPowerConfig();
+
+    try {
+        if (!cfg.exists("ledPower")) {
+            return;
+        }
+
+        Setting &entry = cfg.lookup("ledPower");
+
+        entry.lookupValue("dimAfter", dimAfter);
+        entry.lookupValue("offAfter", offAfter);
+        entry.lookupValue("dimIntensity", dimIntensity);
+        entry.lookupValue("offFrom", offFrom);
+        entry.lookupValue("offUntil", offUntil);
+    } catch (SettingNotFoundException &e) {
+        return;
+    } catch (SettingTypeException &e) {
+        cerr << "ledPower: invalid setting" << endl;
+        return;
+    }
+
+    if ((dimAfter < 0) || (offAfter < 0) ||
+        (dimIntensity < 0) || (dimIntensity > 15) ||
+        (offFrom < 0) || (offFrom > 23) || (offUntil < 0) || (offUntil > 23)) {
+        cerr << "ledPower: invalid setting" << endl;
+        return;
+    }
+
+    power.dimAfter = (unsigned int) dimAfter;
+    power.offAfter = (unsigned int) offAfter;
+    power.dimIntensity = (unsigned int) dimIntensity;
+    power.offFrom = (unsigned int) offFrom;
+    power.offUntil = (unsigned int) offUntil;
+}
+
+/*
+ * Rows bound to live value templates, as (row, template) pairs; they are
+ * checked when bound, once the LED chains exist.
+ */
+static void loadLedBindings(Config &cfg,
+                            vector<pair<string, string> > &bindings)
+{
+    bindings.clear();
+
+    try {
+        if (!cfg.exists("ledBindings")) {
+            return;
+        }
+
+        Setting &list = cfg.lookup("ledBindings");
+
+        for (int i = 0; i < list.getLength(); i++) {
+            Setting &entry = list[i];
+            string row, tmpl;
+
+            if (!entry.lookupValue("row", row) ||
+                !entry.lookupValue("template", tmpl)) {
+                cerr << "ledBindings[" << i << "]: row or template is "
+                     << "missing" << endl;
+                continue;
+            }
+            bindings.push_back(make_pair(row, tmpl));
+        }
+    } catch (SettingNotFoundException &e) {
+        return;
+    } catch (SettingTypeException &e) {
+        cerr << "ledBindings: invalid setting" << endl;
+        return;
+    }
+}
+
+static void loadLedConfig(Config &cfg, vector<LedChainConfig> &chains)
+{
+    vector<LedChainConfig> parsed;
+    string error;
+
+    chains = LedMatrix::defaults();
+
+    try {
+        if (!cfg.exists("ledChains")) {
+            return;
+        }
+
+        Setting &list = cfg.lookup("ledChains");
+
+        for (int i = 0; i < list.getLength(); i++) {
+            Setting &entry = list[i];
+            LedChainConfig chain;
+            int spi = i;
+            int columns = MAX7219_X_COUNT;
+            int rows = MAX7219_Y_COUNT;
+
+            entry.lookupValue("name", chain.name);
+            entry.lookupValue("spi", spi);
+            entry.lookupValue("columns", columns);
+            entry.lookupValue("rows", rows);
+            if ((spi < 0) || (columns < 0) || (rows < 0)) {
+                cerr << "ledChains[" << i << "]: invalid setting" << endl;
+                return;
+            }
+            chain.spi = (unsigned int) spi;
+            chain.columns = (unsigned int) columns;
+            chain.rows = (unsigned int) rows;
+            parsed.push_back(chain);
+        }
+    } catch (SettingNotFoundException &e) {
+        return;
+    } catch (SettingTypeException &e) {
+        cerr << "ledChains: invalid setting" << endl;
+        return;
+    }
+
+    if (!LedMatrix::validate(parsed, error)) {
+        cerr << "ledChains: " << error << endl;
+        return;
+    }
+
+    chains = parsed;
+}
+
+/*
+ * logLevel = "info";
+ * logLevels = { relay = "debug"; };
+ * logFile = "/var/log/meshpump.log";
+ * logMaxBytes = 1048576;
+ * logKeep = 4;
+ * logSyslog = 1;
+ */
+static unsigned int loadLogConfig(Config &cfg)
+{
+    Logger &logger = Logger::get();
+    unsigned int sinks = 0;
+    string logLevel, logFile;
+    int logMaxBytes = 1048576;
+    int logKeep = 4;
+    int logSyslog = 0;
+    Logger::Level level;
+    Logger::Category cat;
+
+    try {
+        Setting &root = cfg.getRoot();
+        root.lookupValue("logLevel", logLevel);
+        root.lookupValue("logFile", logFile);
+        root.lookupValue("logMaxBytes", logMaxBytes);
+        root.lookupValue("logKeep", logKeep);
+        root.lookupValue("logSyslog", logSyslog);
+    } catch (SettingNotFoundException &e) {
+    } catch (SettingTypeException &e) {
+    }
+
+    if (!logLevel.empty()) {
+        if (Logger::parseLevel(logLevel, level)) {
+            logger.setLevel(level);
+        } else {
+            cerr << "logLevel: invalid level '" << logLevel << "'" << endl;
+        }
+    }
+
+    try {
+        Setting &levels = cfg.lookup("logLevels");
+
+        for (unsigned int i = 0; i < Logger::CAT_COUNT; i++) {
+            cat = (Logger::Category) i;
+            if (!levels.lookupValue(Logger::categoryName(cat), logLevel)) {
+                continue;
+            }
+            if (Logger::parseLevel(logLevel, level)) {
+                logger.setLevel(cat, level);
+            } else {
+                cerr << "logLevels." << Logger::categoryName(cat)
+                     << ": invalid level '" << logLevel << "'" << endl;
+            }
+        }
+    } catch (SettingNotFoundException &e) {
+    } catch (SettingTypeException &e) {
+    }
+
+    if (!logFile.empty()) {
+        if (logger.setFile(logFile, logMaxBytes > 0 ? logMaxBytes : 0,
+                           logKeep > 0 ? logKeep : 0)) {
+            sinks |= Logger::SINK_FILE;
+        } else {
+            cerr << "Unable to log to " << logFile << endl;
+        }
+    }
+
+    if (logSyslog) {
+        sinks |= Logger::SINK_SYSLOG;
+    }
+
+    return sinks;
+}
+
+static atomic<bool> jitterLoad(false);
+
+static void jitterLoadFunc(void)
+{
+    volatile double x = 1.0;
+
+    while (jitterLoad) {
+        for (unsigned int i = 0; i < 100000; i++) {
+            x = (x * 1.000001) + 0.5;
+        }
+    }
+}
+
+static void reportJitter(const char *phase)
+{
+    const Histogram &period = ledMatrix->framePeriod();
+
+    printf("%-6s: mean=%.3fms stddev=%.3fms p99=%.3fms "
+           "min=%.3fms max=%.3fms (%lu frames)\n",
+           phase,
+           period.mean() / 1000000.0,
+           period.stddev() / 1000000.0,
+           period.percentile(99) / 1000000.0,
+           period.min() / 1000000.0,
+           period.max() / 1000000.0,
+           period.count());
+}
+
+/*
+ * Measures the render thread's frame period idle and then with every
+ * CPU kept busy by a spinning thread, to check the thread placement.
+ */
+static void runJitterTest(unsigned int seconds)
+{
+    vector<thread> load;
+    long ncpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+    printf("frame delay %ums, %us idle then %us with %ld busy threads\n",
+           ledMatrix->delay(), seconds, seconds, ncpus);
+    printf("%s", ThreadConfig::get().describe().c_str());
+
+    ledMatrix->resetFramePeriod();
+    sleep(seconds);
+    reportJitter("idle");
+
+    jitterLoad = true;
+    for (long i = 0; i < ncpus; i++) {
+        load.push_back(thread(jitterLoadFunc));
+    }
+    ledMatrix->resetFramePeriod();
+    sleep(seconds);
+    reportJitter("loaded");
+    jitterLoad = false;
+    for (vector<thread>::iterator it = load.begin(); it != load.end();
+         it++) {
+        it->join();
+    }
+}
+
 static const struct option long_options[] = {
     { "device", required_argument, NULL, 'd', },
     { "stdio", no_argument, NULL, 's', },
     { "port", required_argument, NULL, 'p', },
+    { "rpc-port", required_argument, NULL, 'r', },
+    { "frame-port", required_argument, NULL, 'f', },
+    { "capture", required_argument, NULL, 'c', },
     { "daemon", no_argument, NULL, 'b', },
     { "verbose", no_argument, NULL, 'v', },
     { "log", no_argument, NULL, 'l', },
+    { "jitter", required_argument, NULL, 'j', },
 };
 
 int main(int argc, char **argv)
@@ -110,11 +611,26 @@ int main(int argc, char **argv)
     Config cfg;
     string cfgfile;
     string device = DEFAULT_DEVICE;
+    string capture;
     bool useStdioShell = false;
     uint16_t port = 0;
+    uint16_t rpcPort = 0;
+    uint16_t framePort = 0;
+    int chatRatePerMin = 12;
+    int chatBurst = 5;
+    int chatCoalesceMs = 2000;
     bool daemon = false;
     bool verbose = false;
     bool log = false;
+    bool lockMemory = false;
+    unsigned int jitter = 0;
+    unsigned int logSinks = 0;
+    vector<RelayChannel> relays;
+    vector<LedChainConfig> ledChains;
+    LedPowerConfig ledPower;
+    vector<pair<string, string> > ledBindings;
+    string runtimePath;
+    int shutdownTimeout = SUPERVISOR_SHUTDOWN_TIMEOUT;
     string banner;
     string version;
     string built;
@@ -131,6 +647,7 @@ int main(int argc, char **argv)
     try {
         Setting &root = cfg.getRoot();
         root.lookupValue("device", device);
+        root.lookupValue("capture", capture);
     } catch (SettingNotFoundException &e) {
     } catch (SettingTypeException &e) {
     }
@@ -157,11 +674,114 @@ int main(int argc, char **argv)
         int cfgPort = 0;
         Setting &root = cfg.getRoot();
         root.lookupValue("port", cfgPort);
-        port = cfgPort;
+        if ((cfgPort < 0) || (cfgPort > 65535)) {
+            cerr << "port: invalid setting" << endl;
+        } else {
+            port = cfgPort;
+        }
+    } catch (SettingNotFoundException &e) {
+    } catch (SettingTypeException &e) {
+    }
+
+    try {
+        int cfgRpcPort = 0;
+        Setting &root = cfg.getRoot();
+        root.lookupValue("rpcPort", cfgRpcPort);
+        if ((cfgRpcPort < 0) || (cfgRpcPort > 65535)) {
+            cerr << "rpcPort: invalid setting" << endl;
+        } else {
+            rpcPort = cfgRpcPort;
+        }
+    } catch (SettingNotFoundException &e) {
+    } catch (SettingTypeException &e) {
+    }
+
+    try {
+        int cfgFramePort = 0;
+        Setting &root = cfg.getRoot();
+        root.lookupValue("framePort", cfgFramePort);
+        if ((cfgFramePort < 0) || (cfgFramePort > 65535)) {
+            cerr << "framePort: invalid setting" << endl;
+        } else {
+            framePort = cfgFramePort;
+        }
+    } catch (SettingNotFoundException &e) {
+    } catch (SettingTypeException &e) {
+    }
+
+    try {
+        int cfgRate = chatRatePerMin;
+        int cfgBurst = chatBurst;
+        int cfgCoalesce = chatCoalesceMs;
+        Setting &root = cfg.getRoot();
+        root.lookupValue("chatRatePerMin", cfgRate);
+        root.lookupValue("chatBurst", cfgBurst);
+        root.lookupValue("chatCoalesceMs", cfgCoalesce);
+        if ((cfgRate < 0) || (cfgBurst < 0) || (cfgCoalesce < 0)) {
+            cerr << "chat: invalid setting" << endl;
+        } else {
+            chatRatePerMin = cfgRate;
+            chatBurst = cfgBurst;
+            chatCoalesceMs = cfgCoalesce;
+        }
+    } catch (SettingNotFoundException &e) {
+    } catch (SettingTypeException &e) {
+    }
+
+    try {
+        int cfgTimeout = shutdownTimeout;
+        Setting &root = cfg.getRoot();
+        root.lookupValue("shutdownTimeout", cfgTimeout);
+        if (cfgTimeout < 0) {
+            cerr << "shutdownTimeout: invalid setting" << endl;
+        } else {
+            shutdownTimeout = cfgTimeout;
+        }
+    } catch (SettingNotFoundException &e) {
+    } catch (SettingTypeException &e) {
+    }
+
+    try {
+        Setting &root = cfg.getRoot();
+        if (!root.lookupValue("historyFile", historyPath)) {
+            const char *home = getenv("HOME");
+            if (home != NULL) {
+                historyPath = string(home) + "/.meshpump-history";
+            }
+        }
+        int cfgCheckpoint = historyCheckpointSec;
+        root.lookupValue("historyCheckpoint", cfgCheckpoint);
+        if (cfgCheckpoint < 0) {
+            cerr << "historyCheckpoint: invalid setting" << endl;
+        } else {
+            historyCheckpointSec = cfgCheckpoint;
+        }
+        if (!root.lookupValue("runtimeFile", runtimePath)) {
+            const char *home = getenv("HOME");
+            if (home != NULL) {
+                runtimePath = string(home) + "/.meshpump-runtime";
+            }
+        }
     } catch (SettingNotFoundException &e) {
     } catch (SettingTypeException &e) {
     }
 
+    try {
+        int cfgMlockall = 0;
+        Setting &root = cfg.getRoot();
+        root.lookupValue("mlockall", cfgMlockall);
+        lockMemory = cfgMlockall != 0 ? true : false;
+    } catch (SettingNotFoundException &e) {
+    } catch (SettingTypeException &e) {
+    }
+
+    loadThreadConfig(cfg);
+    loadLedConfig(cfg, ledChains);
+    loadRelayConfig(cfg, ledChains.empty() ? 0 : ledChains[0].rows, relays);
+    loadLedPowerConfig(cfg, ledPower);
+    loadLedBindings(cfg, ledBindings);
+    logSinks = loadLogConfig(cfg);
+
     try {
         bool cfgDaemon = 0;
         Setting &root = cfg.getRoot();
@@ -173,7 +793,7 @@ int main(int argc, char **argv)
 
     for (;;) {
         int option_index = 0;
-        int c = getopt_long(argc, argv, "d:sp:bvl",
+        int c = getopt_long(argc, argv, "d:sp:r:f:c:bvlj:",
                             long_options, &option_index);
         if (c == -1) {
             break;
@@ -189,6 +809,15 @@ int main(int argc, char **argv)
         case 'p':
             port = atoi(optarg);
             break;
+        case 'r':
+            rpcPort = atoi(optarg);
+            break;
+        case 'f':
+            framePort = atoi(optarg);
+            break;
+        case 'c':
+            capture = optarg;
+            break;
         case 'b':
             daemon = true;
             break;
@@ -198,6 +827,9 @@ int main(int argc, char **argv)
         case 'l':
             log = true;
             break;
+        case 'j':
+            jitter = atoi(optarg);
+            break;
         default:
             fprintf(stderr, "Unrecognized argument specified!\n");
             exit(EXIT_FAILURE);
@@ -218,6 +850,10 @@ int main(int argc, char **argv)
     }
 #endif
 
+    if (jitter > 0) {
+        daemon = false;
+    }
+
     if (daemon) {
         pid_t pid;
         int fdevnull;
@@ -227,8 +863,12 @@ int main(int argc, char **argv)
         if (port == 0) {
             port = 16876;
         }
+        if (rpcPort == 0) {
+            rpcPort = 16877;
+        }
 
-        pid = fork();
+        // Under systemd Type=notify the started process must stay
+        pid = (getenv("NOTIFY_SOCKET") != NULL) ? 0 : fork();
         if (pid == -1) {
             cerr << "fork failed!" << endl;
             exit(EXIT_FAILURE);
@@ -248,19 +888,71 @@ int main(int argc, char **argv)
         }
     }
 
-    atexit(cleanup);
-    signal(SIGINT, sighandler);
-    signal(SIGTERM, sighandler);
+    // Foreground keeps stdout; a daemon needs a file or syslog
+    if (!daemon) {
+        logSinks |= Logger::SINK_STDOUT;
+    } else if (logSinks == 0) {
+        logSinks = Logger::SINK_SYSLOG;
+    }
+    // Before the first thread is created, so that all of them inherit it
+    Supervisor::blockSignals();
     signal(SIGPIPE, SIG_IGN);
 
-    ledMatrix = make_shared<LedMatrix>();
+    Logger::get().setSinks(logSinks);
+    Logger::get().start();
+
+    supervisor = make_shared<Supervisor>();
+    if (supervisor->open() == false) {
+        exit(EXIT_FAILURE);
+    }
+    supervisor->setStopAction(stopAll);
+    supervisor->setJoinAction(joinAll);
+    supervisor->setTickAction(tickAll);
+    supervisor->setShutdownTimeout(shutdownTimeout);
+
+    atexit(cleanup);
+
+    if (lockMemory && (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)) {
+        perror("mlockall");
+    }
+    ThreadConfig::get().apply(ThreadConfig::ROLE_MAIN);
+
+    statExport = make_shared<StatExport>();
+    if (statExport->open() == false) {
+        statExport = NULL;
+    }
+
+    statusModel = make_shared<StatusModel>();
+
+    ledMatrix = make_shared<LedMatrix>(ledChains);
+    ledMatrix->setPowerConfig(ledPower);
     ledMatrix->setText(0, copyright);
     ledMatrix->setText(1, built);
     ledMatrix->setText(2, version);
     ledMatrix->setText(3, banner);
+    for (unsigned int i = 0; i < ledBindings.size(); i++) {
+        unsigned int c, y;
+        string error;
+
+        if (!ledMatrix->parseRow(ledBindings[i].first, c, y)) {
+            cerr << "ledBindings: row " << ledBindings[i].first
+                 << " is invalid" << endl;
+        } else if (!ledMatrix->bind(c, y, ledBindings[i].second, error)) {
+            cerr << "ledBindings: " << error << endl;
+        }
+    }
     ledMatrix->start();
 
-    meshpump = make_shared<MeshPump>();
+    if (jitter > 0) {
+        runJitterTest(jitter);
+        ledMatrix->stop();
+        ledMatrix->join();
+        exit(EXIT_SUCCESS);
+    }
+
+    // Threads started by libmeshtastic inherit the caller's placement
+    ThreadConfig::get().apply(ThreadConfig::ROLE_MESH);
+    meshpump = make_shared<MeshPump>(relays);
     meshpump->setBanner(banner);
     meshpump->setVersion(version);
     meshpump->setBuilt(built);
@@ -271,10 +963,16 @@ int main(int argc, char **argv)
     }
 
     meshpump->setClient(meshpump);
+    meshpump->setRuntimeFile(runtimePath);
     meshpump->setNvm(meshpump);
     meshpump->setVerbose(verbose);
+    meshpump->setChatRateLimit(chatRatePerMin, chatBurst, chatCoalesceMs);
+    if (!capture.empty() && (meshpump->startCapture(capture) == false)) {
+        cerr << "Unable to capture to " << capture << endl;
+    }
     meshpump->enableLogStderr(log);
 
+    ThreadConfig::get().apply(ThreadConfig::ROLE_SHELL);
     if (port != 0) {
         netShell = make_shared<MeshPumpShell>();
         netShell->setClient(meshpump);
@@ -282,6 +980,15 @@ int main(int argc, char **argv)
         netShell->bindPort(port);
     }
 
+    if (rpcPort != 0) {
+        rpcServer = make_shared<RpcServer>();
+        rpcServer->bindPort(rpcPort);
+    }
+
+    if (framePort != 0) {
+        frameStream = make_shared<FrameStream>();
+        frameStream->bindPort(framePort);
+    }
 
     if (useStdioShell) {
         stdioShell = make_shared<MeshPumpShell>();
@@ -290,19 +997,23 @@ int main(int argc, char **argv)
         stdioShell->attachStdio();
     }
 
-    /* ------- */
+    ThreadConfig::get().apply(ThreadConfig::ROLE_MAIN);
 
-    if (meshpump) {
-        meshpump->join();
-    }
-    if (stdioShell) {
-        stdioShell->join();
-    }
-    if (netShell) {
-        netShell->join();
+    setupHistory();
+
+    if (port != 0) {
+        Watchdog::get().watchAccept("shell", port);
     }
-    if (ledMatrix) {
-        ledMatrix->join();
+    Logger::get().info(Logger::CAT_SYSTEM, "ready");
+    Watchdog::notify("READY=1");
+
+    /* ------- */
+
+    if (supervisor->run() != 0) {
+        // Some thread is stuck: leave the relays safe and skip the
+        // destructors that would wait for it
+        cleanup();
+        _exit(EXIT_FAILURE);
     }
 
     cout << "Good-bye!" << endl;
@@ -0,0 +1,121 @@
+/*
+ * meshpump_stat.h
+ *
+ * Copyright (C) 2025, Charles Chiou
+ */
+
+#ifndef MESHPUMP_STAT_H
+#define MESHPUMP_STAT_H
+
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Layout of the POSIX shared-memory segment that meshpump publishes its
+ * state into. The writer bumps 'seq' to an odd value before updating and
+ * to the next even value afterwards; readers retry until they get a copy
+ * that was taken with the same even 'seq' at both ends (seqlock).
+ */
+
+#define MESHPUMP_STAT_SHM_NAME   "/meshpump-stat"
+#define MESHPUMP_STAT_MAGIC      0x5453504d  /* 'MPST' */
+#define MESHPUMP_STAT_VERSION    3
+#define MESHPUMP_STAT_ROWS       4
+#define MESHPUMP_STAT_TEXT_LEN   64
+#define MESHPUMP_STAT_RELAYS     16
+#define MESHPUMP_STAT_NAME_LEN   16
+#define MESHPUMP_STAT_RETRIES    100000  /* Reads before giving up */
+
+struct meshpump_stat_relay {
+    char name[MESHPUMP_STAT_NAME_LEN];
+    uint8_t on;
+    uint8_t reserved[3];
+    uint32_t cutoff;            /* seconds */
+};
+
+struct meshpump_stat {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t seq;
+    uint32_t pid;
+    uint64_t updated;           /* CLOCK_REALTIME, ns */
+    uint64_t generation;        /* status model generation */
+
+    uint32_t relay_count;
+    float cpu_temp;             /* degrees C */
+    struct meshpump_stat_relay relays[MESHPUMP_STAT_RELAYS];
+
+    uint32_t led_ttl[MESHPUMP_STAT_ROWS];
+    char led_text[MESHPUMP_STAT_ROWS][MESHPUMP_STAT_TEXT_LEN];
+
+    uint64_t shell_commands;
+    uint64_t shell_writes;
+    uint64_t shell_bytes;
+    uint64_t publishes;
+
+    uint64_t chat_allowed;
+    uint64_t chat_coalesced;
+    uint64_t chat_dropped;
+};
+
+static inline void meshpump_stat_write_begin(struct meshpump_stat *stat)
+{
+    __atomic_store_n(&stat->seq, stat->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void meshpump_stat_write_end(struct meshpump_stat *stat)
+{
+    __atomic_store_n(&stat->seq, stat->seq + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Copy a consistent snapshot out of the segment. Returns 0 on success or
+ * -1 if the segment is not (yet) a valid meshpump_stat, or if no write
+ * completed within MESHPUMP_STAT_RETRIES attempts (a writer that died
+ * mid-update leaves 'seq' odd).
+ */
+static inline int meshpump_stat_read(const struct meshpump_stat *stat,
+                                     struct meshpump_stat *copy)
+{
+    uint32_t seq1, seq2;
+    unsigned int retries;
+
+    for (retries = 0; ; retries++) {
+        if (retries >= MESHPUMP_STAT_RETRIES) {
+            return -1;
+        }
+
+        seq1 = __atomic_load_n(&stat->seq, __ATOMIC_ACQUIRE);
+        if (seq1 & 1) {
+            continue;
+        }
+
+        memcpy(copy, (const void *) stat, sizeof(*copy));
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+        seq2 = __atomic_load_n(&stat->seq, __ATOMIC_RELAXED);
+        if (seq1 == seq2) {
+            break;
+        }
+    }
+
+    if ((copy->magic != MESHPUMP_STAT_MAGIC) ||
+        (copy->version != MESHPUMP_STAT_VERSION)) {
+        return -1;
+    }
+
+    return 0;
+}
+
+#endif
+
+/*
+ * Local variables:
+ * mode: C
+ * c-file-style: "BSD"
+ * c-basic-offset: 4
+ * tab-width: 4
+ * indent-tabs-mode: nil
+ * End:
+ */